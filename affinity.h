@@ -0,0 +1,291 @@
+#ifndef OPENMC_RENDER_AFFINITY_H
+#define OPENMC_RENDER_AFFINITY_H
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Placement of the render pool's worker threads. Compact fills the cores of
+// one package after another (hyperthread siblings included), scatter spreads
+// the threads round robin over packages and physical cores before using any
+// siblings, and numa binds all threads to the CPUs of one NUMA node.
+enum class Affinity {
+  None,
+  Compact,
+  Scatter,
+  Numa
+};
+
+// Background workers only run on otherwise idle CPUs, so a viewer doesn't
+// slow down a simulation on the same node
+enum class Priority {
+  Interactive,
+  Background
+};
+
+struct ThreadSettings {
+  int threads {0};  // 0 for all CPUs available to the policy
+  Affinity affinity {Affinity::None};
+  int numa_node {0};
+  Priority priority {Priority::Interactive};
+};
+
+inline const char* affinity_name(Affinity affinity) {
+  switch (affinity) {
+  case Affinity::None: return "none";
+  case Affinity::Compact: return "compact";
+  case Affinity::Scatter: return "scatter";
+  case Affinity::Numa: return "numa";
+  }
+  return "";
+}
+
+// CPUs the process may run on, with their package, core and NUMA node
+// from sysfs. Without sysfs every CPU is its own core on node 0.
+class CpuTopology {
+public:
+  struct Cpu {
+    int id;
+    int package {0};
+    int core {0};
+    int node {0};
+    int sibling {0};  // index among the hyperthreads of its core
+  };
+
+  static const CpuTopology& get() {
+    static CpuTopology topology;
+    return topology;
+  }
+
+  const std::vector<Cpu>& cpus() const { return cpus_; }
+  int n_nodes() const { return n_nodes_; }
+
+  // CPUs in the order threads are placed on them by a policy
+  std::vector<Cpu> order(Affinity affinity, int numa_node) const {
+    std::vector<Cpu> cpus = cpus_;
+    if (affinity == Affinity::Numa) {
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](const Cpu& c) { return c.node != numa_node; }),
+                 cpus.end());
+    }
+    if (affinity == Affinity::Scatter) {
+      // rank of each core within its package, so packages alternate
+      std::vector<std::tuple<int, int, int, int>> keys;
+      for (const Cpu& c : cpus) {
+        int rank = 0;
+        for (const Cpu& other : cpus) {
+          if (other.package == c.package && other.sibling == 0 && other.core < c.core) rank++;
+        }
+        keys.emplace_back(c.sibling, rank, c.package, c.id);
+      }
+      std::vector<size_t> index(cpus.size());
+      for (size_t i = 0; i < index.size(); i++) index[i] = i;
+      std::sort(index.begin(), index.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+      std::vector<Cpu> sorted;
+      for (size_t i : index) sorted.push_back(cpus[i]);
+      return sorted;
+    }
+    std::sort(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b) {
+      return std::tie(a.node, a.package, a.core, a.sibling, a.id) < std::tie(b.node, b.package, b.core, b.sibling, b.id);
+    });
+    return cpus;
+  }
+
+  // Number of threads a policy uses by default
+  int default_threads(Affinity affinity, int numa_node) const {
+    int n = static_cast<int>(order(affinity, numa_node).size());
+    if (n == 0) n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    return n;
+  }
+
+private:
+  CpuTopology() {
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+      for (int id = 0; id < CPU_SETSIZE; id++) {
+        if (!CPU_ISSET(id, &mask)) continue;
+        Cpu cpu;
+        cpu.id = id;
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+        cpu.package = read_int(base + "/topology/physical_package_id", 0);
+        cpu.core = read_int(base + "/topology/core_id", id);
+        cpus_.push_back(cpu);
+      }
+    }
+    for (int node = 0; node < 1024; node++) {
+      std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (!in) break;
+      std::string list;
+      std::getline(in, list);
+      for (int id : parse_cpu_list(list)) {
+        for (Cpu& cpu : cpus_) {
+          if (cpu.id == id) cpu.node = node;
+        }
+      }
+      n_nodes_ = node + 1;
+    }
+#endif
+    if (cpus_.empty()) {
+      int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+      for (int id = 0; id < n; id++) {
+        Cpu cpu;
+        cpu.id = id;
+        cpu.core = id;
+        cpus_.push_back(cpu);
+      }
+    }
+    for (Cpu& cpu : cpus_) {
+      for (const Cpu& other : cpus_) {
+        if (other.package == cpu.package && other.core == cpu.core && other.id < cpu.id) cpu.sibling++;
+      }
+    }
+  }
+
+  static int read_int(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value;
+    return in >> value ? value : fallback;
+  }
+
+  // "0-3,8-11" style lists
+  static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> ids;
+    size_t pos = 0;
+    while (pos < list.size()) {
+      size_t end = list.find(',', pos);
+      if (end == std::string::npos) end = list.size();
+      std::string range = list.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      try {
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int id = first; id <= last; id++) ids.push_back(id);
+      } catch (const std::exception&) {
+      }
+      pos = end + 1;
+    }
+    return ids;
+  }
+
+  std::vector<Cpu> cpus_;
+  int n_nodes_ {1};
+};
+
+// Parse none, compact, scatter or numa[:node], the node must exist
+inline bool parse_affinity(const std::string& value, ThreadSettings& settings) {
+  for (Affinity a : {Affinity::None, Affinity::Compact, Affinity::Scatter}) {
+    if (value == affinity_name(a)) {
+      settings.affinity = a;
+      return true;
+    }
+  }
+  if (value.compare(0, 4, "numa") != 0) return false;
+  settings.affinity = Affinity::Numa;
+  settings.numa_node = 0;
+  if (value.size() > 5 && value[4] == ':') {
+    try {
+      settings.numa_node = std::stoi(value.substr(5));
+    } catch (const std::exception&) {
+      return false;
+    }
+    return settings.numa_node >= 0 && settings.numa_node < CpuTopology::get().n_nodes();
+  }
+  return value.size() == 4;
+}
+
+#ifdef __linux__
+// CPUs a pool thread is pinned to by the settings, false if it isn't pinned
+inline bool placement_mask(const ThreadSettings& settings, int thread, cpu_set_t& mask) {
+  if (settings.affinity == Affinity::None) return false;
+  std::vector<CpuTopology::Cpu> order = CpuTopology::get().order(settings.affinity, settings.numa_node);
+  if (order.empty()) return false;
+  CPU_ZERO(&mask);
+  if (settings.affinity == Affinity::Numa) {
+    // the whole node, the scheduler balances within it
+    for (const auto& cpu : order) CPU_SET(cpu.id, &mask);
+  } else {
+    CPU_SET(order[thread % order.size()].id, &mask);
+  }
+  return true;
+}
+#endif
+
+// Pin and prioritize the calling worker thread (1-based, thread 0 is the
+// pool's caller, see CallerPlacement) according to the settings
+inline void place_worker_thread(const ThreadSettings& settings, int thread) {
+#ifdef __linux__
+  cpu_set_t mask;
+  if (placement_mask(settings, thread, mask)) {
+    pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  }
+  if (settings.priority == Priority::Background) {
+    sched_param param {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+  }
+#else
+  (void)settings;
+  (void)thread;
+#endif
+}
+
+// Placement of thread 0, the thread that calls parallel_for. It's usually
+// the UI thread, so it only takes the first CPU of the policy while it
+// traces and gets its own mask back afterwards. Its priority is left alone.
+class CallerPlacement {
+public:
+  CallerPlacement() = default;
+
+  explicit CallerPlacement(const ThreadSettings& settings) {
+#ifdef __linux__
+    pinned_ = placement_mask(settings, 0, mask_);
+#else
+    (void)settings;
+#endif
+  }
+
+  // Pins the calling thread for its lifetime
+  class Scope {
+  public:
+    explicit Scope(const CallerPlacement& placement) {
+#ifdef __linux__
+      if (placement.pinned_ && pthread_getaffinity_np(pthread_self(), sizeof(saved_), &saved_) == 0) {
+        restore_ = pthread_setaffinity_np(pthread_self(), sizeof(placement.mask_), &placement.mask_) == 0;
+      }
+#else
+      (void)placement;
+#endif
+    }
+
+    ~Scope() {
+#ifdef __linux__
+      if (restore_) pthread_setaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+#endif
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+#ifdef __linux__
+    cpu_set_t saved_;
+#endif
+    bool restore_ {false};
+  };
+
+private:
+#ifdef __linux__
+  cpu_set_t mask_;
+#endif
+  bool pinned_ {false};
+};
+
+#endif // include guard
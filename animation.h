@@ -0,0 +1,200 @@
+#ifndef OPENMC_RENDER_ANIMATION_H
+#define OPENMC_RENDER_ANIMATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "camera_path.h"
+#include "frame.h"
+#include "plotter.h"
+#include "scene.h"
+#include "spans.h"
+
+struct AnimationSettings {
+  int width {1920};
+  int height {1080};
+  double fps {30.0};
+  std::string pattern {"frame_%05d.ppm"};  // printf pattern of the frame number
+  int batch {4};   // frames traced together
+  int part {0};    // this process renders frames part, part + parts, ...
+  int parts {1};
+
+  int frame_count(const CameraPath& path) const {
+    return path.empty() ? 0 : static_cast<int>(std::floor(path.duration() * fps + 1e-6)) + 1;
+  }
+
+  // The pattern must hold exactly one integer conversion (%d, %05d, ...)
+  bool valid_pattern() const {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+      if (pattern[i] != '%') continue;
+      if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+        i++;
+        continue;
+      }
+      size_t j = i + 1;
+      while (j < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[j]))) j++;
+      if (j == pattern.size() || pattern[j] != 'd') return false;
+      conversions++;
+      i = j;
+    }
+    return conversions == 1;
+  }
+
+  std::string frame_path(int frame) const {
+    std::vector<char> buffer(pattern.size() + 32);
+    std::snprintf(buffer.data(), buffer.size(), pattern.c_str(), frame);
+    return buffer.data();
+  }
+};
+
+// Writes frames to numbered binary PPM files on a background thread, so
+// tracing the next frames overlaps with disk I/O. At most max_pending frames
+// wait in memory.
+class ImageSequenceWriter {
+public:
+  ImageSequenceWriter(const AnimationSettings& settings, size_t max_pending)
+    : settings_(settings), max_pending_(max_pending) {
+    writer_ = std::thread([this]() { write_loop(); });
+  }
+
+  ~ImageSequenceWriter() {
+    if (writer_.joinable()) {
+      try {
+        finish();
+      } catch (...) {
+      }
+    }
+  }
+
+  // Queue a frame, blocking while the writer is behind
+  void push(int number, Frame&& frame) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this]() { return queue_.size() < max_pending_; });
+    queue_.emplace_back(number, std::move(frame));
+    ready_.notify_one();
+  }
+
+  // Write the remaining frames
+  void finish() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    ready_.notify_one();
+    writer_.join();
+    if (!failed_.empty()) {
+      throw std::runtime_error("Failed to write " + failed_);
+    }
+  }
+
+private:
+  void write_loop() {
+    while (true) {
+      std::pair<int, Frame> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        item = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      space_.notify_one();
+
+      spans::Scope span("write frame");
+      const Frame& frame = item.second;
+      std::string path = settings_.frame_path(item.first);
+      std::FILE* file = std::fopen(path.c_str(), "wb");
+      bool ok = file != nullptr;
+      if (ok) {
+        // RGBColor is three packed bytes, the same as a PPM pixel
+        std::fprintf(file, "P6\n%d %d\n255\n", frame.width, frame.height);
+        ok = std::fwrite(frame.color.data(), 3, frame.size(), file) == frame.size();
+        ok = std::fclose(file) == 0 && ok;
+      }
+      if (!ok && failed_.empty()) failed_ = path;
+    }
+  }
+
+  AnimationSettings settings_;
+  std::thread writer_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::deque<std::pair<int, Frame>> queue_;
+  size_t max_pending_;
+  bool done_ {false};
+  std::string failed_;  // first file that couldn't be written
+};
+
+// Render the frames of a camera path with the colors, visibility and kernel
+// settings of the plotter's scene. Frames are traced settings.batch at a
+// time, with the tiles of all of them in one parallel_for, so the pool
+// doesn't idle on the last tiles and the antialiasing pass of each frame.
+// A movie can be split over processes with part and parts. Returns false if
+// cancelled.
+inline bool render_animation(OpenMCPlotter& plotter,
+                             const CameraPath& path,
+                             const AnimationSettings& settings,
+                             std::atomic<float>& progress,
+                             const std::atomic<bool>& cancel) {
+  if (!settings.valid_pattern()) {
+    throw std::runtime_error("Invalid frame file pattern " + settings.pattern + ", expected one %d");
+  }
+  std::vector<int> numbers;
+  for (int i = settings.part; i < settings.frame_count(path); i += settings.parts) {
+    numbers.push_back(i);
+  }
+
+  size_t batch = std::max(1, settings.batch);
+  std::vector<Scene> scenes;
+  for (size_t i = 0; i < std::min(batch, numbers.size()); i++) {
+    scenes.push_back(plotter.create_scene());
+    scenes.back().copy_settings(plotter.scene());
+    scenes.back().set_pixels(settings.width, settings.height);
+  }
+  // the G-buffer is only needed to find the edges to supersample
+  bool gbuffer = plotter.scene().antialias();
+  ImageSequenceWriter writer(settings, 2 * batch);
+
+  for (size_t first = 0; first < numbers.size() && !cancel; first += batch) {
+    spans::Scope span("animation batch");
+    size_t n = std::min(batch, numbers.size() - first);
+    std::vector<Frame> frames(n);
+    std::vector<Scene*> views;
+    std::vector<Frame*> targets;
+    for (size_t i = 0; i < n; i++) {
+      CameraKey key = path.at(path.start() + numbers[first + i] / settings.fps);
+      Scene& scene = scenes[i];
+      scene.set_camera_position(key.position);
+      scene.set_look_at(key.look_at);
+      scene.set_up_vector(key.up);
+      scene.set_field_of_view(key.fov);
+      scene.set_light_position(key.light);
+      frames[i].resize(settings.width, settings.height, gbuffer);
+      views.push_back(&scene);
+      targets.push_back(&frames[i]);
+    }
+    plotter.render_scenes(views, targets);
+    for (size_t i = 0; i < n; i++) {
+      writer.push(numbers[first + i], std::move(frames[i]));
+    }
+    progress = static_cast<float>(first + n) / numbers.size();
+  }
+
+  writer.finish();
+  return !cancel;
+}
+
+#endif // include guard
@@ -0,0 +1,172 @@
+#ifndef OPENMC_RENDER_CAMERA_PATH_H
+#define OPENMC_RENDER_CAMERA_PATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "openmc/position.h"
+
+#include "quaternion.h"
+
+// Camera and light of an animation at one point in time
+struct CameraKey {
+  double time {0.0};  // seconds from the start of the path
+  openmc::Position position;
+  openmc::Position look_at;
+  openmc::Direction up {0.0, 0.0, 1.0};
+  double fov {45.0};  // horizontal, in degrees
+  openmc::Position light;
+};
+
+// Keyframed camera path. Between keys, the camera and light positions follow
+// a Catmull-Rom spline through all keys (so the motion doesn't jerk at a
+// key), the orientation is interpolated along the shortest rotation between
+// the keys' orientations, and the distance to the look-at point and the
+// field of view change linearly.
+class CameraPath {
+public:
+  // Insert a key in time order, replacing one at the same time
+  void add(const CameraKey& key) {
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key.time,
+                               [](const CameraKey& k, double time) { return k.time < time; });
+    if (it != keys_.end() && it->time == key.time) {
+      *it = key;
+    } else {
+      keys_.insert(it, key);
+    }
+  }
+
+  void remove(size_t i) {
+    if (i < keys_.size()) keys_.erase(keys_.begin() + i);
+  }
+
+  void clear() { keys_.clear(); }
+
+  bool empty() const { return keys_.empty(); }
+  size_t size() const { return keys_.size(); }
+  const std::vector<CameraKey>& keys() const { return keys_; }
+
+  double start() const { return keys_.empty() ? 0.0 : keys_.front().time; }
+  double end() const { return keys_.empty() ? 0.0 : keys_.back().time; }
+  double duration() const { return end() - start(); }
+
+  // The camera at time, held at the first and last key outside of the path
+  CameraKey at(double time) const {
+    if (keys_.size() < 2 || time <= start()) return keys_.empty() ? CameraKey() : keys_.front();
+    if (time >= end()) return keys_.back();
+
+    size_t i = std::upper_bound(keys_.begin(), keys_.end(), time,
+                                [](double t, const CameraKey& k) { return t < k.time; }) - keys_.begin() - 1;
+    const CameraKey& k0 = keys_[i];
+    const CameraKey& k1 = keys_[i + 1];
+    double dt = k1.time - k0.time;
+    double s = (time - k0.time) / dt;
+
+    CameraKey key;
+    key.time = time;
+    key.position = spline(i, s, [](const CameraKey& k) { return k.position; });
+    key.light = spline(i, s, [](const CameraKey& k) { return k.light; });
+    key.fov = k0.fov + s * (k1.fov - k0.fov);
+
+    Quaternion q = Quaternion::slerp(orientation(k0), orientation(k1), static_cast<float>(s));
+    openmc::Direction back = q.rotate({0.0, 0.0, 1.0});
+    key.up = q.rotate({0.0, 1.0, 0.0});
+    double d0 = (k0.look_at - k0.position).norm();
+    double d1 = (k1.look_at - k1.position).norm();
+    key.look_at = key.position - back * (d0 + s * (d1 - d0));
+    return key;
+  }
+
+  // Text format, one key per line:
+  //   <time> <position xyz> <look_at xyz> <up xyz> <fov> <light xyz>
+  bool save(const std::string& path, std::string& error) const {
+    std::ofstream out(path);
+    if (!out) {
+      error = "Can't write " + path;
+      return false;
+    }
+    out << "# omc-render camera path 1\n";
+    out << "# time position look_at up fov light\n" << std::setprecision(17);
+    auto write = [&out](const openmc::Position& p) { out << " " << p[0] << " " << p[1] << " " << p[2]; };
+    for (const CameraKey& key : keys_) {
+      out << key.time;
+      write(key.position);
+      write(key.look_at);
+      write(key.up);
+      out << " " << key.fov;
+      write(key.light);
+      out << "\n";
+    }
+    if (!out) {
+      error = "Failed to write " + path;
+      return false;
+    }
+    return true;
+  }
+
+  bool load(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+      error = "Can't read " + path;
+      return false;
+    }
+    CameraPath loaded;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+      line_number++;
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream values(line);
+      CameraKey key;
+      auto read = [&values](openmc::Position& p) { return static_cast<bool>(values >> p[0] >> p[1] >> p[2]); };
+      bool ok = static_cast<bool>(values >> key.time) && read(key.position) && read(key.look_at) &&
+                read(key.up) && static_cast<bool>(values >> key.fov) && read(key.light);
+      if (ok) {
+        openmc::Direction forward = key.look_at - key.position;
+        ok = forward.norm() > 0.0 && forward.cross(key.up).norm() > 0.0 && key.fov > 0.0 && key.fov < 180.0;
+      }
+      if (!ok) {
+        error = path + ":" + std::to_string(line_number) + ": invalid key";
+        return false;
+      }
+      loaded.add(key);
+    }
+    *this = std::move(loaded);
+    return true;
+  }
+
+private:
+  // Orientation of a key's camera: x is right, y up and z backwards
+  static Quaternion orientation(const CameraKey& key) {
+    openmc::Direction forward = key.look_at - key.position;
+    forward = forward / forward.norm();
+    openmc::Direction right = forward.cross(key.up);
+    right = right / right.norm();
+    openmc::Direction up = right.cross(forward);
+    return Quaternion::fromBasis(right, up, -forward);
+  }
+
+  // Cubic Hermite interpolation of a key's value between keys i and i + 1,
+  // with the tangents of a Catmull-Rom spline for uneven key spacing
+  template<typename Value>
+  openmc::Position spline(size_t i, double s, Value value) const {
+    auto tangent = [&](size_t k) {
+      size_t a = k > 0 ? k - 1 : k;
+      size_t b = k + 1 < keys_.size() ? k + 1 : k;
+      return (value(keys_[b]) - value(keys_[a])) / (keys_[b].time - keys_[a].time);
+    };
+    double dt = keys_[i + 1].time - keys_[i].time;
+    double s2 = s * s, s3 = s2 * s;
+    return (2 * s3 - 3 * s2 + 1) * value(keys_[i]) + (s3 - 2 * s2 + s) * dt * tangent(i) +
+           (-2 * s3 + 3 * s2) * value(keys_[i + 1]) + (s3 - s2) * dt * tangent(i + 1);
+  }
+
+  std::vector<CameraKey> keys_;  // in time order, times are unique
+};
+
+#endif // include guard
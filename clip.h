@@ -0,0 +1,87 @@
+#ifndef OPENMC_RENDER_CLIP_H
+#define OPENMC_RENDER_CLIP_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "openmc/position.h"
+
+// A plane keeping the points with normal . (p - center) <= offset, where
+// center is the center of the model's bounding box
+struct ClipPlane {
+  bool enabled {false};
+  float azimuth {0.0f};    // direction of the normal in degrees
+  float elevation {0.0f};
+  float offset {0.0f};
+
+  openmc::Direction normal() const {
+    double az = azimuth * M_PI / 180.0;
+    double el = elevation * M_PI / 180.0;
+    return {std::cos(el) * std::cos(az), std::cos(el) * std::sin(az), std::sin(el)};
+  }
+};
+
+// Convex region of the model that is drawn: the intersection of the enabled
+// clip planes' half-spaces and optionally a box. Primary rays start where
+// they enter the region and end where they leave it, and shadow rays end
+// where they leave it, so the parts that are cut away neither hide nor
+// shadow anything.
+struct ClipRegion {
+  static constexpr int max_planes = 4;
+  std::array<ClipPlane, max_planes> planes;
+  bool box_enabled {false};
+  openmc::Position box_lower;
+  openmc::Position box_upper;
+  openmc::Position center;
+
+  bool active() const {
+    return box_enabled || std::any_of(planes.begin(), planes.end(), [](const ClipPlane& p) { return p.enabled; });
+  }
+
+  // Narrow [t_enter, t_exit] to the part of the ray inside the region. On
+  // success normal is the outward normal of the face the ray enters through
+  // (only meaningful if t_enter was raised).
+  bool clip(const openmc::Position& r, const openmc::Direction& u,
+            double& t_enter, double& t_exit, openmc::Direction& normal) const {
+    for (const auto& plane : planes) {
+      if (!plane.enabled) continue;
+      openmc::Direction n = plane.normal();
+      double dist = plane.offset - n.dot(r - center);  // positive on the kept side
+      double nu = n.dot(u);
+      if (nu == 0.0) {
+        if (dist < 0.0) return false;
+        continue;
+      }
+      double t = dist / nu;
+      if (nu > 0.0) {
+        t_exit = std::min(t_exit, t);
+      } else if (t > t_enter) {
+        t_enter = t;
+        normal = n;
+      }
+    }
+
+    if (box_enabled) {
+      for (int i = 0; i < 3; i++) {
+        if (u[i] == 0.0) {
+          if (r[i] < box_lower[i] || r[i] > box_upper[i]) return false;
+          continue;
+        }
+        double t0 = (box_lower[i] - r[i]) / u[i];
+        double t1 = (box_upper[i] - r[i]) / u[i];
+        if (t0 > t1) std::swap(t0, t1);
+        if (t0 > t_enter) {
+          t_enter = t0;
+          normal = {0.0, 0.0, 0.0};
+          normal[i] = u[i] > 0.0 ? -1.0 : 1.0;
+        }
+        t_exit = std::min(t_exit, t1);
+      }
+    }
+    return t_enter < t_exit && t_exit > 0.0;
+  }
+};
+
+#endif // include guard
@@ -0,0 +1,207 @@
+#ifndef OPENMC_RENDER_COST_H
+#define OPENMC_RENDER_COST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/plot.h"
+#include "openmc/universe.h"
+
+#include "frame.h"
+#include "thread_pool.h"
+
+// Work done by a primary ray, counted by GBufferRay for kernels with cost
+struct RayCost {
+  uint32_t surfaces {0};   // surfaces tested for the distance to the next boundary
+  uint32_t crossings {0};  // boundary crossings
+  uint32_t lookups {0};    // coordinate levels searched for the cell entered
+  uint32_t lattice {0};    // lattice tile crossings
+  float time_us {0.0f};    // wall time of the trace
+};
+
+// Work attributed to a cell over a frame. Surface tests go to every cell on
+// the ray's coordinate stack, crossings and lookups to the cell entered and
+// lattice crossings to the cell filled with the lattice.
+struct CellCost {
+  uint64_t surfaces {0};
+  uint64_t crossings {0};
+  uint64_t lookups {0};
+  uint64_t lattice {0};
+
+  void add(const CellCost& other) {
+    surfaces += other.surfaces;
+    crossings += other.crossings;
+    lookups += other.lookups;
+    lattice += other.lattice;
+  }
+};
+
+// Per-pixel traversal cost of the last frame traced with cost counting, and
+// its aggregates per cell and universe. Cells are counted per thread and
+// merged once the frame is done, so the rays don't share any counters.
+class CostMap {
+public:
+  enum class Metric {
+    Time,
+    Surfaces,
+    Crossings,
+    Lookups,
+    Lattice
+  };
+  static constexpr int n_metrics = 5;
+
+  static const char* metric_name(Metric metric) {
+    static const char* names[n_metrics] = {"Time", "Surfaces tested", "Boundary crossings", "Cell lookups",
+                                           "Lattice crossings"};
+    return names[static_cast<int>(metric)];
+  }
+
+  // Number of surfaces in each cell's region, once per model
+  bool built() const { return built_; }
+  void build() {
+    const auto& cells = openmc::model::cells;
+    cell_surfaces_.resize(cells.size());
+    for (size_t c = 0; c < cells.size(); c++) {
+      cell_surfaces_[c] = static_cast<uint32_t>(cells[c]->surfaces().size());
+    }
+    // a ray starting outside of the model tests all root universe cells
+    root_surfaces_ = 0;
+    for (int32_t c : openmc::model::universes[openmc::model::root_universe]->cells_) {
+      root_surfaces_ += cell_surfaces_[c];
+    }
+    built_ = true;
+  }
+
+  void clear() {
+    built_ = false;
+    cell_surfaces_.clear();
+    pixels_.clear();
+    threads_.clear();
+    cells_.clear();
+    universes_.clear();
+    width_ = 0;
+    height_ = 0;
+  }
+
+  uint32_t cell_surfaces(int32_t cell) const { return cell_surfaces_[cell]; }
+  uint32_t root_surfaces() const { return root_surfaces_; }
+
+  // Reset the counters for a width x height frame traced by n_threads
+  void begin(int width, int height, int n_threads) {
+    width_ = width;
+    height_ = height;
+    pixels_.assign(static_cast<size_t>(width) * height, RayCost());
+    threads_.resize(n_threads);
+    for (auto& cells : threads_) cells.assign(cell_surfaces_.size(), CellCost());
+  }
+
+  CellCost* cells(int thread) { return threads_[thread].data(); }
+  void store(size_t pixel, const RayCost& cost) { pixels_[pixel] = cost; }
+
+  // Merge the per-thread counters into cell, universe and frame totals
+  void finish() {
+    cells_.assign(cell_surfaces_.size(), CellCost());
+    for (const auto& cells : threads_) {
+      for (size_t c = 0; c < cells.size(); c++) cells_[c].add(cells[c]);
+    }
+    universes_.assign(openmc::model::universes.size(), CellCost());
+    total_ = CellCost();
+    for (size_t c = 0; c < cells_.size(); c++) {
+      int32_t universe = openmc::model::cells[c]->universe_;
+      if (universe >= 0 && static_cast<size_t>(universe) < universes_.size()) universes_[universe].add(cells_[c]);
+    }
+    time_ms_ = 0.0;
+    for (const auto& p : pixels_) {
+      total_.surfaces += p.surfaces;
+      total_.crossings += p.crossings;
+      total_.lookups += p.lookups;
+      total_.lattice += p.lattice;
+      time_ms_ += p.time_us * 1e-3;
+    }
+  }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  bool empty() const { return pixels_.empty(); }
+  const RayCost& pixel(size_t index) const { return pixels_[index]; }
+  const std::vector<CellCost>& cells() const { return cells_; }
+  const std::vector<CellCost>& universes() const { return universes_; }
+  const CellCost& total() const { return total_; }
+  double time_ms() const { return time_ms_; }  // summed over all rays
+
+  static double value(const RayCost& cost, Metric metric) {
+    switch (metric) {
+    case Metric::Time: return cost.time_us;
+    case Metric::Surfaces: return cost.surfaces;
+    case Metric::Crossings: return cost.crossings;
+    case Metric::Lookups: return cost.lookups;
+    case Metric::Lattice: return cost.lattice;
+    }
+    return 0.0;
+  }
+
+  // Cell or universe total of a metric, time isn't attributed per cell
+  static double value(const CellCost& cost, Metric metric) {
+    switch (metric) {
+    case Metric::Time:
+    case Metric::Surfaces: return static_cast<double>(cost.surfaces);
+    case Metric::Crossings: return static_cast<double>(cost.crossings);
+    case Metric::Lookups: return static_cast<double>(cost.lookups);
+    case Metric::Lattice: return static_cast<double>(cost.lattice);
+    }
+    return 0.0;
+  }
+
+  // Largest per-pixel value of a metric in the frame
+  double max_value(Metric metric) const {
+    double m = 0.0;
+    for (const auto& p : pixels_) m = std::max(m, value(p, metric));
+    return m;
+  }
+
+  // Replace the colors of a frame of the same size with a heatmap of the
+  // metric, scaled to its maximum linearly or logarithmically
+  void draw(Frame& frame, Metric metric, bool log_scale, ThreadPool& pool) const {
+    if (frame.width != width_ || frame.height != height_ || frame.y0 != 0) return;
+    double upper = max_value(metric);
+    auto scale = [log_scale](double v) { return log_scale ? std::log1p(v) : v; };
+    double range = upper > 0.0 ? scale(upper) : 1.0;
+    pool.parallel_for(frame.height, [&](size_t row, int) {
+      for (int col = 0; col < frame.width; col++) {
+        size_t p = frame.index(col, static_cast<int>(row));
+        frame.color[p] = heat_colormap(scale(value(pixels_[p], metric)) / range);
+      }
+    });
+  }
+
+  // Inferno-like colormap for t in [0, 1]
+  static openmc::RGBColor heat_colormap(double t) {
+    static const double stops[][3] = {
+      {0, 0, 4}, {87, 16, 110}, {188, 55, 84}, {249, 142, 9}, {252, 255, 164}};
+    const int n = sizeof(stops) / sizeof(stops[0]);
+    t = std::max(0.0, std::min(1.0, t)) * (n - 1);
+    int i = std::min(n - 2, static_cast<int>(t));
+    double f = t - i;
+    return openmc::RGBColor(static_cast<int>(stops[i][0] + f * (stops[i + 1][0] - stops[i][0]) + 0.5),
+                            static_cast<int>(stops[i][1] + f * (stops[i + 1][1] - stops[i][1]) + 0.5),
+                            static_cast<int>(stops[i][2] + f * (stops[i + 1][2] - stops[i][2]) + 0.5));
+  }
+
+private:
+  bool built_ {false};
+  std::vector<uint32_t> cell_surfaces_;
+  uint32_t root_surfaces_ {0};
+  int width_ {0};
+  int height_ {0};
+  std::vector<RayCost> pixels_;
+  std::vector<std::vector<CellCost>> threads_;
+  std::vector<CellCost> cells_;
+  std::vector<CellCost> universes_;
+  CellCost total_;
+  double time_ms_ {0.0};
+};
+
+#endif // include guard
@@ -0,0 +1,83 @@
+#ifndef OPENMC_RENDER_FILE_WATCH_H
+#define OPENMC_RENDER_FILE_WATCH_H
+
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Polls a set of files for modifications. Editors often save files in several
+// steps, so a change is only reported once the files have stopped changing
+// for the settle time.
+class FileWatcher {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  FileWatcher(std::vector<fs::path> files,
+              std::chrono::milliseconds settle = std::chrono::milliseconds(300))
+    : files_(std::move(files)), settle_(settle) {
+    snapshot_ = stamp();
+  }
+
+  const std::vector<fs::path>& files() const { return files_; }
+
+  // Returns true once per settled modification of any watched file
+  bool changed() {
+    auto now = Clock::now();
+    if (now - last_poll_ < poll_interval_) return false;
+    last_poll_ = now;
+
+    auto current = stamp();
+    if (current == snapshot_) {
+      pending_ = false;
+      return false;
+    }
+
+    if (!pending_ || current != pending_stamp_) {
+      // new or continuing modification, wait for it to settle
+      pending_ = true;
+      pending_stamp_ = current;
+      pending_since_ = now;
+      return false;
+    }
+
+    if (now - pending_since_ < settle_) return false;
+
+    snapshot_ = current;
+    pending_ = false;
+    return true;
+  }
+
+private:
+  struct FileStamp {
+    fs::file_time_type mtime;
+    std::uintmax_t size;
+    bool operator==(const FileStamp& other) const { return mtime == other.mtime && size == other.size; }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+  };
+
+  std::vector<FileStamp> stamp() const {
+    std::vector<FileStamp> stamps;
+    for (const auto& file : files_) {
+      std::error_code ec;
+      FileStamp s {fs::last_write_time(file, ec), 0};
+      // a file may briefly disappear while it is being replaced
+      s.size = ec ? 0 : fs::file_size(file, ec);
+      stamps.push_back(s);
+    }
+    return stamps;
+  }
+
+  std::vector<fs::path> files_;
+  std::chrono::milliseconds settle_;
+  std::chrono::milliseconds poll_interval_ {100};
+  std::vector<FileStamp> snapshot_;
+  std::vector<FileStamp> pending_stamp_;
+  bool pending_ {false};
+  Clock::time_point pending_since_;
+  Clock::time_point last_poll_;
+};
+
+#endif // include guard
@@ -0,0 +1,168 @@
+#ifndef OPENMC_RENDER_FRAME_H
+#define OPENMC_RENDER_FRAME_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "openmc/plot.h"
+
+// Pixels of one frame channel, either owned or a caller's buffer that is
+// written in place (see Frame::wrap)
+template<typename T>
+class PixelBuffer {
+public:
+  PixelBuffer() = default;
+
+  PixelBuffer(const PixelBuffer& other)
+    : owned_(other.owned_), data_(other.external_ ? other.data_ : owned_.data()), size_(other.size_),
+      external_(other.external_) {}
+
+  PixelBuffer(PixelBuffer&& other) noexcept
+    : owned_(std::move(other.owned_)), data_(other.data_), size_(other.size_), external_(other.external_) {
+    other.reset();
+  }
+
+  PixelBuffer& operator=(const PixelBuffer& other) {
+    if (this != &other) {
+      owned_ = other.owned_;
+      data_ = other.external_ ? other.data_ : owned_.data();
+      size_ = other.size_;
+      external_ = other.external_;
+    }
+    return *this;
+  }
+
+  PixelBuffer& operator=(PixelBuffer&& other) noexcept {
+    if (this != &other) {
+      owned_ = std::move(other.owned_);
+      data_ = other.data_;
+      size_ = other.size_;
+      external_ = other.external_;
+      other.reset();
+    }
+    return *this;
+  }
+
+  // Own n pixels set to value, releasing a wrapped buffer
+  void assign(size_t n, const T& value) {
+    owned_.assign(n, value);
+    data_ = owned_.data();
+    size_ = n;
+    external_ = false;
+  }
+
+  // Write to n pixels at data from now on, without copying anything
+  void wrap(T* data, size_t n) {
+    owned_.clear();
+    owned_.shrink_to_fit();
+    data_ = data;
+    size_ = data ? n : 0;
+    external_ = true;
+  }
+
+  T& operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  T* begin() { return data_; }
+  T* end() { return data_ + size_; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  void reset() {
+    owned_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    external_ = false;
+  }
+
+  std::vector<T> owned_;
+  T* data_ {nullptr};
+  size_t size_ {0};
+  bool external_ {false};
+};
+
+// A traced image along with its G-buffer. Pixels are stored row by row with
+// the same layout as OpenMCPlotter::create_image, i.e. row = vertical pixel.
+// A frame may also hold a horizontal strip of a larger image, in which case
+// y0 is the image row of its first row.
+struct Frame {
+  int width {0};
+  int height {0};
+  int y0 {0};
+
+  PixelBuffer<openmc::RGBColor> color;
+  PixelBuffer<int32_t> cell_id;      // ID of the first visible cell, -1 for background
+  PixelBuffer<int32_t> material_id;  // ID of its material, -1 for background or void
+  PixelBuffer<float> depth;          // distance from the camera, infinity for background
+
+  // Without a G-buffer only colors are stored, e.g. for poster strips
+  void resize(int w, int h, bool gbuffer = true) {
+    width = w;
+    height = h;
+    size_t n = static_cast<size_t>(w) * h;
+    color.assign(n, openmc::WHITE);
+    cell_id.assign(gbuffer ? n : 0, -1);
+    material_id.assign(gbuffer ? n : 0, -1);
+    depth.assign(gbuffer ? n : 0, std::numeric_limits<float>::infinity());
+  }
+
+  // Trace into buffers owned by the caller, each of w * h pixels. The
+  // G-buffer pointers must be all null (colors only) or all set.
+  void wrap(int w, int h, openmc::RGBColor* rgb, int32_t* cells, int32_t* materials, float* depths) {
+    width = w;
+    height = h;
+    y0 = 0;
+    size_t n = static_cast<size_t>(w) * h;
+    color.wrap(rgb, n);
+    cell_id.wrap(cells, n);
+    material_id.wrap(materials, n);
+    depth.wrap(depths, n);
+  }
+
+  bool has_gbuffer() const { return !cell_id.empty(); }
+
+  // Mark a pixel as not covered by any visible geometry
+  void set_background(size_t pixel, openmc::RGBColor background) {
+    color[pixel] = background;
+    if (!has_gbuffer()) return;
+    cell_id[pixel] = -1;
+    material_id[pixel] = -1;
+    depth[pixel] = std::numeric_limits<float>::infinity();
+  }
+
+  // Index of an image pixel, the row is relative to the full image
+  size_t index(int col, int row) const {
+    return static_cast<size_t>(row - y0) * width + col;
+  }
+
+  size_t size() const {
+    return static_cast<size_t>(width) * height;
+  }
+};
+
+// A rectangular block of image pixels traced as one unit of work
+struct Tile {
+  int x0, y0;
+  int width, height;
+};
+
+// Split image rows [row_begin, row_end) of an image into tiles
+inline std::vector<Tile> make_tiles(int width, int row_begin, int row_end, int tile_size) {
+  std::vector<Tile> tiles;
+  for (int y = row_begin; y < row_end; y += tile_size) {
+    for (int x = 0; x < width; x += tile_size) {
+      tiles.push_back({x, y, std::min(tile_size, width - x), std::min(tile_size, row_end - y)});
+    }
+  }
+  return tiles;
+}
+
+#endif // include guard
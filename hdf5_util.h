@@ -0,0 +1,138 @@
+#ifndef OPENMC_RENDER_HDF5_UTIL_H
+#define OPENMC_RENDER_HDF5_UTIL_H
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hdf5.h>
+
+// Small helpers for reading OpenMC's HDF5 output files
+namespace h5 {
+
+// HDF5 is usually built without thread safety, so every call has to hold
+// this lock when files are read from more than one thread
+inline std::mutex& mutex() {
+  static std::mutex m;
+  return m;
+}
+
+// Owner of an HDF5 identifier
+class Handle {
+public:
+  Handle() = default;
+  Handle(hid_t id, herr_t (*close)(hid_t)) : id_(id), close_(close) {}
+  Handle(Handle&& other) noexcept : id_(other.id_), close_(other.close_) { other.id_ = -1; }
+  Handle& operator=(Handle&& other) noexcept {
+    std::swap(id_, other.id_);
+    std::swap(close_, other.close_);
+    return *this;
+  }
+  Handle(const Handle&) = delete;
+  Handle& operator=(const Handle&) = delete;
+  ~Handle() {
+    if (id_ >= 0) close_(id_);
+  }
+
+  bool valid() const { return id_ >= 0; }
+  operator hid_t() const { return id_; }
+
+private:
+  hid_t id_ {-1};
+  herr_t (*close_)(hid_t) {nullptr};
+};
+
+// Values of an attribute, empty if it doesn't exist
+template<typename T>
+std::vector<T> read_attribute(hid_t object, const char* name, hid_t memory_type) {
+  std::vector<T> values;
+  if (H5Aexists(object, name) <= 0) return values;
+  Handle attr(H5Aopen(object, name, H5P_DEFAULT), H5Aclose);
+  Handle space(H5Aget_space(attr), H5Sclose);
+  values.resize(H5Sget_simple_extent_npoints(space));
+  if (!values.empty()) H5Aread(attr, memory_type, values.data());
+  return values;
+}
+
+template<typename T>
+std::vector<T> read_dataset(hid_t group, const char* name, hid_t memory_type) {
+  Handle dataset(H5Dopen2(group, name, H5P_DEFAULT), H5Dclose);
+  if (!dataset.valid()) {
+    throw std::runtime_error(std::string("Missing dataset ") + name);
+  }
+  Handle space(H5Dget_space(dataset), H5Sclose);
+  std::vector<T> values(H5Sget_simple_extent_npoints(space));
+  if (!values.empty()) H5Dread(dataset, memory_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.data());
+  return values;
+}
+
+// Fixed or variable length strings of a dataset or attribute
+inline std::vector<std::string> read_strings(hid_t object, bool attribute) {
+  Handle type(attribute ? H5Aget_type(object) : H5Dget_type(object), H5Tclose);
+  Handle space(attribute ? H5Aget_space(object) : H5Dget_space(object), H5Sclose);
+  size_t n = H5Sget_simple_extent_npoints(space);
+  std::vector<std::string> strings;
+  if (n == 0) return strings;
+
+  if (H5Tis_variable_str(type) > 0) {
+    Handle memory_type(H5Tcopy(H5T_C_S1), H5Tclose);
+    H5Tset_size(memory_type, H5T_VARIABLE);
+    std::vector<char*> buffer(n, nullptr);
+    herr_t err = attribute ? H5Aread(object, memory_type, buffer.data())
+                           : H5Dread(object, memory_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data());
+    if (err >= 0) {
+      for (char* s : buffer) strings.emplace_back(s ? s : "");
+#if H5_VERSION_GE(1, 12, 0)
+      H5Treclaim(memory_type, space, H5P_DEFAULT, buffer.data());
+#else
+      H5Dvlen_reclaim(memory_type, space, H5P_DEFAULT, buffer.data());
+#endif
+    }
+  } else {
+    size_t size = H5Tget_size(type);
+    Handle memory_type(H5Tcopy(H5T_C_S1), H5Tclose);
+    H5Tset_size(memory_type, size);
+    std::vector<char> buffer(n * size);
+    herr_t err = attribute ? H5Aread(object, memory_type, buffer.data())
+                           : H5Dread(object, memory_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer.data());
+    if (err >= 0) {
+      for (size_t i = 0; i < n; i++) {
+        const char* s = buffer.data() + i * size;
+        strings.emplace_back(s, strnlen(s, size));
+      }
+    }
+  }
+  for (auto& s : strings) {
+    s.erase(s.find_last_not_of(' ') + 1);
+  }
+  return strings;
+}
+
+inline std::string read_string_attribute(hid_t object, const char* name) {
+  if (H5Aexists(object, name) <= 0) return {};
+  Handle attr(H5Aopen(object, name, H5P_DEFAULT), H5Aclose);
+  auto strings = read_strings(attr, true);
+  return strings.empty() ? std::string() : strings[0];
+}
+
+inline std::vector<std::string> read_string_array(hid_t group, const char* name) {
+  if (H5Lexists(group, name, H5P_DEFAULT) <= 0) return {};
+  Handle dataset(H5Dopen2(group, name, H5P_DEFAULT), H5Dclose);
+  return read_strings(dataset, false);
+}
+
+// String stored as a dataset or, by some OpenMC versions, an attribute
+inline std::string read_string_dataset(hid_t group, const char* name) {
+  if (H5Lexists(group, name, H5P_DEFAULT) <= 0) {
+    return read_string_attribute(group, name);
+  }
+  auto strings = read_string_array(group, name);
+  return strings.empty() ? std::string() : strings[0];
+}
+
+} // namespace h5
+
+#endif // include guard
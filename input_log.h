@@ -0,0 +1,262 @@
+#ifndef OPENMC_RENDER_INPUT_LOG_H
+#define OPENMC_RENDER_INPUT_LOG_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One input event reaching the renderer, or a snapshot of the view state
+// after a change made through the UI. Times are seconds since the start of
+// the recording.
+struct InputEvent {
+  enum class Type {
+    Button,
+    Cursor,
+    Scroll,
+    Key,
+    State
+  };
+
+  double time {0.0};
+  Type type {Type::Cursor};
+  int code {0};      // mouse button or key
+  int scancode {0};
+  int action {0};
+  int mods {0};
+  double x {0.0};    // cursor position or scroll offset
+  double y {0.0};
+  std::string state;  // saved view state, for State events
+};
+
+// Writes input events to a text file as they happen, one per line:
+//   <time> button <button> <action> <mods> <x> <y>
+//   <time> cursor <x> <y>
+//   <time> scroll <xoffset> <yoffset>
+//   <time> key <key> <scancode> <action> <mods>
+//   <time> state <n>   followed by n lines of view state
+class InputRecorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  bool open(const std::string& path) {
+    out_.open(path);
+    if (!out_) return false;
+    out_ << "# omc-render input log 1\n" << std::setprecision(17);
+    start_ = Clock::now();
+    return true;
+  }
+
+  bool active() const { return out_.is_open(); }
+
+  void close() {
+    if (out_.is_open()) out_.close();
+  }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  void record(const InputEvent& event) {
+    if (!active()) return;
+    out_ << event.time << " ";
+    switch (event.type) {
+    case InputEvent::Type::Button:
+      out_ << "button " << event.code << " " << event.action << " " << event.mods << " " << event.x << " " << event.y;
+      break;
+    case InputEvent::Type::Cursor:
+      out_ << "cursor " << event.x << " " << event.y;
+      break;
+    case InputEvent::Type::Scroll:
+      out_ << "scroll " << event.x << " " << event.y;
+      break;
+    case InputEvent::Type::Key:
+      out_ << "key " << event.code << " " << event.scancode << " " << event.action << " " << event.mods;
+      break;
+    case InputEvent::Type::State: {
+      size_t lines = std::count(event.state.begin(), event.state.end(), '\n');
+      if (!event.state.empty() && event.state.back() != '\n') lines++;
+      out_ << "state " << lines << "\n" << event.state;
+      if (!event.state.empty() && event.state.back() != '\n') out_ << "\n";
+      return;
+    }
+    }
+    out_ << "\n";
+  }
+
+  // Event of the given type stamped with the current time
+  InputEvent event(InputEvent::Type type) const {
+    InputEvent e;
+    e.time = elapsed();
+    e.type = type;
+    return e;
+  }
+
+private:
+  std::ofstream out_;
+  Clock::time_point start_;
+};
+
+// Percentiles of a set of durations in milliseconds
+struct LatencySummary {
+  size_t count {0};
+  double mean {0.0};
+  double p50 {0.0};
+  double p90 {0.0};
+  double p99 {0.0};
+  double max {0.0};
+
+  static LatencySummary of(std::vector<double> values) {
+    LatencySummary s;
+    s.count = values.size();
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+      size_t i = static_cast<size_t>(std::ceil(p * values.size())) - 1;
+      return values[std::min(i, values.size() - 1)];
+    };
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    s.mean = sum / values.size();
+    s.p50 = percentile(0.5);
+    s.p90 = percentile(0.9);
+    s.p99 = percentile(0.99);
+    s.max = values.back();
+    return s;
+  }
+
+  void print(std::ostream& os, const std::string& name) const {
+    os << "  " << std::left << std::setw(22) << name << std::right << std::setw(7) << count
+       << std::fixed << std::setprecision(2) << std::setw(9) << mean << std::setw(9) << p50
+       << std::setw(9) << p90 << std::setw(9) << p99 << std::setw(9) << max << std::defaultfloat << std::endl;
+  }
+};
+
+// Plays back a recorded input log at its original pace. Every event is due
+// at its recorded time after start(); events that are due are handed out at
+// the beginning of a frame, and the latency of each is the time from when it
+// was due to the end of the first frame presented after it was handled, so
+// frames that take too long show up as queueing delay.
+class InputReplay {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  bool load(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+      error = "Can't read " + path;
+      return false;
+    }
+    events_.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+      line_number++;
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream values(line);
+      InputEvent e;
+      std::string type;
+      values >> e.time >> type;
+      bool ok = true;
+      if (type == "button") {
+        e.type = InputEvent::Type::Button;
+        ok = static_cast<bool>(values >> e.code >> e.action >> e.mods >> e.x >> e.y);
+      } else if (type == "cursor") {
+        e.type = InputEvent::Type::Cursor;
+        ok = static_cast<bool>(values >> e.x >> e.y);
+      } else if (type == "scroll") {
+        e.type = InputEvent::Type::Scroll;
+        ok = static_cast<bool>(values >> e.x >> e.y);
+      } else if (type == "key") {
+        e.type = InputEvent::Type::Key;
+        ok = static_cast<bool>(values >> e.code >> e.scancode >> e.action >> e.mods);
+      } else if (type == "state") {
+        e.type = InputEvent::Type::State;
+        int n = 0;
+        ok = static_cast<bool>(values >> n);
+        for (int i = 0; ok && i < n; i++) {
+          std::string state_line;
+          ok = static_cast<bool>(std::getline(in, state_line));
+          line_number++;
+          e.state += state_line + "\n";
+        }
+      } else {
+        ok = false;
+      }
+      if (!ok) {
+        error = path + ":" + std::to_string(line_number) + ": invalid event";
+        return false;
+      }
+      events_.push_back(std::move(e));
+    }
+    return true;
+  }
+
+  void start() {
+    start_ = Clock::now();
+    last_frame_ = start_;
+    next_ = 0;
+    handled_.clear();
+    latencies_.clear();
+    frame_times_.clear();
+    active_ = true;
+  }
+
+  bool active() const { return active_; }
+  bool finished() const { return active_ && next_ == events_.size() && handled_.empty(); }
+  size_t size() const { return events_.size(); }
+
+  // Pass every event that is due to handle(event)
+  template<typename F>
+  void dispatch(F&& handle) {
+    double now = elapsed();
+    while (next_ < events_.size() && events_[next_].time <= now) {
+      const InputEvent& e = events_[next_++];
+      handle(e);
+      if (e.type != InputEvent::Type::State) handled_.push_back(e.time);
+    }
+  }
+
+  // A frame showing the effect of the events handled so far is on screen
+  void frame_presented() {
+    auto now = Clock::now();
+    frame_times_.push_back(std::chrono::duration<double, std::milli>(now - last_frame_).count());
+    last_frame_ = now;
+    double t = elapsed();
+    for (double due : handled_) latencies_.push_back(1e3 * (t - due));
+    handled_.clear();
+  }
+
+  void stop() { active_ = false; }
+
+  void report(std::ostream& os) const {
+    os << "Replayed " << events_.size() << " events in " << std::fixed << std::setprecision(2) << elapsed()
+       << std::defaultfloat << " s" << std::endl;
+    os << "  " << std::left << std::setw(22) << "ms" << std::right << std::setw(7) << "count" << std::setw(9)
+       << "mean" << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99" << std::setw(9)
+       << "max" << std::endl;
+    LatencySummary::of(latencies_).print(os, "input to frame");
+    LatencySummary::of(frame_times_).print(os, "frame time");
+  }
+
+private:
+  double elapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  std::vector<InputEvent> events_;
+  size_t next_ {0};
+  std::vector<double> handled_;  // due times of events not on screen yet
+  std::vector<double> latencies_;
+  std::vector<double> frame_times_;
+  Clock::time_point start_;
+  Clock::time_point last_frame_;
+  bool active_ {false};
+};
+
+#endif // include guard
@@ -0,0 +1,154 @@
+#ifndef OPENMC_RENDER_LOD_H
+#define OPENMC_RENDER_LOD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/geometry.h"
+#include "openmc/material.h"
+#include "openmc/plot.h"
+
+#include "thread_pool.h"
+
+// Level-of-detail data for cells filled with a universe or lattice. The
+// content of each filled cell is sampled once: the volume fractions of the
+// cells and materials at the lowest level give a homogenized color, and the
+// mean distance to the next boundary from the samples is the size of its
+// features. Rays entering a filled cell whose features project below a pixel
+// threshold take the homogenized color instead of descending into it.
+// The samples belong to the model and are read-only once built; the colors
+// depend on the settings of a view and live in a View per scene.
+class LodTable {
+public:
+  struct Fill {
+    bool valid {false};
+    double feature_size {0.0};
+    std::vector<std::pair<int32_t, float>> cells;      // lowest level cell index, volume fraction
+    std::vector<std::pair<int32_t, float>> materials;  // material index, volume fraction
+  };
+
+  // Homogenized colors of the fills for one view's colors and visibility
+  class View {
+  public:
+    // Whether rays may stop at cell when its features are size_per_pixel
+    // (length per pixel at the hit distance) times threshold or smaller
+    bool homogenize(int32_t cell, double size_per_pixel, double threshold) const {
+      if (cell < 0 || static_cast<size_t>(cell) >= visible_.size() || !visible_[cell]) return false;
+      return table_->fills_[cell].feature_size < threshold * size_per_pixel;
+    }
+
+    const openmc::RGBColor& color(int32_t cell) const { return color_[cell]; }
+
+  private:
+    friend class LodTable;
+    const LodTable* table_ {nullptr};
+    std::vector<openmc::RGBColor> color_;
+    std::vector<uint8_t> visible_;
+  };
+
+  bool built() const { return built_; }
+  void clear() {
+    built_ = false;
+    fills_.clear();
+  }
+
+  // Sample every filled cell with a finite bounding box
+  void build(ThreadPool& pool, int samples = 256) {
+    size_t n_cells = openmc::model::cells.size();
+    fills_.assign(n_cells, Fill());
+    pool.parallel_for(n_cells, [&](size_t i, int) {
+      const auto& cell = *openmc::model::cells[i];
+      if (cell.type_ != openmc::Fill::MATERIAL) {
+        sample_fill(static_cast<int32_t>(i), samples, fills_[i]);
+      }
+    });
+    built_ = true;
+  }
+
+  // Mix the colors of the visible content of each fill for the view's color
+  // mode. Fills without any visible content are never homogenized.
+  void update_colors(View& view, bool by_material, const std::vector<uint8_t>& visible,
+                     const std::vector<openmc::RGBColor>& colors) const {
+    view.table_ = this;
+    view.color_.assign(fills_.size(), openmc::WHITE);
+    view.visible_.assign(fills_.size(), 0);
+    for (size_t i = 0; i < fills_.size(); i++) {
+      const Fill& fill = fills_[i];
+      if (!fill.valid) continue;
+
+      double rgb[3] = {0.0, 0.0, 0.0};
+      double total = 0.0;
+      for (const auto& part : by_material ? fill.materials : fill.cells) {
+        if (part.first < 0 || static_cast<size_t>(part.first) >= visible.size() || !visible[part.first]) continue;
+        const openmc::RGBColor& c = colors[part.first];
+        rgb[0] += part.second * c.red;
+        rgb[1] += part.second * c.green;
+        rgb[2] += part.second * c.blue;
+        total += part.second;
+      }
+      if (total <= 0.0) continue;
+
+      view.visible_[i] = 1;
+      view.color_[i] = openmc::RGBColor(static_cast<int>(rgb[0] / total + 0.5),
+                                        static_cast<int>(rgb[1] / total + 0.5),
+                                        static_cast<int>(rgb[2] / total + 0.5));
+    }
+  }
+
+  const Fill& fill(int32_t cell) const { return fills_[cell]; }
+
+private:
+  static void sample_fill(int32_t index, int samples, Fill& fill) {
+    const auto& cell = *openmc::model::cells[index];
+    openmc::BoundingBox bb = cell.bounding_box();
+    double lower[3] = {bb.xmin, bb.ymin, bb.zmin};
+    double upper[3] = {bb.xmax, bb.ymax, bb.zmax};
+    for (int i = 0; i < 3; i++) {
+      if (!std::isfinite(lower[i]) || !std::isfinite(upper[i])) return;
+    }
+
+    std::mt19937_64 rng(index);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::map<int32_t, int> cell_counts;
+    std::map<int32_t, int> material_counts;
+    double distance_sum = 0.0;
+    int hits = 0;
+
+    // rejection sampling of the cell's bounding box in its universe's frame
+    openmc::GeometryState g;
+    for (int attempt = 0; attempt < 8 * samples && hits < samples; attempt++) {
+      g.n_coord() = 1;
+      g.coord(0).universe = cell.universe_;
+      g.r() = {lower[0] + uniform(rng) * (upper[0] - lower[0]),
+               lower[1] + uniform(rng) * (upper[1] - lower[1]),
+               lower[2] + uniform(rng) * (upper[2] - lower[2])};
+      double mu = 2.0 * uniform(rng) - 1.0;
+      double phi = 2.0 * M_PI * uniform(rng);
+      double s = std::sqrt(1.0 - mu * mu);
+      g.u() = {s * std::cos(phi), s * std::sin(phi), mu};
+
+      if (!openmc::exhaustive_find_cell(g) || g.coord(0).cell != index) continue;
+
+      hits++;
+      cell_counts[g.lowest_coord().cell]++;
+      material_counts[g.material()]++;
+      distance_sum += std::min(openmc::distance_to_boundary(g).distance, 1e10);
+    }
+    if (hits == 0) return;
+
+    fill.valid = true;
+    fill.feature_size = distance_sum / hits;
+    for (const auto& c : cell_counts) fill.cells.emplace_back(c.first, static_cast<float>(c.second) / hits);
+    for (const auto& m : material_counts) fill.materials.emplace_back(m.first, static_cast<float>(m.second) / hits);
+  }
+
+  bool built_ {false};
+  std::vector<Fill> fills_;
+};
+
+#endif // include guard
@@ -2,6 +2,12 @@
 
 // Entry point for the OpenMC Renderer application
 int main(int argc, char* argv[]) {
+    // the model check of a watched reload, see check_model_init
+    if (argc > 1 && std::strcmp(argv[1], CHECK_MODEL_ARG) == 0) {
+        argv[1] = argv[0];
+        return OpenMCPlotter::check_model(argc - 1, argv + 1);
+    }
+
     try {
         // Create the renderer instance using modern C++ memory management
         auto renderer = std::make_unique<OpenMCRenderer>(argc, argv);
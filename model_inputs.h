@@ -0,0 +1,168 @@
+#ifndef OPENMC_RENDER_MODEL_INPUTS_H
+#define OPENMC_RENDER_MODEL_INPUTS_H
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pugixml.hpp"
+
+namespace fs = std::filesystem;
+
+// Determine the model path OpenMC will read from its command line arguments
+// (the first positional argument, defaulting to the working directory)
+inline fs::path model_input_path(const std::vector<std::string>& openmc_args) {
+  for (size_t i = 1; i < openmc_args.size(); i++) {
+    const std::string& arg = openmc_args[i];
+    // options that consume the following argument
+    if (arg == "-n" || arg == "--particles" || arg == "-r" || arg == "--restart" ||
+        arg == "-s" || arg == "--threads") {
+      i++;
+      continue;
+    }
+    if (!arg.empty() && arg[0] == '-') continue;
+    return fs::path(arg);
+  }
+  return fs::current_path();
+}
+
+// The XML files that define the model at the given path. A single model.xml
+// takes precedence over the separate XML files, as it does in OpenMC.
+inline std::vector<fs::path> model_input_files(const fs::path& input_path) {
+  std::vector<fs::path> files;
+
+  if (fs::is_regular_file(input_path)) {
+    files.push_back(input_path);
+    return files;
+  }
+
+  fs::path model_xml = input_path / "model.xml";
+  if (fs::exists(model_xml)) {
+    files.push_back(model_xml);
+    return files;
+  }
+
+  for (const char* name : {"settings.xml", "materials.xml", "geometry.xml", "plots.xml", "tallies.xml"}) {
+    fs::path file = input_path / name;
+    if (fs::exists(file)) {
+      files.push_back(file);
+    }
+  }
+  return files;
+}
+
+// Whether the model at the given path defines plots, which OpenMC's plotting
+// run mode requires: a plots.xml next to the other files, or a <plots>
+// element in model.xml
+inline bool model_has_plots(const fs::path& input_path) {
+  fs::path model_xml = fs::is_regular_file(input_path) ? input_path : input_path / "model.xml";
+  if (!fs::exists(model_xml)) {
+    return fs::exists(input_path / "plots.xml");
+  }
+  pugi::xml_document doc;
+  // unparsable files are left for OpenMC to report
+  if (!doc.load_file(model_xml.c_str())) return true;
+  return static_cast<bool>(doc.document_element().child("plots"));
+}
+
+// Check that all input files are well-formed XML. OpenMC terminates the
+// process on parse errors, so this is used to reject half-saved files before
+// handing them to openmc_init. Models OpenMC rejects for other reasons are
+// caught by check_model_init. Returns an empty string on success.
+inline std::string validate_model_inputs(const std::vector<fs::path>& files) {
+  for (const auto& file : files) {
+    pugi::xml_document doc;
+    auto result = doc.load_file(file.c_str());
+    if (!result) {
+      return file.filename().string() + ": " + result.description();
+    }
+  }
+  return "";
+}
+
+// First argument of the child process started by check_model_init
+constexpr const char* CHECK_MODEL_ARG = "--check-model";
+
+// A reload was refused because the new model doesn't initialize, the loaded
+// model is still intact
+class ModelRejected : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Run openmc_init on the model in a child process: this executable again,
+// started with CHECK_MODEL_ARG and the given OpenMC arguments (including
+// --plot for the plotting mode). OpenMC's fatal errors exit the process they
+// happen in, so this is how a model can be tried before the loaded one is
+// finalized. Returns an empty string if the child initialized the model,
+// otherwise OpenMC's error messages or the child's exit status.
+inline std::string check_model_init(const std::vector<std::string>& openmc_args) {
+  // everything the child needs is prepared before the fork, after it the
+  // child only calls async-signal-safe functions until exec
+  std::vector<std::string> args = openmc_args;
+  args.insert(args.begin() + 1, CHECK_MODEL_ARG);
+  std::vector<char*> argv;
+  for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  int err_pipe[2];
+  if (null_fd < 0 || pipe2(err_pipe, O_CLOEXEC) != 0) {
+    if (null_fd >= 0) ::close(null_fd);
+    return std::string("can't start the model check: ") + std::strerror(errno);
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // OpenMC's banner and progress go nowhere, its errors to the parent
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(err_pipe[1], STDERR_FILENO);
+    execv("/proc/self/exe", argv.data());
+    _exit(127);
+  }
+  ::close(null_fd);
+  ::close(err_pipe[1]);
+  if (pid < 0) {
+    ::close(err_pipe[0]);
+    return std::string("can't start the model check: ") + std::strerror(errno);
+  }
+
+  std::string output;
+  char buffer[4096];
+  while (true) {
+    ssize_t n = ::read(err_pipe[0], buffer, sizeof(buffer));
+    if (n > 0) {
+      output.append(buffer, n);
+    } else if (n == 0 || errno != EINTR) {
+      break;
+    }
+  }
+  ::close(err_pipe[0]);
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return "";
+
+  // OpenMC's error lines, otherwise the last line of output
+  std::istringstream lines(output);
+  std::string line, errors, last;
+  while (std::getline(lines, line)) {
+    if (line.find_first_not_of(" \t") == std::string::npos) continue;
+    last = line.substr(line.find_first_not_of(" \t"));
+    if (line.find("ERROR") != std::string::npos) errors += (errors.empty() ? "" : "\n") + last;
+  }
+  if (!errors.empty()) return errors;
+  if (WIFSIGNALED(status)) return "the model check was killed by signal " + std::to_string(WTERMSIG(status));
+  if (!last.empty()) return last;
+  return "the model check exited with status " + std::to_string(WEXITSTATUS(status));
+}
+
+#endif // include guard
@@ -0,0 +1,288 @@
+#include "omc_render.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "options.h"
+#include "plotter.h"
+#include "scene.h"
+#include "timing.h"
+
+static_assert(sizeof(openmc::RGBColor) == 3, "RGB buffers are written as openmc::RGBColor");
+
+struct omc_render_context {
+  OpenMCPlotter& plotter;
+  RenderOptions options;
+  std::mutex scenes_mutex;
+  std::vector<std::unique_ptr<omc_render_scene>> scenes;
+};
+
+struct omc_render_scene {
+  omc_render_context* context;
+  Scene scene;
+
+  // ID-keyed settings per color mode (cells, materials), applied to the
+  // plot's index-based colors and opaque set before every render
+  std::unordered_map<int32_t, openmc::RGBColor> colors[2];
+  std::unordered_map<int32_t, bool> visibility[2];
+
+  // Missing buffers are traced into scratch storage kept between renders:
+  // colors are always computed, and the G-buffer channels go together
+  PixelBuffer<openmc::RGBColor> scratch_rgb;
+  PixelBuffer<int32_t> scratch_cells, scratch_materials;
+  PixelBuffer<float> scratch_depth;
+};
+
+static omc_render_context* active_context = nullptr;
+
+static std::string& last_error() {
+  thread_local std::string error;
+  return error;
+}
+
+static int fail(int code, const std::string& message) {
+  last_error() = message;
+  return code;
+}
+
+// Run f, turning exceptions into status codes at the C boundary
+template<typename T, typename F>
+static int guarded(T* handle, F&& f) {
+  if (!handle) return fail(OMC_RENDER_E_INVALID, "Null handle");
+  try {
+    return f();
+  } catch (const std::exception& e) {
+    return fail(OMC_RENDER_E_INVALID, e.what());
+  }
+}
+
+static int mode_index(const omc_render_scene* scene) {
+  return scene->scene.by_material() ? 1 : 0;
+}
+
+// Make everything of the current mode visible, then apply the stored
+// colors and visibility of its IDs
+static void apply_settings(omc_render_scene* scene) {
+  Scene& view = scene->scene;
+  int mode = mode_index(scene);
+  size_t n = mode == 1 ? openmc::model::materials.size() : openmc::model::cells.size();
+  auto& opaque = view.plot()->opaque_ids();
+  opaque.clear();
+  for (size_t i = 0; i < n; i++) opaque.insert(static_cast<int>(i));
+  for (const auto& [id, color] : scene->colors[mode]) view.set_color(id, color);
+  for (const auto& [id, visible] : scene->visibility[mode]) view.set_material_visibility(id, visible);
+}
+
+// Apply the settings of the scene and point frame at the buffers, or at
+// the scene's scratch storage for the missing ones
+static int prepare(omc_render_scene* scene, const omc_render_buffers* buffers, Frame& frame) {
+  if (!buffers || buffers->width <= 0 || buffers->height <= 0) {
+    return fail(OMC_RENDER_E_INVALID, "Invalid buffer size");
+  }
+  int width = buffers->width;
+  int height = buffers->height;
+  size_t n = static_cast<size_t>(width) * height;
+
+  auto scratch = [n](auto& buffer, auto value) {
+    if (buffer.size() != n) buffer.assign(n, value);
+    return buffer.data();
+  };
+  bool gbuffer = buffers->cell_id || buffers->material_id || buffers->depth;
+  auto* rgb = buffers->rgb ? reinterpret_cast<openmc::RGBColor*>(buffers->rgb)
+                           : scratch(scene->scratch_rgb, openmc::WHITE);
+  int32_t* cells = buffers->cell_id ? buffers->cell_id : gbuffer ? scratch(scene->scratch_cells, -1) : nullptr;
+  int32_t* materials = buffers->material_id ? buffers->material_id
+                                            : gbuffer ? scratch(scene->scratch_materials, -1) : nullptr;
+  float* depth = buffers->depth ? buffers->depth
+                                : gbuffer ? scratch(scene->scratch_depth, std::numeric_limits<float>::infinity())
+                                          : nullptr;
+
+  apply_settings(scene);
+  scene->scene.set_pixels(width, height);
+  frame.wrap(width, height, rgb, cells, materials, depth);
+  return OMC_RENDER_OK;
+}
+
+static openmc::Position position(const double p[3]) {
+  return {p[0], p[1], p[2]};
+}
+
+extern "C" {
+
+int omc_render_create(int argc, char* argv[], omc_render_context** context) {
+  if (!context) return fail(OMC_RENDER_E_INVALID, "Null context pointer");
+  *context = nullptr;
+  if (active_context) return fail(OMC_RENDER_E_BUSY, "A render context already exists");
+
+  try {
+    RenderOptions options = parse_render_options(argc, argv);
+    auto args = options.openmc_argv();
+    OpenMCPlotter& plotter = OpenMCPlotter::get_instance();
+    PhaseTimer timer;
+    plotter.initialize(static_cast<int>(options.openmc_args.size()), args.data(), timer);
+    plotter.pool().configure(options.threads);
+    active_context = new omc_render_context {plotter, std::move(options), {}, {}};
+  } catch (const std::exception& e) {
+    return fail(OMC_RENDER_E_OPENMC, e.what());
+  }
+  *context = active_context;
+  return OMC_RENDER_OK;
+}
+
+void omc_render_destroy(omc_render_context* context) {
+  if (!context || context != active_context) return;
+  // the scenes' plots go before the model they refer to
+  context->scenes.clear();
+  try {
+    PhaseTimer timer;
+    context->plotter.finalize(timer);
+  } catch (const std::exception& e) {
+    last_error() = e.what();
+  }
+  delete context;
+  active_context = nullptr;
+}
+
+int omc_render_scene_create(omc_render_context* context, omc_render_scene** scene) {
+  if (!scene) return fail(OMC_RENDER_E_INVALID, "Null scene pointer");
+  *scene = nullptr;
+  return guarded(context, [&]() {
+    auto created = std::make_unique<omc_render_scene>();
+    created->context = context;
+    created->scene = context->plotter.create_scene();
+    *scene = created.get();
+    std::lock_guard<std::mutex> lock(context->scenes_mutex);
+    context->scenes.push_back(std::move(created));
+    return OMC_RENDER_OK;
+  });
+}
+
+void omc_render_scene_destroy(omc_render_scene* scene) {
+  if (!scene) return;
+  omc_render_context* context = scene->context;
+  std::lock_guard<std::mutex> lock(context->scenes_mutex);
+  auto& scenes = context->scenes;
+  scenes.erase(std::remove_if(scenes.begin(), scenes.end(), [scene](const auto& s) { return s.get() == scene; }),
+               scenes.end());
+}
+
+const char* omc_render_last_error(void) {
+  return last_error().c_str();
+}
+
+int omc_render_set_threads(omc_render_context* context, int threads) {
+  return guarded(context, [&]() {
+    if (threads < 0) return fail(OMC_RENDER_E_INVALID, "Negative thread count");
+    context->options.threads.threads = threads;
+    context->plotter.pool().configure(context->options.threads);
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_camera(omc_render_scene* scene, const double position_[3], const double look_at[3],
+                          const double up[3], double fov) {
+  return guarded(scene, [&]() {
+    if (!position_ || !look_at || !up) return fail(OMC_RENDER_E_INVALID, "Null camera vector");
+    if (!(fov > 0.0 && fov < 180.0)) return fail(OMC_RENDER_E_INVALID, "Field of view must be in (0, 180)");
+    openmc::Position camera = position(position_);
+    openmc::Position target = position(look_at);
+    openmc::Direction forward = target - camera;
+    openmc::Direction upward = position(up);
+    if (forward.norm() == 0.0 || forward.cross(upward).norm() == 0.0) {
+      return fail(OMC_RENDER_E_INVALID, "Degenerate camera");
+    }
+    Scene& view = scene->scene;
+    view.set_camera_position(camera);
+    view.set_look_at(target);
+    view.set_up_vector(upward);
+    view.set_field_of_view(fov);
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_light(omc_render_scene* scene, const double position_[3]) {
+  return guarded(scene, [&]() {
+    if (!position_) return fail(OMC_RENDER_E_INVALID, "Null light position");
+    scene->scene.set_light_position(position(position_));
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_color_by(omc_render_scene* scene, int color_by) {
+  return guarded(scene, [&]() {
+    if (color_by != OMC_RENDER_COLOR_BY_CELL && color_by != OMC_RENDER_COLOR_BY_MATERIAL) {
+      return fail(OMC_RENDER_E_INVALID, "Unknown color mode");
+    }
+    auto& plot = scene->scene.plot();
+    auto mode = color_by == OMC_RENDER_COLOR_BY_MATERIAL ? openmc::PlottableInterface::PlotColorBy::mats
+                                                         : openmc::PlottableInterface::PlotColorBy::cells;
+    if (plot->color_by_ != mode) {
+      plot->color_by_ = mode;
+      plot->set_default_colors();
+    }
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_color(omc_render_scene* scene, int32_t id, uint8_t red, uint8_t green, uint8_t blue) {
+  return guarded(scene, [&]() {
+    if (!scene->scene.has_id(id)) return fail(OMC_RENDER_E_INVALID, "Unknown ID " + std::to_string(id));
+    scene->colors[mode_index(scene)][id] = openmc::RGBColor(red, green, blue);
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_visibility(omc_render_scene* scene, int32_t id, int visible) {
+  return guarded(scene, [&]() {
+    if (!scene->scene.has_id(id)) return fail(OMC_RENDER_E_INVALID, "Unknown ID " + std::to_string(id));
+    scene->visibility[mode_index(scene)][id] = visible != 0;
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_set_antialias(omc_render_scene* scene, int enabled) {
+  return guarded(scene, [&]() {
+    scene->scene.antialias() = enabled != 0;
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_render(omc_render_scene* scene, const omc_render_buffers* buffers) {
+  return guarded(scene, [&]() {
+    Frame frame;
+    int err = prepare(scene, buffers, frame);
+    if (err) return err;
+    scene->context->plotter.render_scene(scene->scene, frame);
+    return OMC_RENDER_OK;
+  });
+}
+
+int omc_render_render_batch(omc_render_context* context, int n, omc_render_scene* const* scenes,
+                            const omc_render_buffers* buffers) {
+  return guarded(context, [&]() {
+    if (n < 0 || (n > 0 && (!scenes || !buffers))) return fail(OMC_RENDER_E_INVALID, "Invalid scene list");
+    std::vector<Frame> frames(n);
+    std::vector<Scene*> views;
+    std::vector<Frame*> targets;
+    for (int i = 0; i < n; i++) {
+      if (!scenes[i] || scenes[i]->context != context) return fail(OMC_RENDER_E_INVALID, "Invalid scene");
+      if (std::find(views.begin(), views.end(), &scenes[i]->scene) != views.end()) {
+        return fail(OMC_RENDER_E_INVALID, "Scene listed twice");
+      }
+      int err = prepare(scenes[i], &buffers[i], frames[i]);
+      if (err) return err;
+      views.push_back(&scenes[i]->scene);
+      targets.push_back(&frames[i]);
+    }
+    context->plotter.render_scenes(views, targets);
+    return OMC_RENDER_OK;
+  });
+}
+
+} // extern "C"
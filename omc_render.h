@@ -0,0 +1,92 @@
+#ifndef OPENMC_RENDER_OMC_RENDER_H
+#define OPENMC_RENDER_OMC_RENDER_H
+
+/* Embeddable renderer for OpenMC geometry (libomc_render). Traces the model
+ * into buffers owned by the caller, without any window, GL or ImGui
+ * dependency. OpenMC keeps its model in global state, so only one context
+ * can exist in a process at a time. A context holds any number of scenes,
+ * each with its own camera, light, colors and visibility. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status codes, the message of the last error is omc_render_last_error() */
+#define OMC_RENDER_OK 0
+#define OMC_RENDER_E_INVALID 1  /* invalid argument */
+#define OMC_RENDER_E_OPENMC 2   /* OpenMC failed to load the model */
+#define OMC_RENDER_E_BUSY 3     /* another context exists */
+
+/* Color modes for omc_render_set_color_by */
+#define OMC_RENDER_COLOR_BY_CELL 0
+#define OMC_RENDER_COLOR_BY_MATERIAL 1
+
+typedef struct omc_render_context omc_render_context;
+typedef struct omc_render_scene omc_render_scene;
+
+/* Output of omc_render_render. Pixels are stored row by row from the top
+ * left, each buffer holds width * height pixels. Any buffer may be null;
+ * the G-buffer is only traced if at least one of its buffers is given. */
+typedef struct omc_render_buffers {
+  int width;
+  int height;
+  uint8_t* rgb;          /* 3 bytes per pixel */
+  int32_t* cell_id;      /* ID of the first visible cell, -1 for background */
+  int32_t* material_id;  /* ID of its material, -1 for background or void */
+  float* depth;          /* distance from the camera, infinity for background */
+} omc_render_buffers;
+
+/* Initialize OpenMC with the given arguments (as for the openmc executable,
+ * argv[0] included) in plotting mode, which reads the geometry, materials
+ * and settings but no cross sections. */
+int omc_render_create(int argc, char* argv[], omc_render_context** context);
+
+/* Finalize OpenMC and free the context along with its remaining scenes */
+void omc_render_destroy(omc_render_context* context);
+
+/* A scene with the default view, colored by material with everything
+ * visible */
+int omc_render_scene_create(omc_render_context* context, omc_render_scene** scene);
+void omc_render_scene_destroy(omc_render_scene* scene);
+
+/* Message of the last failed call on the calling thread */
+const char* omc_render_last_error(void);
+
+/* Number of render threads, 0 for all CPUs. Not while rendering. */
+int omc_render_set_threads(omc_render_context* context, int threads);
+
+/* Camera position, the point it looks at, its up direction and horizontal
+ * field of view in degrees */
+int omc_render_set_camera(omc_render_scene* scene, const double position[3], const double look_at[3],
+                          const double up[3], double fov);
+
+int omc_render_set_light(omc_render_scene* scene, const double position[3]);
+
+/* Switch between coloring by cell and by material. Colors and visibility
+ * are kept per mode. */
+int omc_render_set_color_by(omc_render_scene* scene, int color_by);
+
+/* Color and visibility of a cell or material ID, for the current mode */
+int omc_render_set_color(omc_render_scene* scene, int32_t id, uint8_t red, uint8_t green, uint8_t blue);
+int omc_render_set_visibility(omc_render_scene* scene, int32_t id, int visible);
+
+/* Supersample pixels at cell, material and depth edges (needs a G-buffer) */
+int omc_render_set_antialias(omc_render_scene* scene, int enabled);
+
+/* Trace the scene's view into the buffers, which are written in place.
+ * Different scenes may be rendered from several threads at once; the calls
+ * take turns on the context's threads. */
+int omc_render_render(omc_render_scene* scene, const omc_render_buffers* buffers);
+
+/* Trace n different scenes into buffers[i] together, sharing the threads
+ * between the tiles of all of them */
+int omc_render_render_batch(omc_render_context* context, int n, omc_render_scene* const* scenes,
+                            const omc_render_buffers* buffers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* include guard */
@@ -0,0 +1,271 @@
+#ifndef OPENMC_RENDER_OPTIONS_H
+#define OPENMC_RENDER_OPTIONS_H
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "affinity.h"
+#include "animation.h"
+#include "model_inputs.h"
+#include "poster.h"
+
+// Command line options consumed by the renderer itself. Everything that isn't
+// recognized here is forwarded untouched to openmc_init.
+struct RenderOptions {
+  // Initialize OpenMC in plotting mode, which only builds materials, geometry
+  // and plot settings and skips cross section loading
+  bool geometry_only {true};
+
+  // Watch the model's XML files and reload the geometry when they change
+  bool watch {false};
+
+  // Persist view settings and a preview image per model between sessions
+  bool use_cache {true};
+  std::string cache_dir;  // empty for the default location
+
+  // Export a poster of the initial view and exit (width 0 to disable)
+  PosterSettings poster {0, 0};
+
+  // Camera path to load at startup (empty for none), and its frames to
+  // render to an image sequence before exiting (width 0 to disable)
+  std::string camera_path;
+  AnimationSettings animation {0, 0};
+
+  // Time the tile kernels at several resolutions and exit (0 to disable)
+  int benchmark_frames {0};
+
+  // Statepoint file with mesh tallies to overlay (empty for none)
+  std::string statepoint;
+
+  // Track file with particle tracks to draw (empty for none)
+  std::string tracks;
+
+  // Record spans from startup and write them as Chrome trace JSON on exit
+  std::string trace_spans;
+
+  // Size, placement and priority of the render thread pool
+  ThreadSettings threads;
+
+  // Input log to write, or to play back at its recorded pace and then exit
+  // with latency statistics (empty for none)
+  std::string record_input;
+  std::string replay_input;
+
+  // Don't show the window, e.g. for replays on a virtual display
+  bool headless {false};
+
+  // Arguments passed on to OpenMC (including argv[0])
+  std::vector<std::string> openmc_args;
+
+  // Build an argv-style array for openmc_init. The pointers remain valid as
+  // long as this object is alive and openmc_args isn't modified.
+  std::vector<char*> openmc_argv() {
+    std::vector<char*> argv;
+    for (auto& arg : openmc_args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    return argv;
+  }
+};
+
+inline void print_render_usage(std::ostream& os) {
+  os << "Renderer options:" << std::endl;
+  os << "  --full-init        Run the full OpenMC initialization (cross sections included)," << std::endl;
+  os << "                     the default for models without plots" << std::endl;
+  os << "  --watch            Reload the model when its XML input files change" << std::endl;
+  os << "  --cache-dir <dir>  Directory for cached view settings and previews" << std::endl;
+  os << "  --no-cache         Don't read or write the preview cache" << std::endl;
+  os << "  --poster <W>x<H>   Render a poster of the initial view and exit" << std::endl;
+  os << "  --poster-out <f>   Output file for --poster (default poster.ppm)" << std::endl;
+  os << "  --camera-path <f>  Load keyframes of a camera path" << std::endl;
+  os << "  --animate <W>x<H>  Render the camera path to an image sequence and exit" << std::endl;
+  os << "  --animate-out <p>  File name pattern of the frames (default frame_%05d.ppm)" << std::endl;
+  os << "  --fps <n>          Frames per second of the animation (default 30)" << std::endl;
+  os << "  --animate-part i/n Render only frames i, i + n, ... (to split over processes)" << std::endl;
+  os << "  --benchmark [n]    Time n frames (default 10) per resolution and kernel, then exit" << std::endl;
+  os << "  --statepoint <f>   Overlay mesh tally results from a statepoint file" << std::endl;
+  os << "  --tracks <f>       Draw particle tracks from a track file" << std::endl;
+  os << "  --trace-spans <f>  Record frame and tile spans, written as Chrome trace JSON on exit" << std::endl;
+  os << "  --threads <n>      Number of render threads (default: all CPUs of the affinity policy)" << std::endl;
+  os << "  --affinity <p>     Pin render threads: none, compact, scatter or numa[:node]" << std::endl;
+  os << "  --priority <p>     Render thread priority: interactive or background" << std::endl;
+  os << "  --record-input <f> Record mouse, key and UI input to a log file" << std::endl;
+  os << "  --replay-input <f> Replay an input log, print latency percentiles and exit" << std::endl;
+  os << "  --headless         Keep the window hidden" << std::endl;
+  os << "All other arguments are passed to OpenMC." << std::endl;
+}
+
+inline RenderOptions parse_render_options(int argc, char* argv[]) {
+  RenderOptions opts;
+
+  bool plot_flag_present = false;
+  for (int i = 0; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (i > 0 && arg == "--full-init") {
+      opts.geometry_only = false;
+      continue;
+    }
+
+    if (i > 0 && arg == "--watch") {
+      opts.watch = true;
+      continue;
+    }
+
+    if (i > 0 && arg == "--no-cache") {
+      opts.use_cache = false;
+      continue;
+    }
+
+    if (i > 0 && arg == "--cache-dir" && i + 1 < argc) {
+      opts.cache_dir = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--poster" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &opts.poster.width, &opts.poster.height) != 2 ||
+          opts.poster.width <= 0 || opts.poster.height <= 0) {
+        throw std::runtime_error("Invalid poster size, expected <width>x<height>");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--poster-out" && i + 1 < argc) {
+      opts.poster.path = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--camera-path" && i + 1 < argc) {
+      opts.camera_path = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--animate" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &opts.animation.width, &opts.animation.height) != 2 ||
+          opts.animation.width <= 0 || opts.animation.height <= 0) {
+        throw std::runtime_error("Invalid animation size, expected <width>x<height>");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--animate-out" && i + 1 < argc) {
+      opts.animation.pattern = argv[++i];
+      if (!opts.animation.valid_pattern()) {
+        throw std::runtime_error("Invalid frame file pattern, expected one integer conversion such as %05d");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--fps" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%lf", &opts.animation.fps) != 1 || !(opts.animation.fps > 0.0)) {
+        throw std::runtime_error("Invalid frame rate");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--animate-part" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%d/%d", &opts.animation.part, &opts.animation.parts) != 2 ||
+          opts.animation.parts <= 0 || opts.animation.part < 0 || opts.animation.part >= opts.animation.parts) {
+        throw std::runtime_error("Invalid animation part, expected <i>/<n> with 0 <= i < n");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--benchmark") {
+      opts.benchmark_frames = 10;
+      if (i + 1 < argc && std::sscanf(argv[i + 1], "%d", &opts.benchmark_frames) == 1) {
+        i++;
+        if (opts.benchmark_frames <= 0) {
+          throw std::runtime_error("Invalid number of benchmark frames");
+        }
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--threads" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%d", &opts.threads.threads) != 1 || opts.threads.threads < 0) {
+        throw std::runtime_error("Invalid number of threads");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--affinity" && i + 1 < argc) {
+      if (!parse_affinity(argv[++i], opts.threads)) {
+        throw std::runtime_error("Invalid affinity, expected none, compact, scatter or numa[:node] with an existing node");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--priority" && i + 1 < argc) {
+      std::string priority = argv[++i];
+      if (priority == "interactive") {
+        opts.threads.priority = Priority::Interactive;
+      } else if (priority == "background") {
+        opts.threads.priority = Priority::Background;
+      } else {
+        throw std::runtime_error("Invalid priority, expected interactive or background");
+      }
+      continue;
+    }
+
+    if (i > 0 && arg == "--record-input" && i + 1 < argc) {
+      opts.record_input = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--replay-input" && i + 1 < argc) {
+      opts.replay_input = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--headless") {
+      opts.headless = true;
+      continue;
+    }
+
+    if (i > 0 && arg == "--statepoint" && i + 1 < argc) {
+      opts.statepoint = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--tracks" && i + 1 < argc) {
+      opts.tracks = argv[++i];
+      continue;
+    }
+
+    if (i > 0 && arg == "--trace-spans" && i + 1 < argc) {
+      opts.trace_spans = argv[++i];
+      continue;
+    }
+
+    if (arg == "-h" || arg == "--help") print_render_usage(std::cout);
+    if (arg == "-p" || arg == "--plot") plot_flag_present = true;
+    opts.openmc_args.push_back(arg);
+  }
+
+  if (opts.openmc_args.empty()) opts.openmc_args.push_back("omc-render");
+
+  if (opts.animation.width > 0 && opts.camera_path.empty()) {
+    throw std::runtime_error("--animate needs a --camera-path");
+  }
+
+  // OpenMC's plotting run mode reads settings, materials, geometry and plots
+  // but does not load cross section or S(a,b) data. It fails without plots,
+  // so models that have none get the full initialization.
+  if (opts.geometry_only && !plot_flag_present) {
+    if (model_has_plots(model_input_path(opts.openmc_args))) {
+      opts.openmc_args.insert(opts.openmc_args.begin() + 1, "--plot");
+    } else {
+      opts.geometry_only = false;
+      std::cout << "The model defines no plots, running the full OpenMC initialization" << std::endl;
+    }
+  }
+
+  return opts;
+}
+
+#endif // include guard
@@ -0,0 +1,55 @@
+#ifndef OPENMC_RENDER_OUTLINE_H
+#define OPENMC_RENDER_OUTLINE_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "openmc/plot.h"
+
+#include "frame.h"
+#include "thread_pool.h"
+
+struct OutlineSettings {
+  bool enabled {false};
+  openmc::RGBColor color {0, 0, 0};
+  float depth_threshold {0.05f};  // relative depth jump drawn as a silhouette
+};
+
+// Draw cell boundaries and silhouettes into a frame's colors using only its
+// G-buffer. A pixel is on an outline if a 4-neighbor belongs to another cell
+// or lies noticeably further away, and it's the nearer of the two, so lines
+// are one pixel wide and sit on the foreground object.
+inline void draw_outlines(Frame& frame, const OutlineSettings& settings, ThreadPool& pool) {
+  if (!frame.has_gbuffer()) return;
+
+  const int width = frame.width;
+  const int height = frame.height;
+  auto outline = [&](size_t p, size_t q) {
+    float dp = frame.depth[p], dq = frame.depth[q];
+    // on equal depths (all of them in slice mode) the first pixel takes the
+    // line, so it stays one pixel wide
+    if (dp > dq || (dp == dq && p > q)) return false;
+    if (frame.cell_id[p] != frame.cell_id[q]) return true;
+    return !std::isinf(dp) && (std::isinf(dq) || dq - dp > settings.depth_threshold * dp);
+  };
+
+  // colors are written only for the row's own pixels and the G-buffer is
+  // only read, so rows are independent
+  const int rows_per_task = 16;
+  pool.parallel_for((height + rows_per_task - 1) / rows_per_task, [&](size_t task, int) {
+    int row_end = std::min(height, static_cast<int>(task + 1) * rows_per_task);
+    for (int row = task * rows_per_task; row < row_end; row++) {
+      for (int col = 0; col < width; col++) {
+        size_t p = static_cast<size_t>(row) * width + col;
+        if ((col > 0 && outline(p, p - 1)) ||
+            (col + 1 < width && outline(p, p + 1)) ||
+            (row > 0 && outline(p, p - width)) ||
+            (row + 1 < height && outline(p, p + width))) {
+          frame.color[p] = settings.color;
+        }
+      }
+    }
+  });
+}
+
+#endif // include guard
@@ -1,11 +1,30 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 
 #include "openmc/capi.h"
 #include "openmc/material.h"
 #include "openmc/plot.h"
 #include "openmc/settings.h"
 
+#include "frame.h"
+#include "scene.h"
+#include "simd.h"
+#include "slice.h"
+#include "spans.h"
+#include "surface_mesh.h"
+#include "surface_soa.h"
+#include "thread_pool.h"
+#include "timing.h"
+#include "tracer.h"
+#include "viewports.h"
+#include "voxel_grid.h"
+
 #ifndef OPENMC_PLOTTER_H
 #define OPENMC_PLOTTER_H
 class OpenMCPlotter {
@@ -25,25 +44,114 @@ public:
   void operator=(OpenMCPlotter const&&) = delete;
 
 
-  void initialize(int argc, char* argv[]) {
+  void initialize(int argc, char* argv[], PhaseTimer& timer) {
+    timer.start("openmc_init");
     int err = openmc_init(argc, argv, nullptr);
+    timer.stop();
     if (err) {
       throw std::runtime_error("Error initializing OpenMC");
     }
 
+    if (openmc::settings::run_mode == openmc::RunMode::PLOTTING) {
+      std::cout << "OpenMC initialized in geometry-only (plotting) mode" << std::endl;
+    }
+
     // create a new plot object
-    plot_ = std::make_unique<openmc::PhongPlot>();
+    timer.start("plot setup");
+    scene_.create();
+    timer.stop();
+
+    timer.start("model bounds");
+    bounds_ = ModelBounds::root_universe();
+    timer.stop();
+    if (!bounds_.finite) {
+      std::cout << "Model bounding box is infinite, primary rays won't be culled" << std::endl;
+    }
+    place_clip(scene_.clip());
+    slice_.set_origin(scene_.clip().center);
+    if (slice_.plane().pixel_size <= 0.0) {
+      // the first slice shows the whole model, a reload keeps the view
+      double extent = bounds_.finite ? (bounds_.upper - bounds_.lower).norm() : 100.0;
+      slice_.reset(extent, plot()->pixels()[0]);
+    }
 
-    set_plot_defaults();
+    timer.start("surface SoA");
+    if (bounds_.finite && !surfaces_.build()) {
+      std::cout << "Root universe has surfaces other than planes, cylinders, spheres, cones and quadrics, "
+                   "SIMD pre-pass disabled" << std::endl;
+    }
+    timer.stop();
+
+    timer.start("cell SoA");
+    if (!cells_.build()) {
+      std::cout << "No cell is bounded by planes, cylinders, spheres, cones and quadrics only, "
+                   "SIMD cell surface distances disabled" << std::endl;
+    }
+    timer.stop();
 
-    if (!plot_) {
+    if (!plot()) {
       throw std::runtime_error("Plot zero is not a PhongPlot");
     }
   }
 
+  // Rebuild the model from its (modified) input files. Colors and
+  // visibility are keyed by ID and have to be re-applied by the caller.
+  void reload(int argc, char* argv[], PhaseTimer& timer) {
+    finalize(timer);
+    initialize(argc, argv, timer);
+  }
+
+  // The process started by check_model_init: initialize OpenMC on the model
+  // and exit. A model OpenMC rejects ends in a nonzero exit status, whether
+  // openmc_init returns an error or exits from a fatal error.
+  static int check_model(int argc, char* argv[]) {
+    int err = openmc_init(argc, argv, nullptr);
+    if (err) {
+      std::cerr << " ERROR: " << openmc_err_msg << std::endl;
+      return EXIT_FAILURE;
+    }
+    openmc_finalize();
+    return EXIT_SUCCESS;
+  }
+
+  // Drop the model and finalize OpenMC, so initialize can load another one
+  void finalize(PhaseTimer& timer) {
+    scene_.release();
+    voxels_.clear();
+    lod_.clear();
+    slice_.clear();
+    cost_map_.clear();
+
+    timer.start("openmc_finalize");
+    int err = openmc_finalize();
+    timer.stop();
+    if (err) {
+      throw std::runtime_error("Error finalizing OpenMC");
+    }
+  }
+
+  bool initialized() const {
+    return scene_.created();
+  }
+
+  // The view of the interactive renderer, which the plotter's own settings
+  // and render_frame refer to
+  Scene& scene() {
+    return scene_;
+  }
+
+  // A scene of the loaded model with the default view, colors and settings,
+  // independent of the plotter's own. Scenes must be released (or
+  // destroyed) before the model is finalized.
+  Scene create_scene() const {
+    Scene scene;
+    scene.create();
+    place_clip(scene.clip());
+    return scene;
+  }
+
   void set_pixels(int32_t width, int32_t height) {
-    plot()->pixels()[0] = width;
-    plot()->pixels()[1] = height;
+    scene_.set_pixels(width, height);
   }
 
   openmc::ImageData create_image() {
@@ -51,85 +159,573 @@ public:
     return img;
   }
 
-  ~OpenMCPlotter() {
-    int err  = openmc_finalize();
-    if (err) {
-      std::cerr << "Error finalizing OpenMC" << std::endl;
+  // Trace an image of the current view along with its G-buffer
+  Frame create_frame(int width, int height) {
+    Frame frame;
+    frame.resize(width, height);
+    render_rows(CameraRays(*plot(), width, height), frame);
+    return frame;
+  }
+
+  // Trace the current view at the plot's resolution, reusing the frame's
+  // buffers when the size hasn't changed
+  void render_frame(Frame& frame) {
+    render_scene(scene_, frame, pool_);
+  }
+
+  // Trace a scene at its plot's resolution. Scenes rendered from several
+  // threads at once take turns on the pool unless each is given its own.
+  void render_scene(Scene& scene, Frame& frame) {
+    render_scene(scene, frame, pool_);
+  }
+
+  void render_scene(Scene& scene, Frame& frame, ThreadPool& pool) {
+    int width = scene.plot()->pixels()[0];
+    int height = scene.plot()->pixels()[1];
+    if (frame.width != width || frame.height != height || frame.y0 != 0) {
+      frame.y0 = 0;
+      frame.resize(width, height);
+    }
+    CameraRays rays(*scene.plot(), width, height);
+    render_rows(scene, rays, frame, pool);
+    if (scene.antialias_) {
+      antialias_edges(scene, rays, frame, pool);
     }
   }
 
-  void set_plot_defaults() {
-    plot()->color_by_ = openmc::PlottableInterface::PlotColorBy::mats;
-    plot()->pixels() = {400, 400};
-    plot()->set_default_colors();
+  // Trace several scenes (each at most once) in one parallel_for over the
+  // tiles of all of them, so views too small to keep every thread busy on
+  // their own don't run one after the other. Traversal costs are only
+  // measured for the plotter's own scene by render_frame.
+  void render_scenes(const std::vector<Scene*>& scenes, const std::vector<Frame*>& frames) {
+    if (scenes.empty()) return;
+    spans::Scope span("trace scenes");
+    std::vector<CameraRays> rays;
+    std::vector<TileScheduler::Job> jobs;
+    for (size_t i = 0; i < scenes.size(); i++) {
+      Frame& frame = *frames[i];
+      int width = scenes[i]->plot()->pixels()[0];
+      int height = scenes[i]->plot()->pixels()[1];
+      if (frame.width != width || frame.height != height || frame.y0 != 0) {
+        frame.y0 = 0;
+        frame.resize(width, height);
+      }
+      rays.emplace_back(*scenes[i]->plot(), width, height);
+      for (const Tile& tile : make_tiles(width, 0, height, tile_size_)) {
+        jobs.push_back({i, tile});
+      }
+    }
 
-    plot()->opaque_ids().clear();
+    std::vector<size_t> culled = render_scene_tiles(scenes, rays, frames, jobs);
+    for (size_t i = 0; i < scenes.size(); i++) {
+      scenes[i]->culled_fraction_ = static_cast<double>(culled[i]) / std::max<size_t>(1, frames[i]->size());
+      if (scenes[i]->antialias_) {
+        antialias_edges(*scenes[i], rays[i], *frames[i], pool_);
+      }
+    }
+  }
 
-    for (const auto& mat : openmc::model::materials) {
-       plot()->opaque_ids().insert(mat->id_);
+  // Trace some tiles of several scenes (each at most once) in one
+  // parallel_for, e.g. the ones a TileScheduler handed out. The rays and
+  // frames must have the size of their scene's plot. Edges aren't
+  // supersampled, as the frames may be incomplete. Returns the number of
+  // pixels culled per scene.
+  std::vector<size_t> render_scene_tiles(const std::vector<Scene*>& scenes,
+                                         const std::vector<CameraRays>& rays,
+                                         const std::vector<Frame*>& frames,
+                                         const std::vector<TileScheduler::Job>& jobs) {
+    size_t n = scenes.size();
+    std::vector<DynamicKernel> kernels;
+    std::vector<FrameContext> contexts;
+    for (size_t i = 0; i < n; i++) {
+      kernels.push_back(frame_kernel(*scenes[i], *frames[i]));
+      kernels.back().cost = false;
+      contexts.push_back(frame_context(*scenes[i], rays[i], kernels.back(), pool_));
     }
 
-    // set opaque "IDs" by index
-    for (int i = 0; i < openmc::model::materials.size(); i++) {
-      plot()->opaque_ids().insert(i);
+    // the kernel is chosen once per tile, scenes may differ in their settings
+    std::vector<std::atomic<size_t>> culled(n);
+    pool_.parallel_for(jobs.size(), [&](size_t j, int thread) {
+      const TileScheduler::Job& job = jobs[j];
+      spans::Scope tile_span("tile", static_cast<uint32_t>(job.tile.width * job.tile.height));
+      auto run = [&](const auto& kernel) {
+        size_t view = job.view;
+        culled[view] += render_tile(kernel, rays[view], job.tile, *frames[view], contexts[view], thread);
+      };
+      if (specialize_kernels_) {
+        dispatch_kernel(kernels[job.view], run);
+      } else {
+        run(kernels[job.view]);
+      }
+    });
+    return std::vector<size_t>(culled.begin(), culled.end());
+  }
+
+  // Compose the slice view at the plot's resolution, evaluating only the
+  // tiles that aren't cached yet
+  void render_slice(Frame& frame) {
+    spans::Scope span("slice");
+    bool by_material = plot()->color_by_ == openmc::PlottableInterface::PlotColorBy::mats;
+    slice_.render(frame, plot()->pixels()[0], plot()->pixels()[1], pool_, by_material,
+                  scene_.visible_indices(), plot()->colors_, plot()->not_found_);
+  }
+
+  // Supersample only the pixels next to a cell, material or depth
+  // discontinuity in the frame's G-buffer, with four rotated grid samples
+  void antialias_edges(Scene& scene, const CameraRays& rays, Frame& frame, ThreadPool& pool) {
+    spans::Scope span("antialias");
+    std::vector<size_t> edges = find_edges(frame);
+    scene.edge_fraction_ = static_cast<double>(edges.size()) / std::max<size_t>(1, frame.size());
+    if (edges.empty()) return;
+
+    DynamicKernel kernel = frame_kernel(scene, frame);
+    kernel.gbuffer = false;  // the G-buffer keeps the center sample
+    kernel.cost = false;     // and the cost map the center sample's work
+    FrameContext context = frame_context(scene, rays, kernel, pool);
+
+    const size_t chunk = 256;
+    auto run = [&](const auto& kernel) {
+      pool.parallel_for((edges.size() + chunk - 1) / chunk, [&](size_t c, int thread) {
+        size_t end = std::min(edges.size(), (c + 1) * chunk);
+        spans::Scope chunk_span("antialias chunk", static_cast<uint32_t>(end - c * chunk));
+        for (size_t i = c * chunk; i < end; i++) {
+          supersample_pixel(kernel, rays, frame, context, edges[i], thread);
+        }
+      });
+    };
+    if (specialize_kernels_) {
+      dispatch_kernel(kernel, run);
+    } else {
+      run(kernel);
     }
+  }
 
+  // Pixels whose cell, material or depth differs from a 4-neighbor's.
+  // Depths are compared relative to the nearer one.
+  std::vector<size_t> find_edges(const Frame& frame) const {
+    spans::Scope span("find edges");
+    std::vector<size_t> edges;
+    if (!frame.has_gbuffer()) return edges;
+
+    auto differs = [&](size_t a, size_t b) {
+      if (frame.cell_id[a] != frame.cell_id[b] || frame.material_id[a] != frame.material_id[b]) return true;
+      float da = frame.depth[a], db = frame.depth[b];
+      if (std::isinf(da) || std::isinf(db)) return false;
+      return std::abs(da - db) > aa_depth_threshold_ * std::min(da, db);
+    };
+
+    for (int row = 0; row < frame.height; row++) {
+      for (int col = 0; col < frame.width; col++) {
+        size_t p = static_cast<size_t>(row) * frame.width + col;
+        if ((col > 0 && differs(p, p - 1)) ||
+            (col + 1 < frame.width && differs(p, p + 1)) ||
+            (row > 0 && differs(p, p - frame.width)) ||
+            (row + 1 < frame.height && differs(p, p + frame.width))) {
+          edges.push_back(p);
+        }
+      }
+    }
+    return edges;
   }
 
-  void set_color(int32_t id, openmc::RGBColor color) {
-    // have to convert from material ID to index
-    int32_t mat_index = openmc::model::material_map[id];
-    plot()->colors_[mat_index] = color;
+  template<typename Kernel>
+  void supersample_pixel(const Kernel& kernel, const CameraRays& rays, Frame& frame,
+                         const FrameContext& context, size_t pixel, int thread) {
+    // rotated grid offsets from the pixel center
+    static const double offsets[4][2] = {{-0.125, -0.375}, {0.375, -0.125}, {0.125, 0.375}, {-0.375, 0.125}};
+
+    int horiz = static_cast<int>(pixel % frame.width);
+    int vert = frame.y0 + static_cast<int>(pixel / frame.width);
+    const openmc::RGBColor& center = frame.color[pixel];
+    int sum[3] = {center.red, center.green, center.blue};
+    for (const auto& offset : offsets) {
+      openmc::RGBColor c = trace_sample(kernel, rays, horiz + offset[0], vert + offset[1], context, thread);
+      sum[0] += c.red;
+      sum[1] += c.green;
+      sum[2] += c.blue;
+    }
+    frame.color[pixel] = openmc::RGBColor((sum[0] + 2) / 5, (sum[1] + 2) / 5, (sum[2] + 2) / 5);
   }
 
-  void set_material_visibility(int32_t id, bool visibility) {
-    // have to convert from material ID to index
-    int32_t mat_index = openmc::model::material_map[id];
-    if (visibility) {
-      plot()->opaque_ids().insert(mat_index);
+  // Color of a single ray through image position (horiz, vert)
+  template<typename Kernel>
+  openmc::RGBColor trace_sample(const Kernel& kernel, const CameraRays& rays, double horiz, double vert,
+                                const FrameContext& context, int thread) {
+    const openmc::Position& origin = rays.origin();
+    openmc::Direction u = rays.direction(horiz, vert);
+    double t_start = 0.0;
+    if (kernel.cull) {
+      double t_enter, t_exit;
+      if (!bounds_.intersect(origin, u, t_enter, t_exit)) return context.background;
+      t_start = std::max(0.0, t_enter);
+    }
+    openmc::RGBColor color = context.background;
+    trace_ray(kernel, origin, u, t_start, context, thread, [&](GBufferRay<Kernel>& ray) { color = ray.color(); });
+    return color;
+  }
+
+  // Trace a primary ray from distance t_start along u and pass it to store.
+  // Clipped kernels start and end the ray at the clip region's boundary.
+  // Returns false without tracing if the ray misses the region.
+  template<typename Kernel, typename Store>
+  bool trace_ray(const Kernel& kernel, const openmc::Position& origin, const openmc::Direction& u,
+                 double t_start, const FrameContext& context, int thread, Store&& store) {
+    double t_end = std::numeric_limits<double>::infinity();
+    bool cap = false;
+    openmc::Direction cap_normal;
+    if (kernel.clip) {
+      double t_enter = t_start;
+      if (!context.clip->clip(origin, u, t_enter, t_end, cap_normal)) return false;
+      cap = t_enter > t_start;
+      t_start = t_enter;
+    }
+
+    GBufferRay<Kernel> ray(origin + u * t_start, u, *context.plot, origin, kernel, context);
+    if (kernel.clip) ray.set_clip(t_end, cap, cap_normal);
+    if (kernel.cost) {
+      ray.set_cost(cost_map_.cells(thread));
+      auto begin = std::chrono::steady_clock::now();
+      ray.trace_view();
+      std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+      ray.cost().time_us = elapsed.count();
     } else {
-      plot()->opaque_ids().erase(mat_index);
+      ray.trace_view();
     }
+    store(ray);
+    return true;
   }
 
-  std::unordered_map<int32_t, openmc::RGBColor> color_map() {
-    auto map_out = std::unordered_map<int32_t, openmc::RGBColor>();
-    if (plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats) {
-      for (int i = 0; i < openmc::model::materials.size(); i++) {
-        const auto& mat = openmc::model::materials[i];
-        map_out[mat->id_] = plot()->colors_[i];
+  // Trace the rows held by frame (possibly a strip of a larger image) as
+  // tiles distributed over the thread pool
+  void render_rows(const CameraRays& rays, Frame& frame) {
+    render_rows(scene_, rays, frame, pool_);
+  }
+
+  void render_rows(Scene& scene, const CameraRays& rays, Frame& frame, ThreadPool& pool) {
+    spans::Scope span("trace");
+    auto tiles = make_tiles(frame.width, frame.y0, frame.y0 + frame.height, tile_size_);
+    DynamicKernel kernel = frame_kernel(scene, frame);
+    FrameContext context = frame_context(scene, rays, kernel, pool);
+    std::atomic<size_t> culled {0};
+    if (kernel.cost) {
+      cost_map_.begin(frame.width, frame.height, pool.size());
+    }
+
+    // the kernel is chosen once per frame rather than branched on per pixel
+    auto run = [&](const auto& kernel) {
+      pool.parallel_for(tiles.size(), [&](size_t i, int thread) {
+        spans::Scope tile_span("tile", static_cast<uint32_t>(tiles[i].width * tiles[i].height));
+        culled += render_tile(kernel, rays, tiles[i], frame, context, thread);
+      });
+    };
+    if (specialize_kernels_) {
+      dispatch_kernel(kernel, run);
+    } else {
+      run(kernel);
+    }
+
+    scene.culled_fraction_ = static_cast<double>(culled) / std::max<size_t>(1, frame.size());
+    if (kernel.cost) {
+      cost_map_.finish();
+    }
+  }
+
+  int tile_size() const {
+    return tile_size_;
+  }
+
+  // Switches of the tile kernel for a scene's settings
+  DynamicKernel frame_kernel(const Scene& scene, const Frame& frame) const {
+    DynamicKernel kernel;
+    kernel.by_material = scene.by_material();
+    kernel.cull = scene.cull_rays_ && bounds_.finite;
+    kernel.prepass = kernel.cull && scene.simd_prepass_ && !surfaces_.empty();
+    kernel.gbuffer = frame.has_gbuffer();
+    kernel.lod = scene.lod_enabled_;
+    kernel.clip = scene.clip_.active();
+    // whole frames of the interactive view with a G-buffer only, not poster
+    // strips or other scenes
+    kernel.cost = measure_cost_ && kernel.gbuffer && frame.y0 == 0 && &scene == &scene_;
+    return kernel;
+  }
+
+  FrameContext frame_context(Scene& scene, const CameraRays& rays, const DynamicKernel& kernel, ThreadPool& pool) {
+    openmc::PhongPlot& plot = *scene.plot();
+    FrameContext context;
+    context.plot = &plot;
+    context.clip = &scene.clip_;
+    context.visible = scene.visible_indices();
+    context.pixel_angle = rays.pixel_angle();
+    context.light = plot.light_location();
+    context.diffuse_fraction = plot.diffuse_fraction();
+    context.colors = &plot.colors_;
+    context.background = plot.not_found_;
+    if (scene.simd_cells_ && !cells_.empty()) {
+      context.cells = &cells_;
+    }
+    if (kernel.cost) {
+      if (!cost_map_.built()) cost_map_.build();
+      context.cost = &cost_map_;
+    }
+    if (kernel.lod) {
+      // sampled once per model, the colors follow the scene's settings
+      {
+        std::lock_guard<std::mutex> lock(lod_mutex_);
+        if (!lod_.built()) lod_.build(pool);
       }
-    } else if (plot()->color_by() == openmc::PlottableInterface::PlotColorBy::cells) {
-      for (int i = 0; i < openmc::model::cells.size(); i++) {
-        const auto& cell = openmc::model::cells[i];
-        map_out[cell->id_] = plot()->colors_[i];
+      lod_.update_colors(scene.lod_, kernel.by_material, context.visible, plot.colors_);
+      context.lod = &scene.lod_;
+      context.lod_threshold = scene.lod_threshold_;
+    }
+    return context;
+  }
+
+  // Rows of a tile are processed in packets of simd::width pixels. Returns
+  // the number of pixels culled.
+  template<typename Kernel>
+  size_t render_tile(const Kernel& kernel, const CameraRays& rays, const Tile& tile, Frame& frame,
+                   const FrameContext& context, int thread) {
+    constexpr int W = simd::width;
+    const bool cull = kernel.cull;
+    const bool prepass = kernel.prepass;
+    const openmc::Position& origin = rays.origin();
+    size_t culled = 0;
+
+    for (int vert = tile.y0; vert < tile.y0 + tile.height; vert++) {
+      for (int x0 = tile.x0; x0 < tile.x0 + tile.width; x0 += W) {
+        int n = std::min(W, tile.x0 + tile.width - x0);
+
+        // unused lanes repeat the last ray
+        openmc::Direction u[W];
+        double ux[W], uy[W], uz[W], t_enter[W], t_exit[W], t_hit[W];
+        bool hit_box[W];
+        for (int lane = 0; lane < W; lane++) {
+          u[lane] = rays.direction(x0 + std::min(lane, n - 1), vert);
+          ux[lane] = u[lane][0];
+          uy[lane] = u[lane][1];
+          uz[lane] = u[lane][2];
+          t_enter[lane] = 0.0;
+          t_exit[lane] = 0.0;
+          hit_box[lane] = !cull || bounds_.intersect(origin, u[lane], t_enter[lane], t_exit[lane]);
+          t_hit[lane] = t_enter[lane];
+        }
+
+        // A camera outside of the box is in the void, so a ray can't enter
+        // the model before its first crossing of a root universe surface
+        if (prepass) {
+          surfaces_.first_crossing(origin, ux, uy, uz, t_enter, t_exit, t_hit);
+        }
+
+        for (int lane = 0; lane < n; lane++) {
+          size_t pixel = frame.index(x0 + lane, vert);
+
+          // Rays that miss the model's bounding box (or all of the root
+          // universe's surfaces) are background without any geometry
+          // queries, the others start close to the model instead of
+          // searching for its boundary from the camera
+          bool outside = cull && t_enter[lane] > 0.0;
+          if (!hit_box[lane] || (prepass && outside && std::isinf(t_hit[lane]))) {
+            frame.set_background(pixel, context.background);
+            culled++;
+            continue;
+          }
+
+          double t_start = 0.0;
+          if (outside) {
+            t_start = prepass ? t_hit[lane] - 1e-8 * (1.0 + t_hit[lane]) : t_enter[lane];
+            t_start = std::max(t_enter[lane], t_start);
+          }
+
+          if (!trace_ray(kernel, origin, u[lane], t_start, context, thread, [&](GBufferRay<Kernel>& ray) {
+                ray.store(frame, pixel);
+                if (kernel.cost) cost_map_.store(pixel, ray.cost());
+              })) {
+            frame.set_background(pixel, context.background);
+            culled++;
+          }
+        }
       }
     }
-    return map_out;
+
+    return culled;
+  }
+
+  // Sample the voxel preview grid, blocking until done or cancelled. Uses
+  // its own threads so the pool stays available for tracing meanwhile.
+  bool build_voxel_grid(const VoxelGrid::Settings& settings, const std::atomic<bool>& cancel) {
+    return voxels_.build(bounds_, settings, pool_.size(), cancel);
+  }
+
+  // Render the current view from the voxel grid instead of the geometry
+  void render_preview(Frame& frame, int width, int height) {
+    spans::Scope span("voxel preview");
+    if (frame.width != width || frame.height != height || frame.y0 != 0) {
+      frame.y0 = 0;
+      frame.resize(width, height);
+    }
+
+    VoxelGrid::Shading shading;
+    shading.by_material = plot()->color_by_ == openmc::PlottableInterface::PlotColorBy::mats;
+    shading.visible = scene_.visible_indices();
+    shading.colors = &plot()->colors_;
+    shading.light = plot()->light_location();
+    shading.diffuse_fraction = plot()->diffuse_fraction();
+    shading.background = plot()->not_found_;
+
+    CameraRays rays(*plot(), width, height);
+    auto tiles = make_tiles(width, 0, height, tile_size_);
+    pool_.parallel_for(tiles.size(), [&](size_t i, int) {
+      const Tile& tile = tiles[i];
+      spans::Scope tile_span("preview tile", static_cast<uint32_t>(tile.width * tile.height));
+      for (int vert = tile.y0; vert < tile.y0 + tile.height; vert++) {
+        for (int horiz = tile.x0; horiz < tile.x0 + tile.width; horiz++) {
+          voxels_.trace(rays.origin(), rays.direction(horiz, vert), shading, frame, frame.index(horiz, vert));
+        }
+      }
+    });
+  }
+
+  // Boundary meshes of the voxel grid for the given color mode
+  SurfaceMesh extract_surface_mesh(bool by_material) const {
+    size_t n_indices = by_material ? openmc::model::materials.size() : openmc::model::cells.size();
+    return SurfaceMesh::extract(voxels_, by_material, n_indices, pool_.size());
+  }
+
+  const VoxelGrid& voxel_grid() const {
+    return voxels_;
+  }
+
+  void clear_voxel_grid() {
+    voxels_.clear();
+  }
+
+  const ModelBounds& bounds() const {
+    return bounds_;
+  }
+
+  // 2D slice plane and its tile cache
+  SliceView& slice() {
+    return slice_;
+  }
+
+  // Settings of the plotter's own scene, see Scene
+  ClipRegion& clip() {
+    return scene_.clip();
+  }
+
+  bool& cull_rays() {
+    return scene_.cull_rays();
+  }
+
+  bool& simd_prepass() {
+    return scene_.simd_prepass();
+  }
+
+  bool& simd_cells() {
+    return scene_.simd_cells();
+  }
+
+  bool& lod_enabled() {
+    return scene_.lod_enabled();
+  }
+
+  float& lod_threshold() {
+    return scene_.lod_threshold();
+  }
+
+  bool& antialias() {
+    return scene_.antialias();
+  }
+
+  double edge_fraction() const {
+    return scene_.edge_fraction();
+  }
+
+  // Count the traversal work of every pixel of interactive frames
+  bool& measure_cost() {
+    return measure_cost_;
+  }
+
+  // Per-pixel, per-cell and per-universe work of the last measured frame
+  const CostMap& cost_map() const {
+    return cost_map_;
+  }
+
+  // Use the compile-time specialized tile kernels
+  bool& specialize_kernels() {
+    return specialize_kernels_;
+  }
+
+  bool has_surface_soa() const {
+    return !surfaces_.empty();
+  }
+
+  bool has_cell_soa() const {
+    return !cells_.empty();
+  }
+
+  double culled_fraction() const {
+    return scene_.culled_fraction();
+  }
+
+  ThreadPool& pool() {
+    return pool_;
+  }
+
+  ~OpenMCPlotter() {
+    if (!initialized()) return;
+    int err  = openmc_finalize();
+    if (err) {
+      std::cerr << "Error finalizing OpenMC" << std::endl;
+    }
+  }
+
+  void set_plot_defaults() {
+    scene_.set_plot_defaults();
+  }
+
+  int32_t id_to_index(int32_t id) const {
+    return scene_.id_to_index(id);
+  }
+
+  bool has_id(int32_t id) const {
+    return scene_.has_id(id);
+  }
+
+  void set_color(int32_t id, openmc::RGBColor color) {
+    scene_.set_color(id, color);
+  }
+
+  void set_material_visibility(int32_t id, bool visibility) {
+    scene_.set_material_visibility(id, visibility);
+  }
+
+  std::unordered_map<int32_t, openmc::RGBColor> color_map() {
+    return scene_.color_map();
   }
 
   const std::unique_ptr<openmc::PhongPlot>& plot() {
-    return plot_;
+    return scene_.plot();
   }
 
   void set_camera_position(openmc::Position position) {
-    plot()->camera_position() = position;
+    scene_.set_camera_position(position);
   }
 
   void set_look_at(openmc::Position look_at) {
-    plot()->look_at() = look_at;
+    scene_.set_look_at(look_at);
   }
 
   void set_light_position(openmc::Position light_position) {
-    plot()->light_location() = light_position;
+    scene_.set_light_position(light_position);
   }
 
   void set_up_vector(openmc::Direction up) {
-    plot()->up() = up;
+    scene_.set_up_vector(up);
   }
 
   void set_field_of_view(double fov) {
-    plot()->horizontal_field_of_view() = fov;
+    scene_.set_field_of_view(fov);
   }
 
   int32_t query_cell(openmc::Position position, openmc::Direction direction) {
@@ -172,7 +768,29 @@ public:
   }
 
 private:
-  std::unique_ptr<openmc::PhongPlot> plot_;
+  // Clip and slice planes are placed relative to the model's center and the
+  // clip box starts out as the whole model
+  void place_clip(ClipRegion& clip) const {
+    if (!bounds_.finite) return;
+    clip.center = 0.5 * (bounds_.lower + bounds_.upper);
+    clip.box_lower = bounds_.lower;
+    clip.box_upper = bounds_.upper;
+  }
+
+  Scene scene_;
+  ThreadPool pool_;
+  int tile_size_ {32};
+  ModelBounds bounds_;
+  SurfaceSoA surfaces_;
+  CellSurfaceSoA cells_;
+  bool specialize_kernels_ {true};
+  LodTable lod_;
+  std::mutex lod_mutex_;  // scenes rendered at once share the samples
+  SliceView slice_;
+  bool measure_cost_ {false};
+  CostMap cost_map_;
+  float aa_depth_threshold_ {0.05f};
+  VoxelGrid voxels_;
 };
 
 #endif // include guard
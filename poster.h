@@ -0,0 +1,141 @@
+#ifndef OPENMC_RENDER_POSTER_H
+#define OPENMC_RENDER_POSTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame.h"
+#include "plotter.h"
+#include "spans.h"
+
+// Streams an image to a binary PPM file one strip of rows at a time. Strips
+// are written by a background thread so tracing the next strip overlaps with
+// disk I/O; at most max_pending strips are held in memory.
+class StripWriter {
+public:
+  StripWriter(const std::string& path, int width, int height, size_t max_pending = 2)
+    : max_pending_(max_pending) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+      throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+    std::fprintf(file_, "P6\n%d %d\n255\n", width, height);
+    writer_ = std::thread([this]() { write_loop(); });
+  }
+
+  ~StripWriter() {
+    if (writer_.joinable()) {
+      try {
+        finish();
+      } catch (...) {
+      }
+    }
+  }
+
+  // Queue a strip, blocking while the writer is behind
+  void push(Frame&& strip) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this]() { return queue_.size() < max_pending_; });
+    queue_.push_back(std::move(strip));
+    ready_.notify_one();
+  }
+
+  // Write the remaining strips and close the file
+  void finish() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    ready_.notify_one();
+    writer_.join();
+
+    bool ok = !failed_ && std::fclose(file_) == 0;
+    file_ = nullptr;
+    if (!ok) {
+      throw std::runtime_error("Failed to write poster image");
+    }
+  }
+
+private:
+  void write_loop() {
+    while (true) {
+      Frame strip;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        strip = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      space_.notify_one();
+
+      // RGBColor is three packed bytes, the same as a PPM pixel
+      if (std::fwrite(strip.color.data(), 3, strip.size(), file_) != strip.size()) {
+        failed_ = true;
+      }
+    }
+  }
+
+  std::FILE* file_ {nullptr};
+  std::thread writer_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::deque<Frame> queue_;
+  size_t max_pending_;
+  bool done_ {false};
+  std::atomic<bool> failed_ {false};
+};
+
+struct PosterSettings {
+  int width {8192};
+  int height {8192};
+  std::string path {"poster.ppm"};
+  int strip_rows {128};
+};
+
+// Render the plotter's current view at an arbitrary resolution. Only a few
+// strips of strip_rows rows are in memory at any time (no G-buffer), so the
+// memory use is independent of the image height. Returns false if cancelled,
+// in which case the incomplete file is removed.
+inline bool render_poster(OpenMCPlotter& plotter,
+                          const PosterSettings& settings,
+                          std::atomic<float>& progress,
+                          const std::atomic<bool>& cancel) {
+  CameraRays rays(*plotter.plot(), settings.width, settings.height);
+  StripWriter writer(settings.path, settings.width, settings.height);
+
+  bool cancelled = false;
+  for (int row = 0; row < settings.height; row += settings.strip_rows) {
+    if (cancel) {
+      cancelled = true;
+      break;
+    }
+
+    spans::Scope span("poster strip");
+    Frame strip;
+    strip.y0 = row;
+    strip.resize(settings.width, std::min(settings.strip_rows, settings.height - row), false);
+    plotter.render_rows(rays, strip);
+    writer.push(std::move(strip));
+
+    progress = static_cast<float>(std::min(row + settings.strip_rows, settings.height)) / settings.height;
+  }
+
+  writer.finish();
+  if (cancelled) {
+    // the header promises rows that were never written
+    std::remove(settings.path.c_str());
+  }
+  return !cancelled;
+}
+
+#endif // include guard
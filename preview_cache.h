@@ -0,0 +1,294 @@
+#ifndef OPENMC_RENDER_PREVIEW_CACHE_H
+#define OPENMC_RENDER_PREVIEW_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "frame.h"
+
+namespace fs = std::filesystem;
+
+// 64-bit FNV-1a, used to key cache entries by the content of the model files
+class ContentHash {
+public:
+  void update(const void* data, size_t n) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; i++) {
+      hash_ ^= bytes[i];
+      hash_ *= 0x100000001b3ULL;
+    }
+  }
+
+  void update(const std::string& s) { update(s.data(), s.size()); }
+
+  std::string hex() const {
+    std::ostringstream os;
+    os << std::hex << std::setw(16) << std::setfill('0') << hash_;
+    return os.str();
+  }
+
+private:
+  uint64_t hash_ {0xcbf29ce484222325ULL};
+};
+
+// Layout of the preview file: header, RGB pixels, cell IDs, material IDs and
+// depth, each section starting at the offset given in the header
+struct PreviewHeader {
+  char magic[8];
+  uint32_t width;
+  uint32_t height;
+  uint64_t color_offset;
+  uint64_t cell_offset;
+  uint64_t material_offset;
+  uint64_t depth_offset;
+  uint64_t file_size;
+};
+
+constexpr char PREVIEW_MAGIC[8] = {'O', 'M', 'C', 'P', 'R', 'V', '1', '\0'};
+
+// Read-only memory mapping of a preview file. Pixel data is used in place,
+// e.g. uploaded straight to a texture, without being read into memory first.
+class MappedPreview {
+public:
+  MappedPreview() = default;
+  MappedPreview(const MappedPreview&) = delete;
+  MappedPreview& operator=(const MappedPreview&) = delete;
+
+  ~MappedPreview() { unmap(); }
+
+  bool map(const fs::path& path) {
+    unmap();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(PreviewHeader)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+
+    data_ = static_cast<const char*>(addr);
+    size_ = st.st_size;
+
+    // reject truncated or foreign files
+    const PreviewHeader& h = header();
+    size_t n = static_cast<size_t>(h.width) * h.height;
+    if (std::memcmp(h.magic, PREVIEW_MAGIC, sizeof(PREVIEW_MAGIC)) != 0 ||
+        h.file_size != size_ ||
+        h.color_offset + 3 * n > size_ ||
+        h.cell_offset + 4 * n > size_ ||
+        h.material_offset + 4 * n > size_ ||
+        h.depth_offset + 4 * n > size_) {
+      unmap();
+      return false;
+    }
+    return true;
+  }
+
+  bool valid() const { return data_ != nullptr; }
+  const PreviewHeader& header() const { return *reinterpret_cast<const PreviewHeader*>(data_); }
+  int width() const { return header().width; }
+  int height() const { return header().height; }
+
+  const uint8_t* color() const { return reinterpret_cast<const uint8_t*>(data_ + header().color_offset); }
+  const int32_t* cell_id() const { return reinterpret_cast<const int32_t*>(data_ + header().cell_offset); }
+  const int32_t* material_id() const { return reinterpret_cast<const int32_t*>(data_ + header().material_offset); }
+  const float* depth() const { return reinterpret_cast<const float*>(data_ + header().depth_offset); }
+
+  void unmap() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+private:
+  const char* data_ {nullptr};
+  size_t size_ {0};
+};
+
+// On-disk cache of the view settings and a low resolution preview frame for
+// each model. Entries are keyed by a hash of the model's input files, so any
+// change to the XML results in a new entry and stale ones are never used.
+// The view settings are also kept under a key of the files' locations, which
+// survives edits: a model whose content has no entry yet (say the renderer
+// went down while reloading it) still opens with its last view.
+class PreviewCache {
+public:
+  PreviewCache(const fs::path& root, const std::vector<fs::path>& model_files)
+    : root_(root) {
+    ContentHash hash;
+    hash.update("omc-render-cache-v1");
+    ContentHash location;
+    location.update("omc-render-model-v1");
+    for (const auto& file : model_files) {
+      hash.update(file.filename().string());
+      std::ifstream in(file, std::ios::binary);
+      std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      hash.update(content);
+
+      std::error_code ec;
+      fs::path path = fs::weakly_canonical(file, ec);
+      location.update((ec ? fs::absolute(file) : path).string());
+    }
+    key_ = hash.hex();
+    model_key_ = location.hex();
+  }
+
+  // $XDG_CACHE_HOME/omc-render or ~/.cache/omc-render
+  static fs::path default_root() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+      if (*xdg) return fs::path(xdg) / "omc-render";
+    }
+    if (const char* home = std::getenv("HOME")) {
+      return fs::path(home) / ".cache" / "omc-render";
+    }
+    return fs::temp_directory_path() / "omc-render";
+  }
+
+  const std::string& key() const { return key_; }
+  fs::path entry_dir() const { return root_ / key_; }
+  fs::path settings_path() const { return entry_dir() / "view.txt"; }
+  fs::path preview_path() const { return entry_dir() / "preview.bin"; }
+  fs::path mesh_path(const std::string& name) const { return entry_dir() / (name + ".mesh"); }
+
+  fs::path model_settings_path() const { return root_ / ("model-" + model_key_) / "view.txt"; }
+
+  bool has_entry() const { return fs::exists(settings_path()); }
+
+  bool read_settings(std::string& text) const {
+    return read_file(settings_path(), text);
+  }
+
+  // The last view settings stored for a model at these locations, whatever
+  // its content was
+  bool read_model_settings(std::string& text) const {
+    return read_file(model_settings_path(), text);
+  }
+
+  bool map_preview(MappedPreview& preview) const {
+    return preview.map(preview_path());
+  }
+
+  // Write the view settings and preview frame. Files are written to a
+  // temporary name first so a crash never leaves a partial entry behind.
+  bool store(const std::string& settings, const Frame& frame) {
+    std::error_code ec;
+    fs::create_directories(entry_dir(), ec);
+    if (ec) return false;
+
+    if (!write_file(settings_path(), [&](std::ofstream& out) { out << settings; })) return false;
+    if (frame.size() > 0 && !write_file(preview_path(), [&](std::ofstream& out) { write_preview(out, frame); })) return false;
+
+    // touch the entry so pruning keeps recently used models
+    fs::last_write_time(entry_dir(), fs::file_time_type::clock::now(), ec);
+    prune();
+    return store_model_settings(settings);
+  }
+
+  bool store_model_settings(const std::string& settings) {
+    std::error_code ec;
+    fs::create_directories(model_settings_path().parent_path(), ec);
+    if (ec) return false;
+    return write_file(model_settings_path(), [&](std::ofstream& out) { out << settings; });
+  }
+
+  // Keep only the most recently used entries
+  void prune(size_t max_entries = 32) {
+    std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+    for (const auto& entry : fs::directory_iterator(root_, ec)) {
+      if (entry.is_directory()) entries.emplace_back(entry.last_write_time(ec), entry.path());
+    }
+    if (entries.size() <= max_entries) return;
+
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() - max_entries; i++) {
+      fs::remove_all(entries[i].second, ec);
+    }
+  }
+
+  // Write a file under a temporary name and move it into place
+  template<typename Writer>
+  static bool write_file(const fs::path& path, Writer writer) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      if (!out) return false;
+      writer(out);
+      if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+  }
+
+private:
+  static bool read_file(const fs::path& path, std::string& text) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    text = ss.str();
+    return true;
+  }
+
+  static void write_preview(std::ofstream& out, const Frame& frame) {
+    size_t n = frame.size();
+    auto align = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+
+    PreviewHeader h;
+    std::memcpy(h.magic, PREVIEW_MAGIC, sizeof(PREVIEW_MAGIC));
+    h.width = frame.width;
+    h.height = frame.height;
+    h.color_offset = align(sizeof(PreviewHeader));
+    h.cell_offset = align(h.color_offset + 3 * n);
+    h.material_offset = align(h.cell_offset + 4 * n);
+    h.depth_offset = align(h.material_offset + 4 * n);
+    h.file_size = h.depth_offset + 4 * n;
+
+    auto pad_to = [&out](uint64_t offset) {
+      while (static_cast<uint64_t>(out.tellp()) < offset) out.put('\0');
+    };
+
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    pad_to(h.color_offset);
+    for (const auto& c : frame.color) {
+      const char rgb[3] = {static_cast<char>(c.red), static_cast<char>(c.green), static_cast<char>(c.blue)};
+      out.write(rgb, 3);
+    }
+    pad_to(h.cell_offset);
+    out.write(reinterpret_cast<const char*>(frame.cell_id.data()), 4 * n);
+    pad_to(h.material_offset);
+    out.write(reinterpret_cast<const char*>(frame.material_id.data()), 4 * n);
+    pad_to(h.depth_offset);
+    out.write(reinterpret_cast<const char*>(frame.depth.data()), 4 * n);
+  }
+
+  fs::path root_;
+  std::string key_;
+  std::string model_key_;
+};
+
+#endif // include guard
@@ -0,0 +1,127 @@
+#ifndef OPENMC_RENDER_QUATERNION_H
+#define OPENMC_RENDER_QUATERNION_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "openmc/position.h"
+
+// Unit quaternion for camera rotations
+struct Quaternion {
+  float w, x, y, z;
+
+  Quaternion() : w(1.0f), x(0.0f), y(0.0f), z(0.0f) {}
+
+  Quaternion(float w, float x, float y, float z)
+    : w(w), x(x), y(y), z(z) {}
+
+  static Quaternion fromAxisAngle(float angle, float ax, float ay, float az) {
+    float halfAngle = angle * 0.5f;
+    float s = std::sin(halfAngle);
+    float length = std::sqrt(ax * ax + ay * ay + az * az);
+    if (length > 0.0f) {
+      s /= length;
+    }
+    return Quaternion(std::cos(halfAngle), ax * s, ay * s, az * s);
+  }
+
+  // Rotation taking the x, y and z axes to the orthonormal right, up and
+  // back vectors
+  static Quaternion fromBasis(const openmc::Direction& right, const openmc::Direction& up,
+                              const openmc::Direction& back) {
+    double m00 = right[0], m01 = up[0], m02 = back[0];
+    double m10 = right[1], m11 = up[1], m12 = back[1];
+    double m20 = right[2], m21 = up[2], m22 = back[2];
+    double trace = m00 + m11 + m22;
+    double qw, qx, qy, qz;
+    if (trace > 0.0) {
+      double s = 2.0 * std::sqrt(trace + 1.0);
+      qw = 0.25 * s;
+      qx = (m21 - m12) / s;
+      qy = (m02 - m20) / s;
+      qz = (m10 - m01) / s;
+    } else if (m00 > m11 && m00 > m22) {
+      double s = 2.0 * std::sqrt(1.0 + m00 - m11 - m22);
+      qw = (m21 - m12) / s;
+      qx = 0.25 * s;
+      qy = (m01 + m10) / s;
+      qz = (m02 + m20) / s;
+    } else if (m11 > m22) {
+      double s = 2.0 * std::sqrt(1.0 + m11 - m00 - m22);
+      qw = (m02 - m20) / s;
+      qx = (m01 + m10) / s;
+      qy = 0.25 * s;
+      qz = (m12 + m21) / s;
+    } else {
+      double s = 2.0 * std::sqrt(1.0 + m22 - m00 - m11);
+      qw = (m10 - m01) / s;
+      qx = (m02 + m20) / s;
+      qy = (m12 + m21) / s;
+      qz = 0.25 * s;
+    }
+    Quaternion q(qw, qx, qy, qz);
+    q.normalize();
+    return q;
+  }
+
+  // Spherical interpolation along the shorter arc, t in [0, 1]
+  static Quaternion slerp(const Quaternion& a, Quaternion b, float t) {
+    float dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+    if (dot < 0.0f) {
+      b = Quaternion(-b.w, -b.x, -b.y, -b.z);
+      dot = -dot;
+    }
+    float wa = 1.0f - t, wb = t;
+    if (dot < 0.9995f) {
+      // nearly parallel quaternions fall back to a normalized lerp
+      float theta = std::acos(std::min(dot, 1.0f));
+      float s = std::sin(theta);
+      wa = std::sin(wa * theta) / s;
+      wb = std::sin(wb * theta) / s;
+    }
+    Quaternion q(wa * a.w + wb * b.w, wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z);
+    q.normalize();
+    return q;
+  }
+
+  void normalize() {
+    float len = std::sqrt(w*w + x*x + y*y + z*z);
+    if (len > 0) {
+      w /= len;
+      x /= len;
+      y /= len;
+      z /= len;
+    }
+  }
+
+  // The vector v rotated by this quaternion
+  openmc::Position rotate(const openmc::Position& v) const {
+    float vx = v[0], vy = v[1], vz = v[2];
+
+    // Convert quaternion to rotation matrix and apply
+    float wx = w * x;
+    float wy = w * y;
+    float wz = w * z;
+    float xx = x * x;
+    float xy = x * y;
+    float xz = x * z;
+    float yy = y * y;
+    float yz = y * z;
+    float zz = z * z;
+
+    return {(1 - 2*(yy + zz)) * vx + 2*(xy - wz) * vy + 2*(xz + wy) * vz,
+            2*(xy + wz) * vx + (1 - 2*(xx + zz)) * vy + 2*(yz - wx) * vz,
+            2*(xz - wy) * vx + 2*(yz + wx) * vy + (1 - 2*(xx + yy)) * vz};
+  }
+
+  Quaternion operator*(const Quaternion& q) const {
+    return Quaternion(
+      w*q.w - x*q.x - y*q.y - z*q.z,
+      w*q.x + x*q.w + y*q.z - z*q.y,
+      w*q.y - x*q.z + y*q.w + z*q.x,
+      w*q.z + x*q.y - y*q.x + z*q.w
+    );
+  }
+};
+
+#endif // include guard
@@ -1,6 +1,19 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
+// buffer objects are used without a loader, Mesa and the proprietary
+// drivers all export them from libGL
+#define GL_GLEXT_PROTOTYPES
 #include <GLFW/glfw3.h>
 #include <GL/glu.h>
 #include <vector>
@@ -16,7 +29,22 @@
 #include "imguiwrap.dear.h"
 #include "imguiwrap.helpers.h"
 
+#include "animation.h"
+#include "camera_path.h"
+#include "file_watch.h"
+#include "input_log.h"
+#include "model_inputs.h"
+#include "options.h"
+#include "outline.h"
+#include "tally_overlay.h"
 #include "plotter.h"
+#include "poster.h"
+#include "preview_cache.h"
+#include "quaternion.h"
+#include "surface_mesh.h"
+#include "timing.h"
+#include "tracks.h"
+#include "viewports.h"
 
 class Camera {
 public:
@@ -28,43 +56,7 @@ public:
     float rotationSensitivity;  // Added rotation sensitivity control
 
     // Quaternion for rotation
-    struct Quaternion {
-        float w, x, y, z;
-
-        Quaternion() : w(1.0f), x(0.0f), y(0.0f), z(0.0f) {}
-
-        Quaternion(float w, float x, float y, float z)
-            : w(w), x(x), y(y), z(z) {}
-
-        static Quaternion fromAxisAngle(float angle, float ax, float ay, float az) {
-            float halfAngle = angle * 0.5f;
-            float s = std::sin(halfAngle);
-            float length = std::sqrt(ax * ax + ay * ay + az * az);
-            if (length > 0.0f) {
-                s /= length;
-            }
-            return Quaternion(std::cos(halfAngle), ax * s, ay * s, az * s);
-        }
-
-        void normalize() {
-            float len = std::sqrt(w*w + x*x + y*y + z*z);
-            if (len > 0) {
-                w /= len;
-                x /= len;
-                y /= len;
-                z /= len;
-            }
-        }
-
-        Quaternion operator*(const Quaternion& q) const {
-            return Quaternion(
-                w*q.w - x*q.x - y*q.y - z*q.z,
-                w*q.x + x*q.w + y*q.z - z*q.y,
-                w*q.y - x*q.z + y*q.w + z*q.x,
-                w*q.z + x*q.y - y*q.x + z*q.w
-            );
-        }
-    };
+    using Quaternion = ::Quaternion;
 
     // Camera properties
     double fov;
@@ -246,23 +238,7 @@ public:
     }
 
     void applyRotation(openmc::Position& vec) const {
-        // Apply quaternion rotation
-        float x = vec[0], y = vec[1], z = vec[2];
-
-        // Convert quaternion to rotation matrix and apply
-        float wx = rotation.w * rotation.x;
-        float wy = rotation.w * rotation.y;
-        float wz = rotation.w * rotation.z;
-        float xx = rotation.x * rotation.x;
-        float xy = rotation.x * rotation.y;
-        float xz = rotation.x * rotation.z;
-        float yy = rotation.y * rotation.y;
-        float yz = rotation.y * rotation.z;
-        float zz = rotation.z * rotation.z;
-
-        vec[0] = (1 - 2*(yy + zz)) * x + 2*(xy - wz) * y + 2*(xz + wy) * z;
-        vec[1] = 2*(xy + wz) * x + (1 - 2*(xx + zz)) * y + 2*(yz - wx) * z;
-        vec[2] = 2*(xz - wy) * x + 2*(yz + wx) * y + (1 - 2*(xx + yy)) * z;
+        vec = rotation.rotate(vec);
     }
 
     enum class Axis {
@@ -307,6 +283,48 @@ public:
         updateVectors();
     }
 
+    // Write the camera state as "key values" lines
+    void save(std::ostream& os) const {
+        auto writePosition = [&os](const char* key, const openmc::Position& p) {
+            os << key << " " << p[0] << " " << p[1] << " " << p[2] << "\n";
+        };
+        os << std::setprecision(17);
+        writePosition("camera.position", position);
+        writePosition("camera.look_at", lookAt);
+        writePosition("camera.up", upVector);
+        writePosition("camera.light", lightPosition);
+        os << "camera.rotation " << rotation.w << " " << rotation.x << " " << rotation.y << " " << rotation.z << "\n";
+        os << "camera.view " << zoom << " " << panX << " " << panY << " " << fov << "\n";
+        os << "camera.sensitivity " << zoomSensitivity << " " << panSensitivity << " " << rotationSensitivity << "\n";
+    }
+
+    // Apply the values of one line written by save(). Returns false if the
+    // key isn't a camera setting.
+    bool load(const std::string& key, std::istream& values) {
+        auto readPosition = [&values](openmc::Position& p) {
+            values >> p[0] >> p[1] >> p[2];
+        };
+        if (key == "camera.position") {
+            readPosition(position);
+        } else if (key == "camera.look_at") {
+            readPosition(lookAt);
+        } else if (key == "camera.up") {
+            readPosition(upVector);
+        } else if (key == "camera.light") {
+            readPosition(lightPosition);
+        } else if (key == "camera.rotation") {
+            values >> rotation.w >> rotation.x >> rotation.y >> rotation.z;
+        } else if (key == "camera.view") {
+            values >> zoom >> panX >> panY >> fov;
+        } else if (key == "camera.sensitivity") {
+            values >> zoomSensitivity >> panSensitivity >> rotationSensitivity;
+        } else {
+            return false;
+        }
+        updateVectors();
+        return true;
+    }
+
 private:
 };
 
@@ -320,140 +338,2235 @@ public:
   int image_width_ = 800;
   int image_height_ = 600;
 
-  OpenMCRenderer(int argc, char* argv[]) {
-    openmc_plotter_.initialize(argc, argv);
+  OpenMCRenderer(int argc, char* argv[]) {
+    startup_begin_ = PhaseTimer::Clock::now();
+    options_ = parse_render_options(argc, argv);
+    spans::name_thread("ui");
+    if (!options_.trace_spans.empty()) {
+        spans::recorder().start();
+    }
+    openmc_plotter_.pool().configure(options_.threads);
+    thread_settings_ = options_.threads;
+
+    startup_timer_.start("window and GL setup");
+    if (!glfwInit()) {
+        throw std::runtime_error("Failed to initialize GLFW");
+    }
+
+    if (options_.headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    window_ = glfwCreateWindow(800, 600, "OpenMC Rendering", nullptr, nullptr);
+    if (!window_) {
+        throw std::runtime_error("Failed to create GLFW window");
+        glfwTerminate();
+    }
+
+    glfwMakeContextCurrent(window_);
+    glfwSetMouseButtonCallback(window_, mouseButtonCallback);
+    glfwSetCursorPosCallback(window_, cursorPositionCallback);
+    glfwSetScrollCallback(window_, scrollCallback);
+    glfwSetFramebufferSizeCallback(window_, framebufferSizeCallback);
+    glfwSetKeyCallback(window_, keyCallback);
+    glfwSetWindowUserPointer(window_, this);
+
+    // Create ImGui context
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO(); (void)io;
+    // Setup Dear ImGui style
+    ImGui::StyleColorsDark();
+
+    ImGui_ImplGlfw_InitForOpenGL(window_, true);
+    ImGui_ImplOpenGL3_Init("#version 460");
+
+    glEnable(GL_DEPTH_TEST);
+
+    glfwGetFramebufferSize(window_, &frame_width_, &frame_height_);
+    framebufferSizeCallback(window_, frame_width_, frame_height_);
+    startup_timer_.stop();
+
+    // Start in isometric view
+    camera_.setIsometricView();
+    // Initialize light position to camera position since light follows camera is enabled by default
+    camera_.lightPosition = camera_.getTransformedPosition();
+
+    // Add help overlay state and show it on startup
+    show_help_overlay = true;
+
+    auto model_files = model_input_files(model_input_path(options_.openmc_args));
+
+    if (!options_.statepoint.empty()) {
+        startup_timer_.start("statepoint metadata");
+        openStatepoint(options_.statepoint);
+        startup_timer_.stop();
+    }
+
+    if (!options_.tracks.empty()) {
+        openTracks(options_.tracks);
+    }
+
+    if (!options_.camera_path.empty() && !camera_path_.load(options_.camera_path, camera_path_error_)) {
+        std::cerr << "Error: " << camera_path_error_ << std::endl;
+    }
+
+    if (options_.use_cache) {
+        startup_timer_.start("preview cache");
+        openPreviewCache(model_files);
+        startup_timer_.stop();
+    }
+
+    if (options_.watch) {
+        file_watcher_ = std::make_unique<FileWatcher>(model_files);
+        std::cout << "Watching " << model_files.size() << " model file(s) for changes" << std::endl;
+    }
+
+    // The window is up, now load the model without blocking the UI
+    startModelLoad();
+  }
+
+  ~OpenMCRenderer() {
+    // OpenMC initialization can't be interrupted, wait for it to finish
+    if (loader_.joinable()) {
+        loader_.join();
+    }
+    stopVoxelBuild();
+    track_stream_.stop();
+  }
+
+  enum class LoadState {
+    Loading,
+    Ready,
+    Failed
+  };
+
+  // Initialize OpenMC on a background thread. The plotter must not be
+  // touched by the UI thread until checkModelLoad() reports the model ready.
+  void startModelLoad() {
+    if (loader_.joinable()) {
+        loader_.join();
+    }
+    model_ready_ = false;
+    load_state_ = LoadState::Loading;
+    load_begin_ = PhaseTimer::Clock::now();
+    load_timer_ = PhaseTimer();
+    setLoadStatus(reloading_ ? "Checking model" : "Reading model and building geometry");
+
+    loader_ = std::thread([this]() {
+        try {
+            auto openmc_argv = options_.openmc_argv();
+            if (reloading_) {
+                // OpenMC exits on fatal errors, so the new model is tried in
+                // a child process before the loaded one is dropped
+                load_timer_.start("model check");
+                std::string error = check_model_init(options_.openmc_args);
+                load_timer_.stop();
+                if (!error.empty()) {
+                    throw ModelRejected(error);
+                }
+                setLoadStatus("Rebuilding geometry");
+                openmc_plotter_.reload(options_.openmc_args.size(), openmc_argv.data(), load_timer_);
+            } else {
+                openmc_plotter_.initialize(options_.openmc_args.size(), openmc_argv.data(), load_timer_);
+            }
+            load_state_ = LoadState::Ready;
+        } catch (...) {
+            load_error_ = std::current_exception();
+            load_state_ = LoadState::Failed;
+        }
+        // wake the UI thread in case it is waiting on events
+        glfwPostEmptyEvent();
+    });
+  }
+
+  // Called once per frame on the UI thread to pick up a finished load
+  void checkModelLoad() {
+    if (model_ready_ || load_state_ == LoadState::Loading || !loader_.joinable()) {
+        return;
+    }
+
+    loader_.join();
+    if (load_state_ == LoadState::Failed) {
+        if (!reloading_) {
+            std::rethrow_exception(load_error_);
+        }
+        // retry on the next file change. A model that failed the check
+        // leaves the loaded one in place, which stays in use meanwhile.
+        bool rejected = false;
+        try {
+            std::rethrow_exception(load_error_);
+        } catch (const ModelRejected& e) {
+            reload_error_ = e.what();
+            rejected = true;
+        } catch (const std::exception& e) {
+            reload_error_ = e.what();
+        }
+        std::cerr << "Model reload failed: " << reload_error_ << std::endl;
+        if (rejected && openmc_plotter_.initialized()) {
+            model_ready_ = true;
+            reloading_ = false;
+            scene_version_++;
+            restoreModelState();
+            transferCameraInfo();
+            startVoxelBuild();
+        }
+        return;
+    }
+
+    model_ready_ = true;
+    scene_version_++;
+    if (reloading_) {
+        // the new model content gets its own cache entry
+        if (preview_cache_) {
+            preview_cache_ = std::make_unique<PreviewCache>(cacheRoot(), file_watcher_->files());
+        }
+        restoreModelState();
+        reloading_ = false;
+        std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - load_begin_;
+        load_timer_.report(std::cout, "Model reload timings");
+        std::cout << "Reloaded model in " << elapsed.count() << " s" << std::endl;
+    } else {
+        if (view_restored_) {
+            restoreModelState();
+        }
+        // the cached preview is already a better first image than a coarse trace
+        first_frame_pending_ = !preview_shown_;
+    }
+    transferCameraInfo();
+    startVoxelBuild();
+  }
+
+  enum class ViewMode {
+    Perspective,  // Phong shaded 3D view
+    Slice         // 2D cell/material slice
+  };
+
+  enum class MotionPreview {
+    Off,
+    Voxels,  // ray march the voxel grid
+    Mesh     // rasterize the grid's boundary meshes
+  };
+
+  enum class ViewLayout {
+    Single,
+    Quad  // x, y and z axis views and the perspective view
+  };
+
+  // One view of the quad layout, with its own camera and texture
+  struct Viewport {
+    const char* name {""};
+    Camera camera;  // stale for the active viewport, whose camera is camera_
+    ScheduledView view;
+    Scene scene;  // created on first use, dropped before the model reloads
+    GLuint texture {0};
+    int texture_width {0};
+    int texture_height {0};
+  };
+
+  // Sample the voxel preview grid on a background thread. Tracing continues
+  // as usual in the meantime, the grid is used once it's ready. In mesh mode
+  // the surface meshes are then loaded from the cache or extracted from the
+  // grid; with build_grid false only the meshes are (re)made from the
+  // existing grid, e.g. after the color mode changed.
+  void startVoxelBuild(bool build_grid = true) {
+    stopVoxelBuild();
+    if (build_grid) {
+        // cleared here rather than in the builder so the UI never sees a stale grid
+        openmc_plotter_.clear_voxel_grid();
+        releaseSurfaceMesh();
+    }
+    if (motion_preview_ == MotionPreview::Off || !openmc_plotter_.bounds().finite) {
+        return;
+    }
+
+    bool want_mesh = motion_preview_ == MotionPreview::Mesh;
+    bool by_material = openmc_plotter_.plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats;
+    size_t n_indices = by_material ? openmc::model::materials.size() : openmc::model::cells.size();
+    fs::path mesh_path = meshCachePath(by_material);
+
+    voxel_cancel_ = false;
+    voxel_busy_ = true;
+    voxel_builder_ = std::thread([=]() {
+        SurfaceMesh mesh;
+        bool have_mesh = want_mesh && !mesh_path.empty() && mesh.load(mesh_path) &&
+                         mesh.by_material == by_material && mesh.n_indices() == n_indices;
+        if (have_mesh) {
+            publishSurfaceMesh(std::move(mesh));
+        }
+
+        if (build_grid) {
+            auto begin = PhaseTimer::Clock::now();
+            if (openmc_plotter_.build_voxel_grid(voxel_settings_, voxel_cancel_)) {
+                const VoxelGrid& grid = openmc_plotter_.voxel_grid();
+                std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - begin;
+                std::cout << "Built " << grid.nx() << "x" << grid.ny() << "x" << grid.nz()
+                          << " voxel preview in " << elapsed.count() << " s" << std::endl;
+            }
+        }
+
+        if (want_mesh && !have_mesh && !voxel_cancel_ && openmc_plotter_.voxel_grid().ready()) {
+            auto begin = PhaseTimer::Clock::now();
+            mesh = openmc_plotter_.extract_surface_mesh(by_material);
+            std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - begin;
+            std::cout << "Extracted " << mesh.n_quads() << " quads in " << elapsed.count() << " s" << std::endl;
+            if (!mesh_path.empty()) {
+                mesh.save(mesh_path);
+            }
+            publishSurfaceMesh(std::move(mesh));
+        }
+
+        voxel_busy_ = false;
+        glfwPostEmptyEvent();
+    });
+  }
+
+  // Meshes are cached next to the preview, keyed by color mode and grid size
+  fs::path meshCachePath(bool by_material) const {
+    if (!preview_cache_) {
+        return {};
+    }
+    int n[3];
+    VoxelGrid::dimensions(openmc_plotter_.bounds(), voxel_settings_, n);
+    std::ostringstream name;
+    name << (by_material ? "materials-" : "cells-") << n[0] << "x" << n[1] << "x" << n[2];
+    return preview_cache_->mesh_path(name.str());
+  }
+
+  // Hand a mesh from the builder thread to the UI thread for upload
+  void publishSurfaceMesh(SurfaceMesh&& mesh) {
+    std::lock_guard<std::mutex> lock(mesh_mutex_);
+    pending_mesh_ = std::make_unique<SurfaceMesh>(std::move(mesh));
+  }
+
+  // Called once per frame on the UI thread: upload newly published meshes and
+  // start an extraction when the color mode no longer matches the mesh
+  void updateSurfaceMesh() {
+    std::unique_ptr<SurfaceMesh> mesh;
+    {
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        mesh = std::move(pending_mesh_);
+    }
+    if (mesh) {
+        uploadSurfaceMesh(*mesh);
+    }
+
+    if (motion_preview_ == MotionPreview::Mesh && !voxel_busy_ &&
+        openmc_plotter_.voxel_grid().ready() && !surfaceMeshCurrent()) {
+        startVoxelBuild(false);
+    }
+  }
+
+  void uploadSurfaceMesh(const SurfaceMesh& mesh) {
+    if (!mesh_vbo_) {
+        glGenBuffers(1, &mesh_vbo_);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mesh_first_.assign(mesh.first.begin(), mesh.first.end());
+    mesh_count_.assign(mesh.count.begin(), mesh.count.end());
+    mesh_by_material_ = mesh.by_material;
+  }
+
+  void releaseSurfaceMesh() {
+    {
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        pending_mesh_.reset();
+    }
+    if (mesh_vbo_) {
+        glDeleteBuffers(1, &mesh_vbo_);
+        mesh_vbo_ = 0;
+    }
+    mesh_first_.clear();
+    mesh_count_.clear();
+  }
+
+  // True if the uploaded meshes belong to the current color mode
+  bool surfaceMeshCurrent() {
+    bool by_material = openmc_plotter_.plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats;
+    return mesh_vbo_ && mesh_by_material_ == by_material;
+  }
+
+  bool motionPreviewReady() {
+    switch (motion_preview_) {
+    case MotionPreview::Voxels:
+        return openmc_plotter_.voxel_grid().ready();
+    case MotionPreview::Mesh:
+        return surfaceMeshCurrent();
+    default:
+        return false;
+    }
+  }
+
+  // Rasterize the visible meshes with the plot's camera. The projection
+  // matches CameraRays for the plot's image size, flipped vertically like
+  // the traced image is when drawn by drawBackground, so the mesh lines up
+  // with the exact image that replaces it when the camera stops.
+  void drawSurfaceMesh() {
+    const auto& plot = openmc_plotter_.plot();
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT);
+    openmc::RGBColor background = plot->not_found_;
+    glClearColor(background.red / 255.0f, background.green / 255.0f, background.blue / 255.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    pushPlotCamera();
+
+    // diffuse lighting from the plot's light with its ambient fraction
+    float diffuse_fraction = plot->diffuse_fraction();
+    openmc::Position light = plot->light_location();
+    GLfloat light_position[4] = {static_cast<GLfloat>(light[0]), static_cast<GLfloat>(light[1]), static_cast<GLfloat>(light[2]), 1.0f};
+    GLfloat light_diffuse[4] = {1.0f - diffuse_fraction, 1.0f - diffuse_fraction, 1.0f - diffuse_fraction, 1.0f};
+    GLfloat ambient[4] = {diffuse_fraction, diffuse_fraction, diffuse_fraction, 1.0f};
+    GLfloat black[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambient);
+    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+    glLightfv(GL_LIGHT0, GL_AMBIENT, black);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, black);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo_);
+    glInterleavedArrays(GL_N3F_V3F, 0, nullptr);
+    for (int index : plot->opaque_ids()) {
+        if (index < 0 || static_cast<size_t>(index) >= mesh_count_.size() || mesh_count_[index] == 0) {
+            continue;
+        }
+        const openmc::RGBColor& color = plot->colors_[index];
+        glColor3ub(color.red, color.green, color.blue);
+        glDrawArrays(GL_QUADS, mesh_first_[index], mesh_count_[index]);
+    }
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    popPlotCamera();
+    glPopAttrib();
+  }
+
+  // Near and far planes for rasterizing with the plot's camera, enclosing
+  // the model's bounding sphere (or the tracks' without finite bounds)
+  void plotCameraPlanes(double& near_plane, double& far_plane) {
+    const ModelBounds& bounds = openmc_plotter_.bounds();
+    openmc::Position lower = bounds.finite ? bounds.lower : track_lower_;
+    openmc::Position upper = bounds.finite ? bounds.upper : track_upper_;
+    openmc::Position center = (lower + upper) * 0.5;
+    double radius = 0.5 * (upper - lower).norm();
+    double distance = (center - openmc_plotter_.plot()->camera_position()).norm();
+    far_plane = distance + radius;
+    near_plane = std::max(1e-4 * far_plane, distance - radius);
+  }
+
+  // Load projection and modelview matrices matching CameraRays for the
+  // plot's image size, flipped vertically like the traced image is when
+  // drawn by drawBackground
+  void pushPlotCamera() {
+    const auto& plot = openmc_plotter_.plot();
+    double aspect = static_cast<double>(plot->pixels()[1]) / plot->pixels()[0];
+    double tan_half_fov = std::tan(0.5 * plot->horizontal_field_of_view() * M_PI / 180.0);
+    double near_plane, far_plane;
+    plotCameraPlanes(near_plane, far_plane);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    double x = tan_half_fov * near_plane;
+    double y = x * aspect;
+    glFrustum(-x, x, y, -y, near_plane, far_plane);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    openmc::Position camera = plot->camera_position();
+    openmc::Position look_at = plot->look_at();
+    openmc::Direction up = plot->up();
+    gluLookAt(camera[0], camera[1], camera[2], look_at[0], look_at[1], look_at[2], up[0], up[1], up[2]);
+  }
+
+  void popPlotCamera() {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+  }
+
+  // Start streaming particle tracks from a track file. Chunks are handed over
+  // from the reader thread and uploaded by updateTracks on the GL thread.
+  void openTracks(const std::string& path) {
+    releaseTracks();
+    tracks_path_ = path;
+    track_stream_.start(path, [this](TrackChunk&& chunk) {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        pending_tracks_.push_back(std::move(chunk));
+    });
+  }
+
+  void updateTracks() {
+    std::vector<TrackChunk> chunks;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        chunks.swap(pending_tracks_);
+    }
+    for (auto& chunk : chunks) {
+        TrackBuffer buffer;
+        glGenBuffers(1, &buffer.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
+        glBufferData(GL_ARRAY_BUFFER, chunk.vertices.size() * sizeof(float), chunk.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (const Track& track : chunk.tracks) {
+            for (int i = 0; i < 3; i++) {
+                track_lower_[i] = std::min<double>(track_lower_[i], track.center[i] - track.radius);
+                track_upper_[i] = std::max<double>(track_upper_[i], track.center[i] + track.radius);
+            }
+        }
+        tracks_loaded_ += chunk.tracks.size();
+        track_segments_loaded_ += chunk.segments;
+        buffer.tracks = std::move(chunk.tracks);
+        track_buffers_.push_back(std::move(buffer));
+    }
+  }
+
+  void releaseTracks() {
+    track_stream_.stop();
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        pending_tracks_.clear();
+    }
+    for (auto& buffer : track_buffers_) {
+        glDeleteBuffers(1, &buffer.vbo);
+    }
+    track_buffers_.clear();
+    tracks_loaded_ = 0;
+    track_segments_loaded_ = 0;
+    track_lower_ = {openmc::INFTY, openmc::INFTY, openmc::INFTY};
+    track_upper_ = {-openmc::INFTY, -openmc::INFTY, -openmc::INFTY};
+  }
+
+  // Write a frame's G-buffer depth into the GL depth buffer so the tracks
+  // are hidden by the traced geometry. Frame depths are distances along the
+  // primary rays, converted here to window depths of the plot camera.
+  void writeFrameDepth(const Frame& frame) {
+    double near_plane, far_plane;
+    plotCameraPlanes(near_plane, far_plane);
+    CameraRays rays(*openmc_plotter_.plot(), frame.width, frame.height);
+    track_depth_.resize(static_cast<size_t>(frame.width) * frame.height);
+    openmc_plotter_.pool().parallel_for(frame.height, [&](size_t r, int) {
+        int row = frame.y0 + static_cast<int>(r);
+        for (int col = 0; col < frame.width; col++) {
+            float depth = frame.depth[frame.index(col, row)];
+            float window_z = 1.0f;
+            if (std::isfinite(depth)) {
+                double z = depth * rays.direction(col + 0.5, row + 0.5).dot(rays.forward());
+                z = far_plane * (z - near_plane) / (z * (far_plane - near_plane));
+                window_z = static_cast<float>(std::max(0.0, std::min(1.0, z)));
+            }
+            track_depth_[r * frame.width + col] = window_z;
+        }
+    });
+
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(window_, &fb_width, &fb_height);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    glWindowPos2i(0, 0);
+    glPixelZoom(static_cast<float>(fb_width) / frame.width, static_cast<float>(fb_height) / frame.height);
+    glDrawPixels(frame.width, frame.height, GL_DEPTH_COMPONENT, GL_FLOAT, track_depth_.data());
+    glPixelZoom(1.0f, 1.0f);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  }
+
+  // Draw the loaded tracks over the image on screen. depth is the frame
+  // shown by drawBackground, nullptr when the GL depth buffer already holds
+  // the rasterized surface mesh.
+  void drawTracks(const Frame* depth) {
+    track_list_.clear();
+    if (!show_tracks_ || track_buffers_.empty() || view_mode_ == ViewMode::Slice) {
+        return;
+    }
+    const auto& plot = openmc_plotter_.plot();
+    CameraRays rays(*plot, plot->pixels()[0], plot->pixels()[1]);
+    TrackView view;
+    view.camera = rays.origin();
+    view.forward = rays.forward();
+    view.tan_half_fov_x = std::tan(0.5 * plot->horizontal_field_of_view() * M_PI / 180.0);
+    view.tan_half_fov_y = view.tan_half_fov_x * plot->pixels()[1] / plot->pixels()[0];
+    view.pixel_angle = rays.pixel_angle();
+    view.max_error = track_max_error_;
+    view.min_size = track_min_size_;
+
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT |
+                 GL_CURRENT_BIT | GL_LINE_BIT);
+    if (depth && depth->has_gbuffer()) {
+        writeFrameDepth(*depth);
+    } else if (depth) {
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_LINE_SMOOTH);
+    glLineWidth(track_line_width_);
+
+    pushPlotCamera();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    TrackDrawList chunk_list;
+    for (const auto& buffer : track_buffers_) {
+        chunk_list.clear();
+        cull_tracks(buffer.tracks, view, chunk_list);
+        if (chunk_list.tracks == 0) continue;
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
+        glVertexPointer(3, GL_FLOAT, 0, nullptr);
+        for (int type = 0; type < particle_types; type++) {
+            if (chunk_list.first[type].empty()) continue;
+            const float* color = track_colors_[type];
+            glColor4f(color[0], color[1], color[2], track_opacity_);
+            glMultiDrawArrays(GL_LINE_STRIP, chunk_list.first[type].data(), chunk_list.count[type].data(),
+                              static_cast<GLsizei>(chunk_list.first[type].size()));
+        }
+        track_list_.tracks += chunk_list.tracks;
+        track_list_.segments += chunk_list.segments;
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    popPlotCamera();
+    glPopAttrib();
+  }
+
+  void displayTrackSettings() {
+    ImGui::Text("Particle Tracks");
+    static char tracks_path[256] = "tracks.h5";
+    if (!tracks_path_.empty() && std::strcmp(tracks_path, "tracks.h5") == 0) {
+        std::snprintf(tracks_path, sizeof(tracks_path), "%s", tracks_path_.c_str());
+    }
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputText("##TracksPath", tracks_path, sizeof(tracks_path));
+    ImGui::SameLine();
+    if (ImGui::Button("Open##Tracks")) {
+        openTracks(tracks_path);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Stream particle tracks from an OpenMC track file");
+    }
+    std::string error = track_stream_.error();
+    if (!error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+    }
+    if (tracks_path_.empty()) {
+        return;
+    }
+
+    ImGui::Checkbox("Show tracks", &show_tracks_);
+    if (!track_stream_.done()) {
+        ImGui::SameLine();
+        ImGui::Text("loading %.0f%%", 100.0 * track_stream_.progress());
+    }
+    ImGui::SetNextItemWidth(100);
+    ImGui::SliderFloat("Max error (px)", &track_max_error_, 0.25f, 8.0f, "%.2f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Allowed deviation of a simplified track from the exact one");
+    }
+    ImGui::SetNextItemWidth(100);
+    ImGui::SliderFloat("Min size (px)", &track_min_size_, 0.0f, 8.0f, "%.1f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Tracks with a smaller extent on screen aren't drawn");
+    }
+    ImGui::SetNextItemWidth(100);
+    ImGui::SliderFloat("Line width", &track_line_width_, 1.0f, 4.0f, "%.1f");
+    ImGui::SetNextItemWidth(100);
+    ImGui::SliderFloat("Opacity##Tracks", &track_opacity_, 0.1f, 1.0f, "%.2f");
+    ImGui::Text("%zu of %zu tracks, %zu of %zu segments", track_list_.tracks, tracks_loaded_,
+                track_list_.segments, track_segments_loaded_);
+  }
+
+  // The grid holds indices into the current model, it has to be discarded
+  // before the model is rebuilt
+  void stopVoxelBuild() {
+    if (voxel_builder_.joinable()) {
+        voxel_cancel_ = true;
+        voxel_builder_.join();
+    }
+    voxel_busy_ = false;
+  }
+
+  // True while the camera is being dragged or has changed recently. The
+  // voxel preview is drawn during motion, the exact trace once it settles.
+  bool cameraMoving() {
+    openmc::Position position = camera_.getTransformedPosition();
+    openmc::Position look_at = camera_.getTransformedLookAt();
+    openmc::Direction up = camera_.getTransformedUpVector();
+    auto now = PhaseTimer::Clock::now();
+    if (position != last_camera_position_ || look_at != last_look_at_ ||
+        up != last_up_ || camera_.fov != last_fov_) {
+        last_camera_position_ = position;
+        last_look_at_ = look_at;
+        last_up_ = up;
+        last_fov_ = camera_.fov;
+        last_motion_ = now;
+    }
+    std::chrono::duration<double> since_motion = now - last_motion_;
+    return draggingLeft || draggingMiddle || draggingRight || since_motion.count() < motion_settle_;
+  }
+
+  // Draw the voxel preview at no more than motion_preview_size_ pixels
+  // along the longer side
+  void renderMotionPreview() {
+    int width = openmc_plotter_.plot()->pixels()[0];
+    int height = openmc_plotter_.plot()->pixels()[1];
+    double scale = std::min(1.0, static_cast<double>(motion_preview_size_) / std::max(width, height));
+    width = std::max(1, static_cast<int>(width * scale));
+    height = std::max(1, static_cast<int>(height * scale));
+    openmc_plotter_.render_preview(motion_frame_, width, height);
+    applyTallyOverlay(motion_frame_);
+    applyOutlines(motion_frame_);
+    updateTexture(motion_frame_.width, motion_frame_.height, motion_frame_.color.data());
+  }
+
+  bool quadLayout() const {
+    return layout_ == ViewLayout::Quad && view_mode_ == ViewMode::Perspective;
+  }
+
+  // Switch between one view and the quad view of the x, y and z axis views
+  // and the perspective view. The current camera becomes the perspective
+  // view; the axis views start at its distance.
+  void setLayout(ViewLayout layout) {
+    if (layout == layout_) {
+        return;
+    }
+    if (layout == ViewLayout::Quad) {
+        const char* names[] = {"X", "Y", "Z", "Perspective"};
+        viewports_.resize(4);
+        for (size_t i = 0; i < viewports_.size(); i++) {
+            viewports_[i].name = names[i];
+            viewports_[i].camera = camera_;
+        }
+        viewports_[0].camera.setAxisView(Camera::Axis::X);
+        viewports_[1].camera.setAxisView(Camera::Axis::Y);
+        viewports_[2].camera.setAxisView(Camera::Axis::Z);
+        active_viewport_ = 3;
+    } else {
+        activateViewport(3);
+        releaseViewports();
+    }
+    layout_ = layout;
+  }
+
+  void releaseViewports() {
+    for (Viewport& viewport : viewports_) {
+        if (viewport.texture) {
+            glDeleteTextures(1, &viewport.texture);
+        }
+        viewport.scene.release();
+    }
+    viewports_.clear();
+  }
+
+  // Make a viewport the one controlled by the mouse and keys. Its camera
+  // moves into camera_, which all of the input handlers operate on.
+  void activateViewport(size_t index) {
+    if (index == active_viewport_ || index >= viewports_.size()) {
+        return;
+    }
+    viewports_[active_viewport_].camera = camera_;
+    camera_ = viewports_[index].camera;
+    active_viewport_ = index;
+    transferCameraInfo();
+  }
+
+  // Quadrant under a window position: X, Y on top, Z and perspective below
+  size_t viewportAt(double xpos, double ypos) const {
+    int window_width, window_height;
+    glfwGetWindowSize(window_, &window_width, &window_height);
+    size_t col = xpos >= 0.5 * window_width ? 1 : 0;
+    size_t row = ypos >= 0.5 * window_height ? 1 : 0;
+    return 2 * row + col;
+  }
+
+  const Camera& viewportCamera(size_t index) const {
+    return index == active_viewport_ ? camera_ : viewports_[index].camera;
+  }
+
+  // Trace the viewports that changed through the tile scheduler. Each one
+  // is traced at half the plot's resolution in each direction, so the quad
+  // view costs no more than a single view when all of them change and only
+  // the manipulated one's share otherwise.
+  void renderViewports() {
+    auto pixels = openmc_plotter_.plot()->pixels();
+    int width = std::max(1, pixels[0] / 2);
+    int height = std::max(1, pixels[1] / 2);
+
+    std::vector<ScheduledView*> views;
+    for (size_t i = 0; i < viewports_.size(); i++) {
+        const Camera& camera = viewportCamera(i);
+        ViewSignature& wanted = viewports_[i].view.wanted;
+        wanted.position = camera.getTransformedPosition();
+        wanted.look_at = camera.getTransformedLookAt();
+        wanted.up = camera.getTransformedUpVector();
+        wanted.fov = camera.fov;
+        wanted.light = light_follows_camera && i != active_viewport_ ? wanted.position : camera.lightPosition;
+        wanted.width = width;
+        wanted.height = height;
+        wanted.scene = scene_version_;
+        viewports_[i].view.interactive = i == active_viewport_;
+        views.push_back(&viewports_[i].view);
+    }
+    tile_scheduler_.update(views, openmc_plotter_.tile_size());
+    std::vector<TileScheduler::Job> jobs = tile_scheduler_.schedule(views);
+
+    // each viewport is a scene of its own, with its camera and light and the
+    // settings of the main view
+    std::vector<CameraRays> rays;
+    std::vector<Scene*> scenes;
+    std::vector<Frame*> frames;
+    for (size_t i = 0; i < viewports_.size(); i++) {
+        const ViewSignature& traced = views[i]->traced;
+        rays.emplace_back(traced.position, traced.look_at, traced.up, traced.fov, traced.width, traced.height);
+        Scene& scene = viewports_[i].scene;
+        if (!scene.created()) {
+            scene = openmc_plotter_.create_scene();
+        }
+        scenes.push_back(&scene);
+        frames.push_back(&views[i]->frame);
+    }
+    if (!jobs.empty()) {
+        for (size_t i = 0; i < scenes.size(); i++) {
+            const ViewSignature& traced = views[i]->traced;
+            Scene& scene = *scenes[i];
+            scene.copy_settings(openmc_plotter_.scene());
+            scene.set_camera_position(traced.position);
+            scene.set_look_at(traced.look_at);
+            scene.set_up_vector(traced.up);
+            scene.set_field_of_view(traced.fov);
+            scene.set_light_position(traced.light);
+            scene.set_pixels(traced.width, traced.height);
+        }
+        auto begin = PhaseTimer::Clock::now();
+        openmc_plotter_.render_scene_tiles(scenes, rays, frames, jobs);
+        std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - begin;
+        size_t batch_pixels = 0;
+        for (ScheduledView* view : views) batch_pixels += view->batch_pixels;
+        tile_scheduler_.finished(batch_pixels, elapsed.count());
+    }
+
+    for (size_t i = 0; i < viewports_.size(); i++) {
+        Viewport& viewport = viewports_[i];
+        if (!viewport.view.completed) {
+            continue;
+        }
+        applyTallyOverlay(viewport.view.frame, &rays[i]);
+        applyOutlines(viewport.view.frame);
+        uploadViewport(viewport);
+    }
+  }
+
+  void uploadViewport(Viewport& viewport) {
+    spans::Scope span("texture upload");
+    const Frame& frame = viewport.view.frame;
+    if (!viewport.texture) {
+        glGenTextures(1, &viewport.texture);
+        glBindTexture(GL_TEXTURE_2D, viewport.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, viewport.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (frame.width != viewport.texture_width || frame.height != viewport.texture_height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frame.width, frame.height, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                     frame.color.data());
+        viewport.texture_width = frame.width;
+        viewport.texture_height = frame.height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height, GL_RGB, GL_UNSIGNED_BYTE,
+                        frame.color.data());
+    }
+  }
+
+  // Draw each viewport's last complete image into its quadrant, with its
+  // name and a frame around the active one
+  void drawViewports() {
+    int half_width = frame_width_ / 2;
+    int half_height = frame_height_ / 2;
+    ImDrawList* draw_list = ImGui::GetForegroundDrawList();
+    ImVec2 display = ImGui::GetIO().DisplaySize;
+    for (size_t i = 0; i < viewports_.size(); i++) {
+        size_t col = i % 2, row = i / 2;
+        if (viewports_[i].texture) {
+            // GL viewports count rows from the bottom
+            glViewport(col * half_width, (1 - row) * half_height, half_width, half_height);
+            drawBackground(viewports_[i].texture);
+        }
+        ImVec2 lower(col * 0.5f * display.x, row * 0.5f * display.y);
+        ImVec2 upper(lower.x + 0.5f * display.x, lower.y + 0.5f * display.y);
+        draw_list->AddText(ImVec2(lower.x + 8.0f, lower.y + 6.0f), IM_COL32(255, 255, 255, 220), viewports_[i].name);
+        if (i == active_viewport_) {
+            draw_list->AddRect(lower, upper, IM_COL32(255, 200, 60, 200), 0.0f, 0, 2.0f);
+        } else {
+            draw_list->AddRect(lower, upper, IM_COL32(128, 128, 128, 160));
+        }
+    }
+    glViewport(0, 0, frame_width_, frame_height_);
+  }
+
+  void displayViewportSettings() {
+    int layout = static_cast<int>(layout_);
+    const char* layouts[] = {"Single", "Quad"};
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::Combo("Layout", &layout, layouts, IM_ARRAYSIZE(layouts))) {
+        setLayout(static_cast<ViewLayout>(layout));
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Quad shows the x, y and z axis views and the perspective view.\n"
+                          "Click a view to control it with the mouse and keys");
+    }
+    if (layout_ != ViewLayout::Quad) {
+        return;
+    }
+    ImGui::SetNextItemWidth(150);
+    ImGui::SliderFloat("Frame budget (ms)", &tile_scheduler_.budget_ms, 5.0f, 100.0f, "%.0f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Trace time per frame for views other than the active one,\n"
+                          "which is always traced whole");
+    }
+    for (const Viewport& viewport : viewports_) {
+        const ScheduledView& view = viewport.view;
+        if (view.idle() && view.batch_pixels == 0) {
+            ImGui::Text("%-12s static", viewport.name);
+        } else {
+            ImGui::Text("%-12s %zu px traced, %zu tiles pending", viewport.name, view.batch_pixels,
+                        view.pending.size());
+        }
+    }
+  }
+
+  // Rebuild the geometry after one of the watched input files changed. The
+  // camera lives in the renderer and survives as is, colors and visibility are
+  // stored by ID and re-applied to whatever IDs exist in the new model. The
+  // view is written to the cache first, under a key of the model's location
+  // too, in case the reload takes the process down.
+  void startModelReload() {
+    reload_error_ = validate_model_inputs(file_watcher_->files());
+    if (!reload_error_.empty()) {
+        std::cerr << "Not reloading, invalid XML in " << reload_error_ << std::endl;
+        return;
+    }
+
+    // a previous reload may have failed, in which case the caches are current
+    if (model_ready_) {
+        storePreviewCache();
+        cacheCurrentColors();
+        saved_color_by_ = openmc_plotter_.plot()->color_by();
+    }
+
+    std::cout << "Model input changed, reloading" << std::endl;
+    stopVoxelBuild();
+    // the viewports' plots go before the model they refer to
+    for (Viewport& viewport : viewports_) {
+        viewport.scene.release();
+    }
+    reloading_ = true;
+    startModelLoad();
+  }
+
+  void restoreModelState() {
+    openmc_plotter_.plot()->color_by_ = saved_color_by_;
+    restoreColorCache();
+    // visibility is re-applied by ID every frame in updateVisibleMaterials
+  }
+
+  fs::path cacheRoot() const {
+    return options_.cache_dir.empty() ? PreviewCache::default_root() : fs::path(options_.cache_dir);
+  }
+
+  // Look up the cache entry for this model. If there is one, restore the view
+  // settings and put the cached preview on screen while the model loads.
+  void openPreviewCache(const std::vector<fs::path>& model_files) {
+    preview_cache_ = std::make_unique<PreviewCache>(cacheRoot(), model_files);
+
+    std::string settings;
+    if (!preview_cache_->read_settings(settings)) {
+        // the files changed since the last session, keep the view anyway
+        if (preview_cache_->read_model_settings(settings)) {
+            loadViewState(settings);
+            view_restored_ = true;
+            std::cout << "Restored the last view of this model" << std::endl;
+        }
+        return;
+    }
+    loadViewState(settings);
+    view_restored_ = true;
+
+    MappedPreview preview;
+    if (preview_cache_->map_preview(preview)) {
+        updateTexture(preview.width(), preview.height(), preview.color());
+        preview_shown_ = true;
+        std::cout << "Showing cached preview (" << preview.width() << "x" << preview.height() << ")" << std::endl;
+    }
+  }
+
+  // Save the view settings and a low resolution frame for the next session
+  void storePreviewCache() {
+    if (!preview_cache_ || !plotterAvailable()) {
+        return;
+    }
+
+    cacheCurrentColors();
+    transferCameraInfo();
+    auto pixels = openmc_plotter_.plot()->pixels();
+    int width = std::min(preview_size_, pixels[0]);
+    int height = std::max(1, width * pixels[1] / pixels[0]);
+    Frame frame = openmc_plotter_.create_frame(width, height);
+
+    if (!preview_cache_->store(saveViewState(), frame)) {
+        std::cerr << "Failed to write preview cache " << preview_cache_->entry_dir() << std::endl;
+    }
+  }
+
+  std::string saveViewState() {
+    std::ostringstream os;
+    camera_.save(os);
+    os << "light_follows_camera " << light_follows_camera << "\n";
+    os << "outline " << outline_.enabled << " " << int(outline_.color.red) << " "
+       << int(outline_.color.green) << " " << int(outline_.color.blue) << "\n";
+    os << "color_by " << (openmc_plotter_.plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats ? "materials" : "cells") << "\n";
+
+    auto writeColors = [&os](const char* key, const std::unordered_map<int32_t, openmc::RGBColor>& colors) {
+        for (const auto& [id, color] : colors) {
+            os << key << " " << id << " " << int(color.red) << " " << int(color.green) << " " << int(color.blue) << "\n";
+        }
+    };
+    writeColors("material_color", materialColors);
+    writeColors("cell_color", cellColors);
+
+    auto writeVisibility = [&os](const char* key, const std::unordered_map<int32_t, bool>& visibility) {
+        for (const auto& [id, visible] : visibility) {
+            os << key << " " << id << " " << visible << "\n";
+        }
+    };
+    writeVisibility("material_visible", materialVisibility);
+    writeVisibility("cell_visible", cellVisibility);
+    return os.str();
+  }
+
+  // Apply settings written by saveViewState. Colors and visibility go into
+  // the ID-keyed caches and reach the plotter once the model is loaded.
+  void loadViewState(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream values(line);
+        std::string key;
+        values >> key;
+
+        if (camera_.load(key, values)) {
+            continue;
+        } else if (key == "light_follows_camera") {
+            values >> light_follows_camera;
+        } else if (key == "outline") {
+            bool enabled;
+            int r, g, b;
+            if (values >> enabled >> r >> g >> b) {
+                outline_.enabled = enabled;
+                outline_.color = openmc::RGBColor(r, g, b);
+            }
+        } else if (key == "color_by") {
+            std::string mode;
+            values >> mode;
+            saved_color_by_ = mode == "cells" ? openmc::PlottableInterface::PlotColorBy::cells :
+                                                openmc::PlottableInterface::PlotColorBy::mats;
+        } else if (key == "material_color" || key == "cell_color") {
+            int32_t id;
+            int r, g, b;
+            if (values >> id >> r >> g >> b) {
+                auto& colors = key == "material_color" ? materialColors : cellColors;
+                colors[id] = openmc::RGBColor(r, g, b);
+            }
+        } else if (key == "material_visible" || key == "cell_visible") {
+            int32_t id;
+            bool visible;
+            if (values >> id >> visible) {
+                auto& visibility = key == "material_visible" ? materialVisibility : cellVisibility;
+                visibility[id] = visible;
+            }
+        }
+    }
+  }
+
+  // Mouse input is ignored while the help overlay or (outside of a replay,
+  // where the UI isn't being driven) an ImGui window has it
+  bool inputCaptured() const {
+    return show_help_overlay || (!input_replay_.active() && ImGui::GetIO().WantCaptureMouse);
+  }
+
+  // Cursor position, the one of the replayed events during a replay
+  void cursorPos(double& x, double& y) const {
+    if (input_replay_.active()) {
+        x = replay_cursor_x_;
+        y = replay_cursor_y_;
+    } else {
+        glfwGetCursorPos(window_, &x, &y);
+    }
+  }
+
+  void recordInput(const InputEvent& event) {
+    if (input_recorder_.active()) {
+        input_recorder_.record(event);
+        input_this_frame_ = true;
+    }
+  }
+
+  // View settings changed through the UI, which aren't reproduced by
+  // replaying raw mouse and key events: everything in saveViewState plus the
+  // view mode, resolution and slice plane
+  std::string inputState() {
+    cacheCurrentColors();
+    std::ostringstream os;
+    os << saveViewState();
+    os << "view_mode " << static_cast<int>(view_mode_) << "\n";
+    os << "layout " << static_cast<int>(layout_) << "\n";
+    auto pixels = openmc_plotter_.plot()->pixels();
+    os << "pixels " << pixels[0] << " " << pixels[1] << "\n";
+    const SliceView::Plane& plane = openmc_plotter_.slice().plane();
+    os << std::setprecision(17) << "slice " << static_cast<int>(plane.axis) << " " << plane.azimuth << " "
+       << plane.elevation << " " << plane.offset << " " << plane.pixel_size << "\n";
+    return os.str();
+  }
+
+  void applyInputState(const std::string& text) {
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream values(line);
+        std::string key;
+        values >> key;
+        if (key == "view_mode") {
+            int mode;
+            if (values >> mode) view_mode_ = static_cast<ViewMode>(mode);
+        } else if (key == "pixels") {
+            int width, height;
+            if (values >> width >> height && (width != image_width_ || height != image_height_)) {
+                openmc_plotter_.set_pixels(width, height);
+                image_width_ = width;
+                image_height_ = height;
+            }
+        } else if (key == "layout") {
+            int layout;
+            if (values >> layout) setLayout(static_cast<ViewLayout>(layout));
+        } else if (key == "slice") {
+            SliceView::Plane& plane = openmc_plotter_.slice().plane();
+            int axis;
+            if (values >> axis >> plane.azimuth >> plane.elevation >> plane.offset >> plane.pixel_size) {
+                plane.axis = static_cast<SliceView::Axis>(axis);
+            }
+        }
+    }
+    loadViewState(text);
+    restoreModelState();
+    scene_version_++;
+  }
+
+  // Start recording or replaying once the first full frame is on screen, so
+  // the model load isn't part of the timings
+  void startInputSession() {
+    if (!options_.replay_input.empty()) {
+        std::string error;
+        if (!input_replay_.load(options_.replay_input, error)) {
+            std::cerr << error << std::endl;
+            glfwSetWindowShouldClose(window_, GLFW_TRUE);
+            return;
+        }
+        show_help_overlay = false;
+        draggingLeft = draggingMiddle = draggingRight = false;
+        std::cout << "Replaying " << input_replay_.size() << " input events from " << options_.replay_input << std::endl;
+        input_replay_.start();
+    } else if (!options_.record_input.empty()) {
+        if (!input_recorder_.open(options_.record_input)) {
+            std::cerr << "Can't write input log " << options_.record_input << std::endl;
+            return;
+        }
+        InputEvent event = input_recorder_.event(InputEvent::Type::State);
+        event.state = last_input_state_ = inputState();
+        input_recorder_.record(event);
+        std::cout << "Recording input to " << options_.record_input << std::endl;
+    }
+  }
+
+  // Hand the replayed events that are due to the regular input handlers
+  void replayInput() {
+    if (!input_replay_.active()) {
+        return;
+    }
+    input_replay_.dispatch([this](const InputEvent& e) {
+        switch (e.type) {
+        case InputEvent::Type::Button:
+            replay_cursor_x_ = e.x;
+            replay_cursor_y_ = e.y;
+            mouseButtonUpdate(e.code, e.action, e.mods);
+            break;
+        case InputEvent::Type::Cursor:
+            replay_cursor_x_ = e.x;
+            replay_cursor_y_ = e.y;
+            cursorPositionUpdate(e.x, e.y);
+            break;
+        case InputEvent::Type::Scroll:
+            scrollUpdate(e.x, e.y);
+            break;
+        case InputEvent::Type::Key:
+            keyUpdate(e.code, e.scancode, e.action, e.mods);
+            break;
+        case InputEvent::Type::State:
+            applyInputState(e.state);
+            break;
+        }
+    });
+  }
+
+  // After a frame is on screen: account the replayed events it shows, or
+  // record a snapshot if the frame's UI interaction changed the view
+  void finishInputFrame() {
+    if (input_replay_.active()) {
+        input_replay_.frame_presented();
+        if (input_replay_.finished()) {
+            input_replay_.report(std::cout);
+            input_replay_.stop();
+            glfwSetWindowShouldClose(window_, GLFW_TRUE);
+        }
+    } else if (input_recorder_.active() && plotterAvailable()) {
+        ImGuiIO& io = ImGui::GetIO();
+        if (input_this_frame_ || io.WantCaptureMouse || io.WantCaptureKeyboard) {
+            std::string state = inputState();
+            if (state != last_input_state_) {
+                InputEvent event = input_recorder_.event(InputEvent::Type::State);
+                event.state = state;
+                input_recorder_.record(event);
+                last_input_state_ = std::move(state);
+            }
+        }
+        input_this_frame_ = false;
+    }
+  }
+
+  void setLoadStatus(const std::string& status) {
+    std::lock_guard<std::mutex> lock(load_status_mutex_);
+    load_status_ = status;
+  }
+
+  void displayLoadStatus() {
+    std::string status;
+    {
+        std::lock_guard<std::mutex> lock(load_status_mutex_);
+        status = load_status_;
+    }
+    std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - load_begin_;
+    bool loading = load_state_ == LoadState::Loading;
+
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + 10, viewport->Pos.y + viewport->Size.y - 70), ImGuiCond_Always);
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    ImGui::Begin("Loading", nullptr,
+        ImGuiWindowFlags_NoDecoration |
+        ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoFocusOnAppearing |
+        ImGuiWindowFlags_NoInputs);
+    if (loading) {
+        const char spinner[] = "|/-\\";
+        ImGui::Text("%c Loading model...", spinner[static_cast<int>(elapsed.count() * 8.0) % 4]);
+        ImGui::Text("%s (%.1f s)", status.c_str(), elapsed.count());
+    } else {
+        ImGui::Text("%s", model_ready_ ? "Model reload failed, showing the previous model until the next change"
+                                       : "Model reload failed, waiting for the next change");
+        ImGui::Text("%s", reload_error_.c_str());
+    }
+    ImGui::End();
+  }
+
+  // Show a coarse image as soon as the geometry is available, the full
+  // resolution image follows on the next frame
+  void renderFirstFrame() {
+    auto full_pixels = openmc_plotter_.plot()->pixels();
+    int low_width = std::max(32, full_pixels[0] / first_frame_downsample_);
+    int low_height = std::max(32, full_pixels[1] / first_frame_downsample_);
+
+    startup_timer_.start("low resolution frame");
+    Frame low_res = openmc_plotter_.create_frame(low_width, low_height);
+    updateTexture(low_res.width, low_res.height, low_res.color.data());
+    startup_timer_.stop();
+
+    std::chrono::duration<double> latency = PhaseTimer::Clock::now() - startup_begin_;
+    std::cout << "First frame after " << latency.count() << " s" << std::endl;
+  }
+
+  void reportStartupTimings() {
+    load_timer_.report(std::cout, "Model load timings (background)");
+    startup_timer_.report(std::cout, "Startup timings (UI thread)");
+    std::chrono::duration<double> latency = PhaseTimer::Clock::now() - startup_begin_;
+    std::cout << "Full resolution frame after " << latency.count() << " s" << std::endl;
+  }
+
+  void render() {
+       while (!glfwWindowShouldClose(window_)) {
+        spans::Scope frame_span("frame");
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        replayInput();
+        playCameraPath();
+        camera_.applyTransformations();
+        // join a finished load first, so a change that arrived meanwhile
+        // starts the next one on a free loader thread. Changes stay pending
+        // while an export traces the current model.
+        checkModelLoad();
+        if (file_watcher_ && load_state_ != LoadState::Loading && !exporting_ && file_watcher_->changed()) {
+            startModelReload();
+        }
+        transferCameraInfo();
+        updateVisibleMaterials();
+
+        // Start the Dear ImGui frame
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        // Add help button in lower-right corner
+        const float windowWidth = ImGui::GetIO().DisplaySize.x;
+        const float windowHeight = ImGui::GetIO().DisplaySize.y;
+        ImGui::SetNextWindowPos(ImVec2(windowWidth - 50, windowHeight - 40), ImGuiCond_Always);
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Help Button", nullptr,
+            ImGuiWindowFlags_NoTitleBar |
+            ImGuiWindowFlags_NoResize |
+            ImGuiWindowFlags_AlwaysAutoResize |
+            ImGuiWindowFlags_NoMove |
+            ImGuiWindowFlags_NoSavedSettings);
+        if (ImGui::Button("?")) {
+            show_help_overlay = !show_help_overlay;
+        }
+        ImGui::End();
+
+        // Render help overlay if active
+        if (show_help_overlay) {
+            renderHelpOverlay();
+        }
+
+        // Only show other windows if help overlay is not active
+        if (!show_help_overlay && plotterAvailable()) {
+            displayColorLegend();
+            displaySettings();
+        }
+
+        if (!model_ready_ || !reload_error_.empty()) {
+            displayLoadStatus();
+        }
+
+        if (exporting_) {
+            displayExportProgress();
+        }
+
+        // Any edit in the UI may change what every view shows. Views traced
+        // before it are stale; camera changes are tracked per view.
+        if (ImGui::IsAnyItemActive() || (ImGui::GetIO().WantCaptureMouse && ImGui::IsMouseReleased(0))) {
+            scene_version_++;
+        }
+
+        bool raster_frame = false;
+        const Frame* shown_frame = nullptr;
+        if (plotterAvailable()) {
+            updateSurfaceMesh();
+            updateTracks();
+            if (first_frame_pending_) {
+                renderFirstFrame();
+                first_frame_pending_ = false;
+            } else if (view_mode_ == ViewMode::Slice) {
+                openmc_plotter_.render_slice(frame_);
+                applyTallyOverlay(frame_);
+                applyOutlines(frame_);
+                updateTexture(frame_.width, frame_.height, frame_.color.data());
+            } else if (quadLayout()) {
+                renderViewports();
+            } else if (motionPreviewReady() && cameraMoving()) {
+                if (motion_preview_ == MotionPreview::Mesh) {
+                    raster_frame = true;
+                } else {
+                    renderMotionPreview();
+                    shown_frame = &motion_frame_;
+                }
+            } else {
+                // Update the texture with new image data if the camera has changed
+                openmc_plotter_.render_frame(frame_);
+                if (show_cost_heatmap_) {
+                    applyCostHeatmap(frame_);
+                } else {
+                    applyTallyOverlay(frame_);
+                }
+                applyOutlines(frame_);
+                updateTexture(frame_.width, frame_.height, frame_.color.data());
+                shown_frame = &frame_;
+
+                if (!startup_reported_) {
+                    reportStartupTimings();
+                    startup_reported_ = true;
+                    if (options_.poster.width > 0) {
+                        startPosterExport(options_.poster, true);
+                    } else if (options_.animation.width > 0) {
+                        startAnimationExport(options_.animation, true);
+                    } else if (options_.benchmark_frames > 0) {
+                        runBenchmark();
+                    } else {
+                        startInputSession();
+                    }
+                }
+            }
+        }
+
+        // Draw the background
+        {
+            spans::Scope span("draw");
+            if (quadLayout()) {
+                drawViewports();
+            } else if (raster_frame) {
+                drawSurfaceMesh();
+                drawTracks(nullptr);
+            } else if (texture_) {
+                drawBackground();
+                if (shown_frame) {
+                    drawTracks(shown_frame);
+                }
+            }
+        }
+
+        if (plotterAvailable()) {
+            spans::Scope span("poll events");
+            glfwPollEvents();
+        } else {
+            // nothing to trace right now, don't spin while loading or exporting
+            glfwWaitEventsTimeout(0.05);
+        }
+
+        // Render Dear ImGui
+        {
+            spans::Scope span("imgui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+
+        {
+            spans::Scope span("swap buffers");
+            glfwSwapBuffers(window_);
+        }
+        finishInputFrame();
+    }
+
+    if (input_replay_.active()) {
+        // closed by a replayed key before the last event
+        input_replay_.report(std::cout);
+        input_replay_.stop();
+    }
+    input_recorder_.close();
+
+    if (!options_.trace_spans.empty()) {
+        writeSpans(options_.trace_spans);
+    }
+
+    if (exporting_) {
+        export_cancel_ = true;
+        finishExport();
+    }
+    stopVoxelBuild();
+    releaseTracks();
+    if (layout_ == ViewLayout::Quad) {
+        // the preview cache stores the perspective view
+        activateViewport(3);
+    }
+    releaseViewports();
+    storePreviewCache();
+  }
+
+  // Time frames of the current view at several resolutions with the
+  // runtime-switched and the compile-time specialized tile kernels, then exit
+  void runBenchmark() {
+    const int resolutions[] = {256, 512, 1024, 2048};
+    int frames = options_.benchmark_frames;
+    int width = openmc_plotter_.plot()->pixels()[0];
+    int height = openmc_plotter_.plot()->pixels()[1];
+    bool specialize = openmc_plotter_.specialize_kernels();
+
+    std::cout << "Benchmark: " << frames << " frames per resolution, "
+              << openmc_plotter_.pool().size() << " threads, " << simd::isa << " packets" << std::endl;
+    std::cout << std::setw(12) << "resolution" << std::setw(14) << "runtime ms"
+              << std::setw(16) << "specialized ms" << std::setw(10) << "speedup" << std::endl;
+
+    Frame frame;
+    for (int resolution : resolutions) {
+        openmc_plotter_.set_pixels(resolution, resolution);
+        double ms[2];
+        for (int specialized = 0; specialized < 2; specialized++) {
+            openmc_plotter_.specialize_kernels() = specialized;
+            openmc_plotter_.render_frame(frame);  // warm up
+            auto begin = PhaseTimer::Clock::now();
+            for (int i = 0; i < frames; i++) {
+                openmc_plotter_.render_frame(frame);
+            }
+            std::chrono::duration<double, std::milli> elapsed = PhaseTimer::Clock::now() - begin;
+            ms[specialized] = elapsed.count() / frames;
+        }
+        std::cout << std::setw(12) << (std::to_string(resolution) + "^2") << std::fixed << std::setprecision(2)
+                  << std::setw(14) << ms[0] << std::setw(16) << ms[1]
+                  << std::setw(10) << ms[0] / ms[1] << std::defaultfloat << std::endl;
+    }
+
+    openmc_plotter_.specialize_kernels() = specialize;
+    openmc_plotter_.set_pixels(width, height);
+    benchmarkScaling(frames);
+    glfwSetWindowShouldClose(window_, GLFW_TRUE);
+  }
+
+  // Frame times of the current view over thread counts doubling up to the
+  // CPUs of each placement policy, with the speedup and parallel efficiency
+  // relative to one thread
+  void benchmarkScaling(int frames) {
+    ThreadPool& pool = openmc_plotter_.pool();
+    const ThreadSettings original = pool.settings();
+    const CpuTopology& topology = CpuTopology::get();
+    std::cout << "Thread scaling at " << openmc_plotter_.plot()->pixels()[0] << "x"
+              << openmc_plotter_.plot()->pixels()[1] << ", " << topology.cpus().size() << " CPUs, "
+              << topology.n_nodes() << " NUMA node(s)" << std::endl;
+    std::cout << std::setw(10) << "policy" << std::setw(10) << "threads" << std::setw(12) << "frame ms"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+
+    Frame frame;
+    for (Affinity affinity : {Affinity::None, Affinity::Compact, Affinity::Scatter, Affinity::Numa}) {
+        ThreadSettings settings = original;
+        settings.affinity = affinity;
+        settings.numa_node = 0;
+        int max_threads = topology.default_threads(affinity, 0);
+        double single_ms = 0.0;
+        for (int threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+            settings.threads = threads;
+            pool.configure(settings);
+            openmc_plotter_.render_frame(frame);  // warm up
+            auto begin = PhaseTimer::Clock::now();
+            for (int i = 0; i < frames; i++) {
+                openmc_plotter_.render_frame(frame);
+            }
+            std::chrono::duration<double, std::milli> elapsed = PhaseTimer::Clock::now() - begin;
+            double ms = elapsed.count() / frames;
+            if (threads == 1) single_ms = ms;
+            std::cout << std::setw(10) << affinity_name(affinity) << std::setw(10) << threads
+                      << std::fixed << std::setprecision(2) << std::setw(12) << ms
+                      << std::setw(10) << single_ms / ms << std::setw(11) << 100.0 * single_ms / (ms * threads)
+                      << "%" << std::defaultfloat << std::endl;
+            if (threads >= max_threads) break;
+        }
+    }
+    pool.configure(original);
+  }
+
+  void displayThreadSettings() {
+    ImGui::Text("Render Threads");
+    const CpuTopology& topology = CpuTopology::get();
+    ImGui::SetNextItemWidth(100);
+    ImGui::InputInt("Threads (0: all)", &thread_settings_.threads);
+    thread_settings_.threads = std::max(0, thread_settings_.threads);
+
+    int affinity = static_cast<int>(thread_settings_.affinity);
+    const char* affinities[] = {"None", "Compact", "Scatter", "NUMA node"};
+    ImGui::SetNextItemWidth(100);
+    if (ImGui::Combo("Affinity", &affinity, affinities, IM_ARRAYSIZE(affinities))) {
+        thread_settings_.affinity = static_cast<Affinity>(affinity);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Compact fills one package's cores first, scatter spreads over packages\n"
+                          "and cores, NUMA node keeps all threads on one node's CPUs");
+    }
+    if (thread_settings_.affinity == Affinity::Numa) {
+        ImGui::SetNextItemWidth(100);
+        ImGui::SliderInt("Node", &thread_settings_.numa_node, 0, topology.n_nodes() - 1);
+    }
+
+    int priority = static_cast<int>(thread_settings_.priority);
+    const char* priorities[] = {"Interactive", "Background"};
+    ImGui::SetNextItemWidth(100);
+    if (ImGui::Combo("Priority", &priority, priorities, IM_ARRAYSIZE(priorities))) {
+        thread_settings_.priority = static_cast<Priority>(priority);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Background workers only run on CPUs nothing else needs");
+    }
+
+    if (ImGui::Button("Apply##Threads") && plotterAvailable()) {
+        openmc_plotter_.pool().configure(thread_settings_);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%d threads, %zu CPUs, %d node(s)", openmc_plotter_.pool().size(), topology.cpus().size(),
+                topology.n_nodes());
+  }
+
+  // Open a statepoint for the tally overlay. Only its metadata is read here,
+  // results are read per selection.
+  void openStatepoint(const std::string& path) {
+    try {
+        statepoint_ = std::make_unique<StatepointFile>(path);
+        statepoint_error_.clear();
+        tally_overlay_.selection = StatepointFile::Selection();
+        selectTally(0);
+        tally_overlay_.enabled = !statepoint_->tallies().empty();
+        if (statepoint_->tallies().empty()) {
+            statepoint_error_ = "No structured mesh tallies in " + path;
+        }
+    } catch (const std::exception& e) {
+        statepoint_.reset();
+        statepoint_error_ = e.what();
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+  }
+
+  void selectTally(int index) {
+    StatepointFile::Selection& selection = tally_overlay_.selection;
+    selection.tally = index;
+    selection.nuclide = 0;
+    selection.score = 0;
+    selection.bins.clear();
+    if (index < static_cast<int>(statepoint_->tallies().size())) {
+        selection.bins.assign(statepoint_->tallies()[index].filters.size(), 0);
+    }
+  }
+
+  // Post-process mesh tally colors at the visible hit points (or slice
+  // pixels) of a frame, before outlines
+  void applyTallyOverlay(Frame& frame, const CameraRays* view_rays = nullptr) {
+    if (!tally_overlay_.enabled || !statepoint_ || statepoint_->tallies().empty()) {
+        return;
+    }
+    spans::Scope span("tally overlay");
+    auto begin = PhaseTimer::Clock::now();
+    std::shared_ptr<const StatepointFile::Slice> slice;
+    try {
+        slice = statepoint_->slice(tally_overlay_.selection);
+    } catch (const std::exception& e) {
+        statepoint_error_ = e.what();
+        tally_overlay_.enabled = false;
+        return;
+    }
+    const auto& tally = statepoint_->tallies()[tally_overlay_.selection.tally];
+    const auto& mesh = statepoint_->mesh(tally);
+    auto& pool = openmc_plotter_.pool();
+
+    if (view_mode_ == ViewMode::Slice) {
+        const SliceView& view = openmc_plotter_.slice();
+        draw_tally_overlay(frame, mesh, *slice, tally_overlay_, pool, [&](int col, int row, float) {
+            return view.point(col, row, frame.width, frame.height);
+        });
+    } else {
+        CameraRays rays = view_rays ? *view_rays : CameraRays(*openmc_plotter_.plot(), frame.width, frame.height);
+        draw_tally_overlay(frame, mesh, *slice, tally_overlay_, pool, [&](int col, int row, float depth) {
+            return rays.origin() + rays.direction(col, row) * static_cast<double>(depth);
+        });
+    }
+    tally_slice_ = slice;
+    std::chrono::duration<double, std::milli> elapsed = PhaseTimer::Clock::now() - begin;
+    overlay_ms_ = elapsed.count();
+  }
+
+  void displayTallySettings() {
+    ImGui::Text("Tally Overlay");
+    static char statepoint_path[256] = "";
+    if (statepoint_ && statepoint_path[0] == '\0') {
+        std::snprintf(statepoint_path, sizeof(statepoint_path), "%s", statepoint_->path().c_str());
+    }
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputText("##StatepointPath", statepoint_path, sizeof(statepoint_path));
+    ImGui::SameLine();
+    if (ImGui::Button("Open##Statepoint")) {
+        openStatepoint(statepoint_path);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Read mesh tally results from an OpenMC statepoint file");
+    }
+    if (!statepoint_error_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", statepoint_error_.c_str());
+    }
+    if (!statepoint_ || statepoint_->tallies().empty()) {
+        return;
+    }
+
+    ImGui::Checkbox("Show tally", &tally_overlay_.enabled);
+    if (!tally_overlay_.enabled) {
+        return;
+    }
+
+    StatepointFile::Selection& selection = tally_overlay_.selection;
+    const auto& tallies = statepoint_->tallies();
+    auto tally_label = [&](int i) {
+        std::string label = "Tally " + std::to_string(tallies[i].id);
+        if (!tallies[i].name.empty()) label += " (" + tallies[i].name + ")";
+        return label;
+    };
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::BeginCombo("Tally", tally_label(selection.tally).c_str())) {
+        for (int i = 0; i < static_cast<int>(tallies.size()); i++) {
+            if (ImGui::Selectable(tally_label(i).c_str(), i == selection.tally)) {
+                selectTally(i);
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    const auto& tally = tallies[selection.tally];
+    auto string_combo = [](const char* label, int& index, const std::vector<std::string>& items) {
+        ImGui::SetNextItemWidth(150);
+        if (ImGui::BeginCombo(label, items[index].c_str())) {
+            for (int i = 0; i < static_cast<int>(items.size()); i++) {
+                if (ImGui::Selectable(items[i].c_str(), i == index)) index = i;
+            }
+            ImGui::EndCombo();
+        }
+    };
+    string_combo("Score", selection.score, tally.scores);
+    if (tally.nuclides.size() > 1) {
+        string_combo("Nuclide", selection.nuclide, tally.nuclides);
+    }
+
+    // bins of the tally's other filters
+    for (size_t i = 0; i < tally.filters.size(); i++) {
+        if (static_cast<int>(i) == tally.mesh_filter) continue;
+        const auto& filter = statepoint_->filters()[tally.filters[i]];
+        if (filter.n_bins <= 1) continue;
+        int bin = static_cast<int>(selection.bins[i]);
+        std::string label = filter.type + " bin##Filter" + std::to_string(i);
+        ImGui::SetNextItemWidth(150);
+        if (ImGui::SliderInt(label.c_str(), &bin, 0, static_cast<int>(filter.n_bins) - 1)) {
+            selection.bins[i] = bin;
+        }
+    }
+
+    ImGui::Checkbox("Log scale", &tally_overlay_.log_scale);
+    ImGui::SameLine();
+    ImGui::Checkbox("Rel. error", &tally_overlay_.show_error);
+    ImGui::SetNextItemWidth(150);
+    ImGui::SliderFloat("Opacity##Tally", &tally_overlay_.opacity, 0.0f, 1.0f, "%.2f");
+    if (tally_slice_) {
+        if (tally_overlay_.show_error) {
+            ImGui::Text("0 .. 1 (%.2f ms)", overlay_ms_);
+        } else {
+            ImGui::Text("%.3g .. %.3g (%.2f ms)", tally_overlay_.log_scale ? tally_slice_->min_positive : tally_slice_->min,
+                        tally_slice_->max, overlay_ms_);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Colormap range of the current selection, read %s",
+                              statepoint_->mapped() ? "from the memory mapped file" : "as an HDF5 hyperslab");
+        }
+    }
+  }
+
+  // Replace the colors of a measured frame with its traversal cost
+  void applyCostHeatmap(Frame& frame) {
+    spans::Scope span("cost heatmap");
+    const CostMap& cost = openmc_plotter_.cost_map();
+    if (!openmc_plotter_.measure_cost() || cost.empty()) {
+        return;
+    }
+    cost.draw(frame, cost_metric_, cost_log_scale_, openmc_plotter_.pool());
+  }
+
+  // Traversal cost of the pixel under the cursor, false outside the image
+  bool cursorCost(RayCost& cost) {
+    const CostMap& map = openmc_plotter_.cost_map();
+    if (map.empty()) {
+        return false;
+    }
+    double xpos, ypos;
+    int window_width, window_height;
+    cursorPos(xpos, ypos);
+    glfwGetWindowSize(window_, &window_width, &window_height);
+    int col = static_cast<int>(xpos / std::max(1, window_width) * map.width());
+    int row = static_cast<int>((1.0 - ypos / std::max(1, window_height)) * map.height());
+    if (col < 0 || col >= map.width() || row < 0 || row >= map.height()) {
+        return false;
+    }
+    cost = map.pixel(static_cast<size_t>(row) * map.width() + col);
+    return true;
+  }
+
+  void displayCostSettings() {
+    ImGui::Text("Traversal Cost");
+    ImGui::Checkbox("Measure cost", &openmc_plotter_.measure_cost());
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Count surfaces tested, boundary crossings, cell lookups and lattice\n"
+                          "crossings of every primary ray, per pixel and per cell");
+    }
+    if (!openmc_plotter_.measure_cost()) {
+        show_cost_heatmap_ = false;
+        return;
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Heatmap", &show_cost_heatmap_);
+
+    int metric = static_cast<int>(cost_metric_);
+    const char* metrics[CostMap::n_metrics];
+    for (int i = 0; i < CostMap::n_metrics; i++) {
+        metrics[i] = CostMap::metric_name(static_cast<CostMap::Metric>(i));
+    }
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::Combo("Metric##Cost", &metric, metrics, IM_ARRAYSIZE(metrics))) {
+        cost_metric_ = static_cast<CostMap::Metric>(metric);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Log##Cost", &cost_log_scale_);
+
+    const CostMap& cost = openmc_plotter_.cost_map();
+    if (cost.empty()) {
+        return;
+    }
+    const CellCost& total = cost.total();
+    double pixels = static_cast<double>(cost.width()) * cost.height();
+    ImGui::Text("Per pixel: %.1f surfaces, %.1f crossings", total.surfaces / pixels, total.crossings / pixels);
+    ImGui::Text("%.1f lookups, %.2f lattice crossings", total.lookups / pixels, total.lattice / pixels);
+    ImGui::Text("Ray time %.1f ms, max %.4g %s", cost.time_ms(), cost.max_value(cost_metric_),
+                cost_metric_ == CostMap::Metric::Time ? "us" : "per pixel");
+    RayCost under_cursor;
+    if (!ImGui::GetIO().WantCaptureMouse && cursorCost(under_cursor)) {
+        ImGui::Text("Cursor: %u surf, %u cross, %u look, %u lat, %.1f us", under_cursor.surfaces,
+                    under_cursor.crossings, under_cursor.lookups, under_cursor.lattice, under_cursor.time_us);
+    }
+
+    // most expensive cells or universes for the metric (surface tests for
+    // time, which isn't attributed per cell)
+    const char* groups[] = {"Cells", "Universes"};
+    ImGui::SetNextItemWidth(150);
+    ImGui::Combo("Breakdown##Cost", &cost_breakdown_, groups, IM_ARRAYSIZE(groups));
+    bool by_universe = cost_breakdown_ == 1;
+    const auto& rows = by_universe ? cost.universes() : cost.cells();
+    CostMap::Metric metric_shown = cost_metric_ == CostMap::Metric::Time ? CostMap::Metric::Surfaces : cost_metric_;
+    double sum = CostMap::value(total, metric_shown);
+
+    std::vector<int32_t> order;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (CostMap::value(rows[i], metric_shown) > 0.0) order.push_back(static_cast<int32_t>(i));
+    }
+    size_t n_shown = std::min<size_t>(order.size(), cost_table_rows_);
+    std::partial_sort(order.begin(), order.begin() + n_shown, order.end(), [&](int32_t a, int32_t b) {
+        return CostMap::value(rows[a], metric_shown) > CostMap::value(rows[b], metric_shown);
+    });
+
+    if (ImGui::BeginTable("##CostTable", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn(by_universe ? "Universe" : "Cell");
+        ImGui::TableSetupColumn(by_universe ? "Cells" : "Surfaces");
+        ImGui::TableSetupColumn(CostMap::metric_name(metric_shown));
+        ImGui::TableSetupColumn("%");
+        ImGui::TableHeadersRow();
+        for (size_t i = 0; i < n_shown; i++) {
+            int32_t index = order[i];
+            double value = CostMap::value(rows[index], metric_shown);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (by_universe) {
+                const auto& universe = openmc::model::universes[index];
+                ImGui::Text("%d", universe->id_);
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", universe->cells_.size());
+            } else {
+                ImGui::Text("%d", openmc::model::cells[index]->id_);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", cost.cell_surfaces(index));
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.4g", value);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", sum > 0.0 ? 100.0 * value / sum : 0.0);
+        }
+        ImGui::EndTable();
+    }
+  }
+
+  // Post-process outlines, composited into the frame before upload
+  void applyOutlines(Frame& frame) {
+    if (!outline_.enabled) {
+        return;
+    }
+    spans::Scope span("outlines");
+    auto begin = PhaseTimer::Clock::now();
+    draw_outlines(frame, outline_, openmc_plotter_.pool());
+    std::chrono::duration<double, std::milli> elapsed = PhaseTimer::Clock::now() - begin;
+    outline_ms_ = elapsed.count();
+  }
 
-    if (!glfwInit()) {
-        throw std::runtime_error("Failed to initialize GLFW");
+  // The plotter is shared with background work (model loading, poster
+  // export) and may only be used by the UI thread when this returns true
+  bool plotterAvailable() const {
+    return model_ready_ && !exporting_;
+  }
+
+  // Render a poster on a background thread with the current view
+  void startPosterExport(const PosterSettings& settings, bool exit_when_done) {
+    if (exporting_) {
+        return;
     }
+    transferCameraInfo();
+    updateVisibleMaterials();
+
+    poster_settings_ = settings;
+    std::cout << "Exporting " << settings.width << "x" << settings.height << " poster to " << settings.path << std::endl;
+    std::ostringstream label;
+    label << "Rendering " << settings.width << "x" << settings.height << " to " << settings.path;
+    startExport(label.str(), exit_when_done, [this]() {
+        if (!render_poster(openmc_plotter_, poster_settings_, export_progress_, export_cancel_)) {
+            return false;
+        }
+        std::cout << "Wrote " << poster_settings_.path;
+        return true;
+    });
+  }
 
-    window_ = glfwCreateWindow(800, 600, "OpenMC Rendering", nullptr, nullptr);
-    if (!window_) {
-        throw std::runtime_error("Failed to create GLFW window");
-        glfwTerminate();
+  // Render the frames of the camera path on a background thread with the
+  // current colors and settings
+  void startAnimationExport(const AnimationSettings& settings, bool exit_when_done) {
+    if (exporting_) {
+        return;
+    }
+    if (camera_path_.size() < 2) {
+        std::cerr << "The camera path needs at least two keys" << std::endl;
+        if (exit_when_done) {
+            glfwSetWindowShouldClose(window_, GLFW_TRUE);
+        }
+        return;
+    }
+    transferCameraInfo();
+    updateVisibleMaterials();
+
+    animation_settings_ = settings;
+    animation_path_ = camera_path_;
+    int frames = settings.frame_count(animation_path_);
+    std::cout << "Exporting " << frames << " frames of " << settings.width << "x" << settings.height << " to "
+              << settings.pattern;
+    if (settings.parts > 1) {
+        std::cout << " (part " << settings.part << " of " << settings.parts << ")";
     }
+    std::cout << std::endl;
+    std::ostringstream label;
+    label << "Rendering " << frames << " frames of " << settings.width << "x" << settings.height << " to "
+          << settings.pattern;
+    startExport(label.str(), exit_when_done, [this]() {
+        if (!render_animation(openmc_plotter_, animation_path_, animation_settings_, export_progress_, export_cancel_)) {
+            return false;
+        }
+        std::cout << "Wrote " << animation_settings_.pattern;
+        return true;
+    });
+  }
 
-    glfwMakeContextCurrent(window_);
-    glfwSetMouseButtonCallback(window_, mouseButtonCallback);
-    glfwSetCursorPosCallback(window_, cursorPositionCallback);
-    glfwSetScrollCallback(window_, scrollCallback);
-    glfwSetFramebufferSizeCallback(window_, framebufferSizeCallback);
-    glfwSetKeyCallback(window_, keyCallback);
-    glfwSetWindowUserPointer(window_, this);
+  // Run an export on a background thread. The UI keeps running but doesn't
+  // touch the plotter until the export is done. work returns false if it
+  // was cancelled.
+  void startExport(const std::string& label, bool exit_when_done, std::function<bool()> work) {
+    export_label_ = label;
+    export_exit_when_done_ = exit_when_done;
+    export_progress_ = 0.0f;
+    export_cancel_ = false;
+    export_done_ = false;
+    exporting_ = true;
+
+    export_thread_ = std::thread([this, work]() {
+        spans::name_thread("export");
+        auto begin = PhaseTimer::Clock::now();
+        try {
+            if (work()) {
+                std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - begin;
+                std::cout << " in " << elapsed.count() << " s" << std::endl;
+            } else {
+                std::cout << "Export cancelled" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Export failed: " << e.what() << std::endl;
+        }
+        export_done_ = true;
+        glfwPostEmptyEvent();
+    });
+  }
 
-    // Create ImGui context
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO(); (void)io;
-    // Setup Dear ImGui style
-    ImGui::StyleColorsDark();
+  void finishExport() {
+    export_thread_.join();
+    exporting_ = false;
+    if (export_exit_when_done_) {
+        glfwSetWindowShouldClose(window_, GLFW_TRUE);
+    }
+  }
 
-    ImGui_ImplGlfw_InitForOpenGL(window_, true);
-    ImGui_ImplOpenGL3_Init("#version 460");
+  void displayExportProgress() {
+    if (export_done_) {
+        finishExport();
+        return;
+    }
 
-    glEnable(GL_DEPTH_TEST);
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x + 10, viewport->Pos.y + 10), ImGuiCond_Always);
+    ImGui::Begin("Export", nullptr,
+        ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoSavedSettings);
+    ImGui::Text("%s", export_label_.c_str());
+    ImGui::ProgressBar(export_progress_, ImVec2(300, 0));
+    if (ImGui::Button("Cancel")) {
+        export_cancel_ = true;
+    }
+    ImGui::End();
+  }
 
-    glfwGetFramebufferSize(window_, &frame_width_, &frame_height_);
-    framebufferSizeCallback(window_, frame_width_, frame_height_);
+  // Write the recorded spans as Chrome trace JSON
+  void writeSpans(const std::string& path) {
+    if (spans::recorder().write_chrome_trace(path, spans_error_)) {
+        spans_error_.clear();
+        std::cout << "Wrote " << spans::recorder().size() << " spans to " << path << std::endl;
+    } else {
+        std::cerr << "Error: " << spans_error_ << std::endl;
+    }
+  }
+
+  void displaySpanSettings() {
+    ImGui::Text("Trace Spans");
+    if (!spans::enabled) {
+        ImGui::TextDisabled("Compiled out (OMC_RENDER_SPANS=OFF)");
+        return;
+    }
+    static char spans_path[256] = "omc-render-trace.json";
+    spans::Recorder& recorder = spans::recorder();
+    if (recorder.recording()) {
+        if (ImGui::Button("Stop##Spans")) {
+            recorder.stop();
+        }
+    } else if (ImGui::Button("Record##Spans") && !exporting_) {
+        recorder.start();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Record a span for every frame stage and every tile of every thread");
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu spans", recorder.size());
+    if (recorder.dropped() > 0) {
+        ImGui::SameLine();
+        ImGui::Text("(%zu dropped)", recorder.dropped());
+    }
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputText("##SpansPath", spans_path, sizeof(spans_path));
+    ImGui::SameLine();
+    if (ImGui::Button("Export##Spans")) {
+        writeSpans(spans_path);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Write the spans as Chrome trace JSON (chrome://tracing or Perfetto)");
+    }
+    if (!spans_error_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", spans_error_.c_str());
+    }
+  }
 
-    texture_ = createTextureFromImageData(openmc_plotter_.create_image());
+  // The current camera and light as a key of the camera path
+  CameraKey cameraKey(double time) const {
+    CameraKey key;
+    key.time = time;
+    key.position = camera_.getTransformedPosition();
+    key.look_at = camera_.getTransformedLookAt();
+    key.up = camera_.getTransformedUpVector();
+    key.fov = camera_.fov;
+    key.light = light_follows_camera && !light_control_mode ? key.position : camera_.lightPosition;
+    return key;
+  }
 
-    // Start in isometric view
-    camera_.setIsometricView();
-    // Initialize light position to camera position since light follows camera is enabled by default
-    camera_.lightPosition = camera_.getTransformedPosition();
+  // Put the camera at a key of the camera path, which replaces its
+  // rotation, pan and zoom
+  void applyCameraKey(const CameraKey& key) {
+    camera_.rotation = Camera::Quaternion();
+    camera_.zoom = 0.0f;
+    camera_.panX = 0.0f;
+    camera_.panY = 0.0f;
+    camera_.position = key.position;
+    camera_.lookAt = key.look_at;
+    camera_.upVector = key.up;
+    camera_.fov = key.fov;
+    camera_.lightPosition = key.light;
+    camera_.updateVectors();
     transferCameraInfo();
-
-    // Add help overlay state and show it on startup
-    show_help_overlay = true;
   }
 
-  void render() {
-       while (!glfwWindowShouldClose(window_)) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  // Move the camera along the path in real time while it's playing
+  void playCameraPath() {
+    if (!camera_path_playing_ || !plotterAvailable()) {
+        return;
+    }
+    std::chrono::duration<double> elapsed = PhaseTimer::Clock::now() - camera_path_play_begin_;
+    camera_path_time_ = static_cast<float>(camera_path_.start() + elapsed.count());
+    if (camera_path_time_ >= camera_path_.end()) {
+        camera_path_time_ = static_cast<float>(camera_path_.end());
+        camera_path_playing_ = false;
+    }
+    applyCameraKey(camera_path_.at(camera_path_time_));
+  }
 
-        camera_.applyTransformations();
-        transferCameraInfo();
-        updateVisibleMaterials();
+  void displayCameraPathSettings() {
+    ImGui::Text("Camera Path");
+    ImGui::Text("%zu keys, %.1f s", camera_path_.size(), camera_path_.duration());
 
-        // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+    static float key_time = 0.0f;
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputFloat("##KeyTime", &key_time, 0.0f, 0.0f, "%.2f s");
+    ImGui::SameLine();
+    if (ImGui::Button("Add Key")) {
+        camera_path_.add(cameraKey(key_time));
+        key_time += 2.0f;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Add the current camera and light at this time, replacing a key at the same time");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear##CameraPath")) {
+        camera_path_.clear();
+        camera_path_playing_ = false;
+        key_time = 0.0f;
+    }
 
-        // Add help button in lower-right corner
-        const float windowWidth = ImGui::GetIO().DisplaySize.x;
-        const float windowHeight = ImGui::GetIO().DisplaySize.y;
-        ImGui::SetNextWindowPos(ImVec2(windowWidth - 50, windowHeight - 40), ImGuiCond_Always);
-        ImGui::SetNextWindowBgAlpha(0.35f);
-        ImGui::Begin("Help Button", nullptr,
-            ImGuiWindowFlags_NoTitleBar |
-            ImGuiWindowFlags_NoResize |
-            ImGuiWindowFlags_AlwaysAutoResize |
-            ImGuiWindowFlags_NoMove |
-            ImGuiWindowFlags_NoSavedSettings);
-        if (ImGui::Button("?")) {
-            show_help_overlay = !show_help_overlay;
+    for (size_t i = 0; i < camera_path_.size(); i++) {
+        const CameraKey& key = camera_path_.keys()[i];
+        ImGui::PushID(static_cast<int>(i));
+        ImGui::Text("%6.2f s", key.time);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("View")) {
+            camera_path_playing_ = false;
+            camera_path_time_ = static_cast<float>(key.time);
+            applyCameraKey(key);
         }
-        ImGui::End();
-
-        // Render help overlay if active
-        if (show_help_overlay) {
-            renderHelpOverlay();
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Remove")) {
+            camera_path_.remove(i);
+            ImGui::PopID();
+            break;
         }
+        ImGui::PopID();
+    }
 
-        // Only show other windows if help overlay is not active
-        if (!show_help_overlay) {
-            displayColorLegend();
-            displaySettings();
+    if (camera_path_.size() >= 2) {
+        ImGui::SetNextItemWidth(200);
+        if (ImGui::SliderFloat("##CameraPathTime", &camera_path_time_, static_cast<float>(camera_path_.start()),
+                               static_cast<float>(camera_path_.end()), "%.2f s")) {
+            camera_path_playing_ = false;
+            applyCameraKey(camera_path_.at(camera_path_time_));
         }
+        ImGui::SameLine();
+        if (ImGui::Button(camera_path_playing_ ? "Stop##CameraPath" : "Play##CameraPath")) {
+            camera_path_playing_ = !camera_path_playing_;
+            camera_path_play_begin_ = PhaseTimer::Clock::now();
+        }
+    }
 
-        // Update the texture with new image data if the camera has changed
-        auto newImageData = openmc_plotter_.create_image();
-        updateTexture(newImageData);
-
-        // Draw the background
-        drawBackground();
-
-        glfwPollEvents();
+    static char path_file[256] = "camera.path";
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputText("##CameraPathFile", path_file, sizeof(path_file));
+    ImGui::SameLine();
+    if (ImGui::Button("Save##CameraPath")) {
+        if (camera_path_.save(path_file, camera_path_error_)) {
+            camera_path_error_.clear();
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load##CameraPath")) {
+        camera_path_playing_ = false;
+        if (camera_path_.load(path_file, camera_path_error_)) {
+            camera_path_error_.clear();
+        }
+    }
 
-        // Render Dear ImGui
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // Frames are traced a batch at a time with the tiles of all of them
+    // shared by the threads, and written by a background thread
+    static AnimationSettings animation;
+    static char pattern[256] = "frame_%05d.ppm";
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputInt2("##AnimationSize", &animation.width);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputDouble("fps", &animation.fps, 0.0, 0.0, "%.1f");
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputText("##AnimationPattern", pattern, sizeof(pattern));
+    ImGui::SameLine();
+    if (ImGui::Button("Export##Animation") && camera_path_.size() >= 2) {
+        animation.width = std::max(1, animation.width);
+        animation.height = std::max(1, animation.height);
+        animation.fps = std::max(1.0, animation.fps);
+        animation.pattern = pattern;
+        camera_path_playing_ = false;
+        startAnimationExport(animation, false);
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Render every frame of the path at this size to numbered PPM images");
+    }
 
-        glfwSwapBuffers(window_);
+    if (!camera_path_error_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", camera_path_error_.c_str());
     }
   }
 
   void updateTexture(const openmc::ImageData& imageData) {
-    int width = imageData.shape()[0];
-    int height = imageData.shape()[1];
+    // create_image returns the transposed image, rows are the vertical pixels
+    int width = imageData.shape()[1];
+    int height = imageData.shape()[0];
+    updateTexture(width, height, imageData.data());
+  }
+
+  void updateTexture(int width, int height, const void* rgb) {
+    spans::Scope span("texture upload");
+    // (Re)allocate the texture if the image size changed
+    if (!texture_ || width != texture_width_ || height != texture_height_) {
+        if (texture_) {
+            glDeleteTextures(1, &texture_);
+        }
+        texture_ = createTexture(width, height, rgb);
+        return;
+    }
 
     glBindTexture(GL_TEXTURE_2D, texture_);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, imageData.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb);
   }
 
 
   // Function to create a texture from ImageData
   GLuint createTextureFromImageData(const openmc::ImageData& imageData) {
-    int width = imageData.shape()[0];
-    int height = imageData.shape()[1];
+    return createTexture(imageData.shape()[1], imageData.shape()[0], imageData.data());
+  }
 
+  GLuint createTexture(int width, int height, const void* rgb) {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, imageData.data());
+    // rows of RGB bytes aren't necessarily 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    texture_width_ = width;
+    texture_height_ = height;
+
     return texture;
   }
 
     // Function to draw the background
   void drawBackground() {
+      drawBackground(texture_);
+  }
+
+  // Draw a texture over the whole GL viewport
+  void drawBackground(GLuint texture) {
       glDisable(GL_DEPTH_TEST);
       glMatrixMode(GL_PROJECTION);
       glPushMatrix();
@@ -464,7 +2577,7 @@ public:
       glLoadIdentity();
 
       glEnable(GL_TEXTURE_2D);
-      glBindTexture(GL_TEXTURE_2D, texture_);
+      glBindTexture(GL_TEXTURE_2D, texture);
 
       glBegin(GL_QUADS);
       glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, 0.0f);
@@ -489,20 +2602,32 @@ public:
     if (!renderer) {
       throw std::runtime_error("Failed to get renderer from window user pointer");
     }
-    renderer->mouseButtonUpdate(button, action, mods);
+    if (!renderer->input_replay_.active()) {
+      renderer->mouseButtonUpdate(button, action, mods);
+    }
   }
 
   void mouseButtonUpdate(int button, int action, int mods) {
     // Skip if help overlay is visible or ImGui is handling this event
-    ImGuiIO& io = ImGui::GetIO();
-    if (show_help_overlay || io.WantCaptureMouse) {
+    if (inputCaptured()) {
         return;
     }
 
+    InputEvent event = input_recorder_.event(InputEvent::Type::Button);
+    event.code = button;
+    event.action = action;
+    event.mods = mods;
+    cursorPos(event.x, event.y);
+    recordInput(event);
+
+    if (quadLayout() && action == GLFW_PRESS) {
+        activateViewport(viewportAt(event.x, event.y));
+    }
+
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
       if (action == GLFW_PRESS) {
         draggingLeft = true;
-        glfwGetCursorPos(window_, &lastMouseX, &lastMouseY);
+        cursorPos(lastMouseX, lastMouseY);
       } else if (action == GLFW_RELEASE) {
         draggingLeft = false;
       }
@@ -510,7 +2635,7 @@ public:
     if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
       if (action == GLFW_PRESS) {
         draggingMiddle = true;
-        glfwGetCursorPos(window_, &lastMouseX, &lastMouseY);
+        cursorPos(lastMouseX, lastMouseY);
       } else if (action == GLFW_RELEASE) {
         draggingMiddle = false;
       }
@@ -518,7 +2643,7 @@ public:
     if (button == GLFW_MOUSE_BUTTON_RIGHT) {
       if (action == GLFW_PRESS) {
         draggingRight = true;
-        glfwGetCursorPos(window_, &lastMouseX, &lastMouseY);
+        cursorPos(lastMouseX, lastMouseY);
       } else if (action == GLFW_RELEASE) {
         draggingRight = false;
       }
@@ -531,13 +2656,24 @@ public:
     if (!renderer) {
       throw std::runtime_error("Failed to get renderer from window user pointer");
     }
-    renderer->cursorPositionUpdate(xpos, ypos);
+    if (!renderer->input_replay_.active()) {
+      renderer->cursorPositionUpdate(xpos, ypos);
+    }
   }
 
   void cursorPositionUpdate(double xpos, double ypos) {
     // Skip if help overlay is visible or ImGui is handling this event
-    ImGuiIO& io = ImGui::GetIO();
-    if (show_help_overlay || io.WantCaptureMouse) {
+    if (inputCaptured()) {
+        return;
+    }
+
+    InputEvent event = input_recorder_.event(InputEvent::Type::Cursor);
+    event.x = xpos;
+    event.y = ypos;
+    recordInput(event);
+
+    if (view_mode_ == ViewMode::Slice) {
+        sliceCursorUpdate(xpos, ypos);
         return;
     }
 
@@ -632,18 +2768,76 @@ public:
   }
 
 
+  // Left or middle drag pans the slice, right drag moves the plane along its
+  // normal. Pans are in image pixels, so cached tiles stay aligned.
+  void sliceCursorUpdate(double xpos, double ypos) {
+    if (!plotterAvailable()) {
+        lastMouseX = xpos;
+        lastMouseY = ypos;
+        return;
+    }
+    int window_width, window_height;
+    glfwGetWindowSize(window_, &window_width, &window_height);
+    double scale = static_cast<double>(openmc_plotter_.plot()->pixels()[0]) / std::max(1, window_width);
+    double dx = (xpos - lastMouseX) * scale;
+    double dy = (ypos - lastMouseY) * scale;
+
+    SliceView& slice = openmc_plotter_.slice();
+    if (draggingLeft || draggingMiddle) {
+        // the image's first row is drawn at the bottom of the window
+        slice.pan(-dx, dy);
+    }
+    if (draggingRight) {
+        slice.plane().offset -= dy * slice.plane().pixel_size;
+    }
+    lastMouseX = xpos;
+    lastMouseY = ypos;
+  }
+
+  // Model position under the cursor in slice mode
+  openmc::Position sliceCursorPosition() {
+    double xpos, ypos;
+    int window_width, window_height;
+    cursorPos(xpos, ypos);
+    glfwGetWindowSize(window_, &window_width, &window_height);
+    int width = openmc_plotter_.plot()->pixels()[0];
+    int height = openmc_plotter_.plot()->pixels()[1];
+    double col = xpos / std::max(1, window_width) * width - 0.5;
+    double row = (1.0 - ypos / std::max(1, window_height)) * height - 0.5;
+    return openmc_plotter_.slice().point(col, row, width, height);
+  }
+
   static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     auto renderer = static_cast<OpenMCRenderer*>(glfwGetWindowUserPointer(window));
     if (!renderer) {
       throw std::runtime_error("Failed to get renderer from window user pointer");
     }
-    renderer->scrollUpdate(xoffset, yoffset);
+    if (!renderer->input_replay_.active()) {
+      renderer->scrollUpdate(xoffset, yoffset);
+    }
   }
 
   void scrollUpdate(double xoffset, double yoffset) {
       // Skip if help overlay is visible or ImGui is handling this event
-      ImGuiIO& io = ImGui::GetIO();
-      if (show_help_overlay || io.WantCaptureMouse) {
+      if (inputCaptured()) {
+          return;
+      }
+
+      InputEvent event = input_recorder_.event(InputEvent::Type::Scroll);
+      event.x = xoffset;
+      event.y = yoffset;
+      recordInput(event);
+
+      if (quadLayout()) {
+          double xpos, ypos;
+          cursorPos(xpos, ypos);
+          activateViewport(viewportAt(xpos, ypos));
+      }
+
+      if (view_mode_ == ViewMode::Slice) {
+          if (plotterAvailable()) {
+              openmc_plotter_.slice().zoom(std::pow(1.1, -yoffset));
+          }
           return;
       }
 
@@ -681,6 +2875,11 @@ public:
   }
 
   void transferCameraInfo() {
+      // the plotter belongs to background work until it's available
+      if (!plotterAvailable()) {
+          return;
+      }
+
       openmc_plotter_.set_camera_position(camera_.getTransformedPosition());
       openmc_plotter_.set_look_at(camera_.getTransformedLookAt());
       openmc_plotter_.set_up_vector(camera_.getTransformedUpVector());
@@ -712,6 +2911,8 @@ public:
   }
 
   void framebufferUpdate(int width, int height) {
+      frame_width_ = width;
+      frame_height_ = height;
       glViewport(0, 0, width, height);
       camera_.updateView(width, height);
   }
@@ -844,6 +3045,10 @@ public:
   }
 
   void updateVisibleMaterials() {
+    if (!plotterAvailable()) {
+        return;
+    }
+
     auto& currentVisibilityMap = openmc_plotter_.plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats ?
                                 materialVisibility : cellVisibility;
     for (const auto& [id, visibility] : currentVisibilityMap) {
@@ -855,17 +3060,34 @@ public:
   static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     auto renderer = static_cast<OpenMCRenderer*>(glfwGetWindowUserPointer(window));
     if (!renderer) return;
+    // live input is ignored while a recording is replayed
+    if (renderer->input_replay_.active()) return;
+
+    InputEvent event = renderer->input_recorder_.event(InputEvent::Type::Key);
+    event.code = key;
+    event.scancode = scancode;
+    event.action = action;
+    event.mods = mods;
+    renderer->recordInput(event);
+    renderer->keyUpdate(key, scancode, action, mods);
+  }
+
+  void keyUpdate(int key, int scancode, int action, int mods) {
+    if (action == GLFW_PRESS) {
+        // keys toggle colors and modes as well as moving the camera
+        scene_version_++;
+    }
 
     // Handle help overlay toggle with '?' key
     if (key == GLFW_KEY_SLASH && (mods & GLFW_MOD_SHIFT) && action == GLFW_PRESS) {
-        renderer->show_help_overlay = !renderer->show_help_overlay;
+        show_help_overlay = !show_help_overlay;
         return;
     }
 
     // Handle Escape key
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        if (renderer->show_help_overlay) {
-            renderer->show_help_overlay = false;
+        if (show_help_overlay) {
+            show_help_overlay = false;
             return;
         }
     }
@@ -875,30 +3097,30 @@ public:
         if (action == GLFW_PRESS) {
             if (mods & GLFW_MOD_SHIFT) {
                 // Toggle light follows camera mode
-                renderer->light_follows_camera = !renderer->light_follows_camera;
-                if (renderer->light_follows_camera) {
-                    renderer->camera_.lightPosition = renderer->camera_.getTransformedPosition();
+                light_follows_camera = !light_follows_camera;
+                if (light_follows_camera) {
+                    camera_.lightPosition = camera_.getTransformedPosition();
                 }
-                renderer->transferCameraInfo();
+                transferCameraInfo();
             } else {
-                renderer->light_control_mode = true;
+                light_control_mode = true;
             }
         } else if (action == GLFW_RELEASE && !(mods & GLFW_MOD_SHIFT)) {
-            renderer->light_control_mode = false;
+            light_control_mode = false;
         }
         return;
     }
 
     // Only process other shortcuts if help overlay is not visible
-    if (!renderer->show_help_overlay) {
+    if (!show_help_overlay) {
         if ((key == GLFW_KEY_W || key == GLFW_KEY_Q) && action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL)) {
-            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            glfwSetWindowShouldClose(window_, GLFW_TRUE);
         }
 
         // Handle isometric view
         if (key == GLFW_KEY_I && action == GLFW_PRESS) {
-            renderer->camera_.setIsometricView();
-            renderer->transferCameraInfo();
+            camera_.setIsometricView();
+            transferCameraInfo();
         }
 
         // Handle orthographic views
@@ -906,22 +3128,59 @@ public:
             bool negative = (mods & GLFW_MOD_SHIFT) != 0;
             switch (key) {
                 case GLFW_KEY_X:
-                    renderer->camera_.setAxisView(Camera::Axis::X, negative);
-                    renderer->transferCameraInfo();
+                    camera_.setAxisView(Camera::Axis::X, negative);
+                    transferCameraInfo();
                     break;
                 case GLFW_KEY_Y:
-                    renderer->camera_.setAxisView(Camera::Axis::Y, negative);
-                    renderer->transferCameraInfo();
+                    camera_.setAxisView(Camera::Axis::Y, negative);
+                    transferCameraInfo();
                     break;
                 case GLFW_KEY_Z:
-                    renderer->camera_.setAxisView(Camera::Axis::Z, negative);
-                    renderer->transferCameraInfo();
+                    camera_.setAxisView(Camera::Axis::Z, negative);
+                    transferCameraInfo();
                     break;
             }
         }
     }
   }
 
+  void displaySliceSettings() {
+    SliceView& slice = openmc_plotter_.slice();
+    SliceView::Plane& plane = slice.plane();
+    int axis = static_cast<int>(plane.axis);
+    const char* axes[] = {"xy", "xz", "yz", "Custom"};
+    ImGui::SetNextItemWidth(150);
+    if (ImGui::Combo("Plane", &axis, axes, IM_ARRAYSIZE(axes))) {
+        plane.axis = static_cast<SliceView::Axis>(axis);
+    }
+    if (plane.axis == SliceView::Axis::Custom) {
+        ImGui::SetNextItemWidth(150);
+        ImGui::SliderFloat("Azimuth##Slice", &plane.azimuth, -180.0f, 180.0f, "%.0f deg");
+        ImGui::SetNextItemWidth(150);
+        ImGui::SliderFloat("Elevation##Slice", &plane.elevation, -90.0f, 90.0f, "%.0f deg");
+    }
+
+    const ModelBounds& bounds = openmc_plotter_.bounds();
+    double extent = bounds.finite ? 0.5 * (bounds.upper - bounds.lower).norm() : 100.0;
+    double lower = -extent, upper = extent;
+    ImGui::SetNextItemWidth(150);
+    ImGui::SliderScalar("Offset##Slice", ImGuiDataType_Double, &plane.offset, &lower, &upper, "%.3f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Distance of the plane from the model's center along its normal,\n"
+                          "also changed by dragging with the right mouse button");
+    }
+    if (ImGui::Button("Reset Slice")) {
+        slice.reset(2.0 * extent, openmc_plotter_.plot()->pixels()[0]);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%.4g per pixel", plane.pixel_size);
+
+    openmc::Position cursor = sliceCursorPosition();
+    ImGui::Text("Cursor (%.4g, %.4g, %.4g)", cursor[0], cursor[1], cursor[2]);
+    ImGui::Text("%zu tiles cached, %zu evaluated", slice.cached_tiles(), slice.evaluated_tiles());
+    ImGui::Separator();
+  }
+
   void displaySettings() {
     // Position the window in the right portion of the screen
     const float windowWidth = ImGui::GetIO().DisplaySize.x;
@@ -938,6 +3197,19 @@ public:
     ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
 
     if (ImGui::Begin("Camera Settings")) {
+        // 3D view or 2D slice
+        int view_mode = static_cast<int>(view_mode_);
+        const char* view_modes[] = {"3D view", "2D slice"};
+        ImGui::SetNextItemWidth(150);
+        if (ImGui::Combo("View", &view_mode, view_modes, IM_ARRAYSIZE(view_modes))) {
+            view_mode_ = static_cast<ViewMode>(view_mode);
+        }
+        if (view_mode_ == ViewMode::Slice) {
+            displaySliceSettings();
+        } else {
+            displayViewportSettings();
+        }
+
         // Resolution controls
         ImGui::Text("Image Resolution");
         static int square_resolution = 800;  // Default value
@@ -948,17 +3220,10 @@ public:
             // Clamp to reasonable values
             square_resolution = std::max(32, std::min(4096, square_resolution));
 
-            // Delete existing texture
-            glDeleteTextures(1, &texture_);
-            glFinish();  // Ensure deletion is complete
-
-            // Update plotter dimensions
+            // Update plotter dimensions, the texture is reallocated with
+            // the next frame
             openmc_plotter_.set_pixels(square_resolution, square_resolution);
 
-            // Get new image data and create new texture
-            auto newImageData = openmc_plotter_.create_image();
-            texture_ = createTextureFromImageData(newImageData);
-
             // Update stored dimensions
             image_width_ = square_resolution;
             image_height_ = square_resolution;
@@ -967,6 +3232,173 @@ public:
             ImGui::SetTooltip("Set both width and height to this value");
         }
 
+        if (openmc_plotter_.bounds().finite) {
+            ImGui::Checkbox("Cull rays outside model bounds", &openmc_plotter_.cull_rays());
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Skip geometry queries for pixels that miss the model's bounding box");
+            }
+            if (openmc_plotter_.cull_rays()) {
+                ImGui::SameLine();
+                ImGui::Text("(%.0f%% culled)", 100.0 * openmc_plotter_.culled_fraction());
+            }
+            if (openmc_plotter_.cull_rays() && openmc_plotter_.has_surface_soa()) {
+                ImGui::Checkbox("SIMD surface pre-pass", &openmc_plotter_.simd_prepass());
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Test packets of %d rays against the root universe's surfaces (%s)",
+                                      simd::width, simd::isa);
+                }
+            }
+        }
+        if (openmc_plotter_.has_cell_soa()) {
+            ImGui::Checkbox("SIMD cell surface distances", &openmc_plotter_.simd_cells());
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Find the next boundary of a ray by testing the surfaces of its cells %d at a time (%s)",
+                                  simd::width, simd::isa);
+            }
+        }
+
+        ImGui::Checkbox("Cell outlines", &outline_.enabled);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Outline cell boundaries and silhouettes using the ID and depth buffers");
+        }
+        if (outline_.enabled) {
+            float color[3] = {outline_.color.red / 255.0f, outline_.color.green / 255.0f, outline_.color.blue / 255.0f};
+            ImGui::SameLine();
+            if (ImGui::ColorEdit3("##OutlineColor", color, ImGuiColorEditFlags_NoInputs)) {
+                outline_.color = openmc::RGBColor(static_cast<int>(color[0] * 255), static_cast<int>(color[1] * 255), static_cast<int>(color[2] * 255));
+            }
+            ImGui::SameLine();
+            ImGui::Text("(%.2f ms)", outline_ms_);
+        }
+
+        ImGui::Checkbox("Adaptive anti-aliasing", &openmc_plotter_.antialias());
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Trace 4 extra rays for pixels on cell, material or depth edges only");
+        }
+        if (openmc_plotter_.antialias()) {
+            ImGui::SameLine();
+            ImGui::Text("(%.1f%% of pixels)", 100.0 * openmc_plotter_.edge_fraction());
+        }
+
+        ImGui::Checkbox("Level of detail", &openmc_plotter_.lod_enabled());
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Draw universe and lattice fills whose features are smaller than\n"
+                              "the threshold with their volume-averaged color");
+        }
+        if (openmc_plotter_.lod_enabled()) {
+            ImGui::SetNextItemWidth(150);
+            ImGui::SliderFloat("Threshold (px)", &openmc_plotter_.lod_threshold(), 0.25f, 8.0f, "%.2f");
+        }
+
+        // Cutaway planes and box, applied to the primary rays
+        ImGui::Text("Clipping");
+        ClipRegion& clip = openmc_plotter_.clip();
+        const ModelBounds& bounds = openmc_plotter_.bounds();
+        float extent = bounds.finite ? 0.5f * static_cast<float>((bounds.upper - bounds.lower).norm()) : 100.0f;
+        for (int i = 0; i < ClipRegion::max_planes; i++) {
+            ClipPlane& plane = clip.planes[i];
+            ImGui::PushID(i);
+            ImGui::Checkbox("Plane", &plane.enabled);
+            ImGui::SameLine();
+            ImGui::Text("%d", i + 1);
+            if (plane.enabled) {
+                ImGui::SetNextItemWidth(150);
+                ImGui::SliderFloat("Azimuth", &plane.azimuth, -180.0f, 180.0f, "%.0f deg");
+                ImGui::SetNextItemWidth(150);
+                ImGui::SliderFloat("Elevation", &plane.elevation, -90.0f, 90.0f, "%.0f deg");
+                ImGui::SetNextItemWidth(150);
+                ImGui::SliderFloat("Offset", &plane.offset, -extent, extent, "%.2f");
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Distance of the plane from the model's center along its normal");
+                }
+            }
+            ImGui::PopID();
+        }
+        ImGui::Checkbox("Clip box", &clip.box_enabled);
+        if (clip.box_enabled) {
+            const char* axes[] = {"x", "y", "z"};
+            for (int i = 0; i < 3; i++) {
+                float lo = static_cast<float>(clip.box_lower[i]);
+                float hi = static_cast<float>(clip.box_upper[i]);
+                float speed = std::max(1e-3f, 0.005f * extent);
+                ImGui::SetNextItemWidth(200);
+                if (ImGui::DragFloatRange2(axes[i], &lo, &hi, speed)) {
+                    clip.box_lower[i] = lo;
+                    clip.box_upper[i] = std::max(lo, hi);
+                }
+            }
+        }
+
+        // Coarse preview from a sampled cell grid while the camera moves
+        ImGui::Text("Motion Preview");
+        int preview_mode = static_cast<int>(motion_preview_);
+        const char* preview_modes[] = {"Off", "Voxel ray march", "Raster meshes"};
+        ImGui::SetNextItemWidth(150);
+        if (ImGui::Combo("##MotionPreview", &preview_mode, preview_modes, IM_ARRAYSIZE(preview_modes))) {
+            motion_preview_ = static_cast<MotionPreview>(preview_mode);
+            if (motion_preview_ != MotionPreview::Off && !openmc_plotter_.voxel_grid().ready()) {
+                startVoxelBuild();
+            }
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Draw a voxelized copy of the geometry during camera motion, either\n"
+                              "by ray marching it or as OpenGL meshes of its boundaries");
+        }
+        if (motion_preview_ != MotionPreview::Off && openmc_plotter_.bounds().finite) {
+            ImGui::SetNextItemWidth(100);
+            ImGui::InputInt("Voxels##VoxelResolution", &voxel_settings_.resolution, 16, 64);
+            ImGui::SetNextItemWidth(100);
+            ImGui::InputInt("Memory cap (MB)", &voxel_settings_.memory_cap_mb, 16, 128);
+            if (ImGui::Button("Rebuild Grid")) {
+                voxel_settings_.resolution = std::max(8, std::min(2048, voxel_settings_.resolution));
+                voxel_settings_.memory_cap_mb = std::max(1, voxel_settings_.memory_cap_mb);
+                startVoxelBuild();
+            }
+            const VoxelGrid& grid = openmc_plotter_.voxel_grid();
+            ImGui::SameLine();
+            if (grid.ready()) {
+                ImGui::Text("%dx%dx%d, %.0f MB", grid.nx(), grid.ny(), grid.nz(), grid.memory_bytes() / 1048576.0);
+            } else {
+                ImGui::Text("building %.0f%%", 100.0 * grid.progress());
+            }
+            if (motion_preview_ == MotionPreview::Mesh) {
+                if (surfaceMeshCurrent()) {
+                    size_t n_quads = 0;
+                    for (auto count : mesh_count_) n_quads += count / 4;
+                    ImGui::Text("%zu quads", n_quads);
+                } else {
+                    ImGui::Text("extracting meshes");
+                }
+            }
+        }
+
+        displayCostSettings();
+        displayTallySettings();
+        displayTrackSettings();
+
+        // Poster export, traced in strips so the size isn't limited by memory
+        ImGui::Text("Poster Export");
+        static PosterSettings poster;
+        static char poster_path[256] = "poster.ppm";
+        ImGui::SetNextItemWidth(150);
+        ImGui::InputInt2("##PosterSize", &poster.width);
+        ImGui::SetNextItemWidth(150);
+        ImGui::InputText("##PosterPath", poster_path, sizeof(poster_path));
+        ImGui::SameLine();
+        if (ImGui::Button("Export")) {
+            poster.width = std::max(1, poster.width);
+            poster.height = std::max(1, poster.height);
+            poster.path = poster_path;
+            startPosterExport(poster, false);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Render the current view at this size to a PPM image");
+        }
+
+        displayCameraPathSettings();
+        displaySpanSettings();
+        displayThreadSettings();
+
         ImGui::Separator();
 
         // Light follows camera checkbox
@@ -1027,11 +3459,144 @@ public:
   double lastMouseY;
 
   GLFWwindow* window_ {nullptr};
-  GLuint texture_;
+  GLuint texture_ {0};
+  int texture_width_ {0};
+  int texture_height_ {0};
 
   OpenMCPlotter& openmc_plotter_ {OpenMCPlotter::get_instance()};
   Camera camera_;
 
+  RenderOptions options_;
+  PhaseTimer startup_timer_;
+  PhaseTimer load_timer_;
+  PhaseTimer::Clock::time_point startup_begin_;
+  bool startup_reported_ {false};
+
+  // Background model loading
+  std::thread loader_;
+  std::atomic<LoadState> load_state_ {LoadState::Loading};
+  std::exception_ptr load_error_;
+  std::mutex load_status_mutex_;
+  std::string load_status_;
+  PhaseTimer::Clock::time_point load_begin_;
+  bool model_ready_ {false};  // only read/written on the UI thread
+  bool first_frame_pending_ {false};
+  int first_frame_downsample_ {4};
+
+  // Hot reload of the model input files
+  std::unique_ptr<FileWatcher> file_watcher_;
+  bool reloading_ {false};
+  std::string reload_error_;
+  openmc::PlottableInterface::PlotColorBy saved_color_by_ {openmc::PlottableInterface::PlotColorBy::mats};
+
+  // Most recent traced frame
+  Frame frame_;
+
+  // Poster export
+  std::thread export_thread_;
+  std::string export_label_;
+  PosterSettings poster_settings_;
+  CameraPath camera_path_;       // edited in the UI
+  CameraPath animation_path_;    // copy being exported
+  std::string camera_path_error_;
+  float camera_path_time_ {0.0f};
+  bool camera_path_playing_ {false};
+  PhaseTimer::Clock::time_point camera_path_play_begin_;
+  AnimationSettings animation_settings_;
+  std::atomic<float> export_progress_ {0.0f};
+  std::atomic<bool> export_cancel_ {false};
+  std::atomic<bool> export_done_ {false};
+  bool exporting_ {false};
+  bool export_exit_when_done_ {false};
+
+  std::string spans_error_;
+  ThreadSettings thread_settings_;  // edited in the UI, applied on request
+  InputRecorder input_recorder_;
+  InputReplay input_replay_;
+  double replay_cursor_x_ {0.0};  // cursor of the replayed events
+  double replay_cursor_y_ {0.0};
+  bool input_this_frame_ {false};  // recorded events since the last frame
+  std::string last_input_state_;
+
+  // Outline post-process
+  OutlineSettings outline_;
+  double outline_ms_ {0.0};
+
+  // Traversal cost heatmap and breakdown
+  bool show_cost_heatmap_ {false};
+  CostMap::Metric cost_metric_ {CostMap::Metric::Surfaces};
+  bool cost_log_scale_ {true};
+  int cost_breakdown_ {0};  // cells or universes
+  size_t cost_table_rows_ {12};
+
+  // Mesh tally overlay
+  std::unique_ptr<StatepointFile> statepoint_;
+  std::string statepoint_error_;
+  TallyOverlaySettings tally_overlay_;
+  std::shared_ptr<const StatepointFile::Slice> tally_slice_;
+  double overlay_ms_ {0.0};
+
+  // Particle tracks, uploaded as one vertex buffer per streamed chunk
+  struct TrackBuffer {
+    GLuint vbo {0};
+    std::vector<Track> tracks;
+  };
+  TrackStream track_stream_;
+  std::mutex track_mutex_;
+  std::vector<TrackChunk> pending_tracks_;
+  std::vector<TrackBuffer> track_buffers_;
+  std::string tracks_path_;
+  size_t tracks_loaded_ {0};
+  size_t track_segments_loaded_ {0};
+  openmc::Position track_lower_ {openmc::INFTY, openmc::INFTY, openmc::INFTY};
+  openmc::Position track_upper_ {-openmc::INFTY, -openmc::INFTY, -openmc::INFTY};
+  TrackDrawList track_list_;  // drawn in the last frame
+  std::vector<float> track_depth_;
+  bool show_tracks_ {true};
+  float track_max_error_ {1.0f};
+  float track_min_size_ {0.5f};
+  float track_line_width_ {1.5f};
+  float track_opacity_ {0.9f};
+  // neutron, photon, electron, positron
+  float track_colors_[particle_types][3] = {
+    {0.95f, 0.25f, 0.2f}, {1.0f, 0.85f, 0.2f}, {0.2f, 0.85f, 0.95f}, {0.9f, 0.3f, 0.9f}};
+
+  ViewMode view_mode_ {ViewMode::Perspective};
+
+  // Quad view
+  ViewLayout layout_ {ViewLayout::Single};
+  std::vector<Viewport> viewports_;
+  size_t active_viewport_ {0};
+  TileScheduler tile_scheduler_;
+  uint64_t scene_version_ {0};  // see ViewSignature
+
+  // Voxel preview during camera motion
+  MotionPreview motion_preview_ {MotionPreview::Voxels};
+  VoxelGrid::Settings voxel_settings_;
+  std::thread voxel_builder_;
+  std::atomic<bool> voxel_cancel_ {false};
+  std::atomic<bool> voxel_busy_ {false};
+  std::mutex mesh_mutex_;
+  std::unique_ptr<SurfaceMesh> pending_mesh_;
+  GLuint mesh_vbo_ {0};
+  std::vector<GLint> mesh_first_;
+  std::vector<GLsizei> mesh_count_;
+  bool mesh_by_material_ {true};
+  Frame motion_frame_;
+  int motion_preview_size_ {512};
+  double motion_settle_ {0.15};  // seconds without motion before the exact trace
+  PhaseTimer::Clock::time_point last_motion_;
+  openmc::Position last_camera_position_;
+  openmc::Position last_look_at_;
+  openmc::Direction last_up_;
+  double last_fov_ {0.0};
+
+  // Per-model cache of view settings and a preview image
+  std::unique_ptr<PreviewCache> preview_cache_;
+  bool view_restored_ {false};
+  bool preview_shown_ {false};
+  int preview_size_ {256};
+
   // Add this new method to convert screen coordinates to world ray direction
   openmc::Direction screenToWorldDirection(double screenX, double screenY) {
       // Convert screen coordinates to normalized device coordinates (-1 to 1)
@@ -1076,7 +3641,7 @@ public:
   void handleCursorQuery(double xpos, double ypos) {
       // Skip if ImGui is handling this event
       ImGuiIO& io = ImGui::GetIO();
-      if (!io.WantCaptureMouse) {
+      if (plotterAvailable() && !io.WantCaptureMouse) {
           openmc::Position rayOrigin = camera_.getTransformedPosition();
           openmc::Direction rayDir = screenToWorldDirection(xpos, ypos);
 
@@ -1128,6 +3693,12 @@ public:
           ImGui::BulletText("Shift + Y: View along Y axis (negative direction)");
           ImGui::BulletText("Shift + Z: View along Z axis (negative direction)");
 
+          ImGui::Spacing();
+          ImGui::Text("Slice Controls (2D slice view):");
+          ImGui::BulletText("Left/Middle Mouse Button + Drag: Pan slice");
+          ImGui::BulletText("Right Mouse Button + Drag: Move plane along its normal");
+          ImGui::BulletText("Mouse Wheel: Zoom in/out");
+
           ImGui::Spacing();
           ImGui::Text("Light Controls:");
           ImGui::BulletText("Hold L + Left Mouse Button: Rotate light around model");
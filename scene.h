@@ -0,0 +1,231 @@
+#ifndef OPENMC_RENDER_SCENE_H
+#define OPENMC_RENDER_SCENE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/material.h"
+#include "openmc/plot.h"
+
+#include "clip.h"
+#include "lod.h"
+
+class OpenMCPlotter;
+
+// One view of the model: its own plot (camera, resolution, light, colors and
+// visibility) and the settings it is traced with. The geometry is shared and
+// read-only while tracing, and everything a render writes lives in the scene
+// or its frame, so different scenes can be rendered at the same time.
+class Scene {
+public:
+  // Create the plot with the default view and colors of the loaded model
+  void create() {
+    plot_ = std::make_unique<openmc::PhongPlot>();
+    set_plot_defaults();
+  }
+
+  // Drop the plot before the model is finalized, the settings are kept
+  void release() {
+    plot_.reset();
+  }
+
+  bool created() const {
+    return static_cast<bool>(plot_);
+  }
+
+  void set_plot_defaults() {
+    plot()->color_by_ = openmc::PlottableInterface::PlotColorBy::mats;
+    plot()->pixels() = {400, 400};
+    plot()->set_default_colors();
+
+    plot()->opaque_ids().clear();
+
+    for (const auto& mat : openmc::model::materials) {
+       plot()->opaque_ids().insert(mat->id_);
+    }
+
+    // set opaque "IDs" by index
+    for (int i = 0; i < openmc::model::materials.size(); i++) {
+      plot()->opaque_ids().insert(i);
+    }
+
+  }
+
+  // Take the colors, visibility, shading and kernel settings of another
+  // scene, keeping this one's camera, light and resolution
+  void copy_settings(Scene& other) {
+    plot()->color_by_ = other.plot()->color_by_;
+    plot()->colors_ = other.plot()->colors_;
+    plot()->not_found_ = other.plot()->not_found_;
+    plot()->opaque_ids() = other.plot()->opaque_ids();
+    plot()->diffuse_fraction() = other.plot()->diffuse_fraction();
+    clip_ = other.clip_;
+    cull_rays_ = other.cull_rays_;
+    simd_prepass_ = other.simd_prepass_;
+    simd_cells_ = other.simd_cells_;
+    lod_enabled_ = other.lod_enabled_;
+    lod_threshold_ = other.lod_threshold_;
+    antialias_ = other.antialias_;
+  }
+
+  const std::unique_ptr<openmc::PhongPlot>& plot() {
+    return plot_;
+  }
+
+  bool by_material() const {
+    return plot_->color_by_ == openmc::PlottableInterface::PlotColorBy::mats;
+  }
+
+  void set_pixels(int32_t width, int32_t height) {
+    plot()->pixels()[0] = width;
+    plot()->pixels()[1] = height;
+  }
+
+  void set_camera_position(openmc::Position position) {
+    plot()->camera_position() = position;
+  }
+
+  void set_look_at(openmc::Position look_at) {
+    plot()->look_at() = look_at;
+  }
+
+  void set_light_position(openmc::Position light_position) {
+    plot()->light_location() = light_position;
+  }
+
+  void set_up_vector(openmc::Direction up) {
+    plot()->up() = up;
+  }
+
+  void set_field_of_view(double fov) {
+    plot()->horizontal_field_of_view() = fov;
+  }
+
+  // Convert a material or cell ID (depending on the current color mode) to
+  // its index. Returns -1 for IDs that aren't present in the model.
+  int32_t id_to_index(int32_t id) const {
+    const auto& id_map = by_material() ? openmc::model::material_map : openmc::model::cell_map;
+    auto it = id_map.find(id);
+    return it == id_map.end() ? -1 : it->second;
+  }
+
+  bool has_id(int32_t id) const {
+    return id_to_index(id) >= 0;
+  }
+
+  void set_color(int32_t id, openmc::RGBColor color) {
+    // have to convert from material ID to index
+    int32_t index = id_to_index(id);
+    if (index < 0) return;
+    plot()->colors_[index] = color;
+  }
+
+  void set_material_visibility(int32_t id, bool visibility) {
+    // have to convert from material ID to index
+    int32_t index = id_to_index(id);
+    if (index < 0) return;
+    if (visibility) {
+      plot()->opaque_ids().insert(index);
+    } else {
+      plot()->opaque_ids().erase(index);
+    }
+  }
+
+  std::unordered_map<int32_t, openmc::RGBColor> color_map() {
+    auto map_out = std::unordered_map<int32_t, openmc::RGBColor>();
+    if (plot()->color_by() == openmc::PlottableInterface::PlotColorBy::mats) {
+      for (int i = 0; i < openmc::model::materials.size(); i++) {
+        const auto& mat = openmc::model::materials[i];
+        map_out[mat->id_] = plot()->colors_[i];
+      }
+    } else if (plot()->color_by() == openmc::PlottableInterface::PlotColorBy::cells) {
+      for (int i = 0; i < openmc::model::cells.size(); i++) {
+        const auto& cell = openmc::model::cells[i];
+        map_out[cell->id_] = plot()->colors_[i];
+      }
+    }
+    return map_out;
+  }
+
+  // Flags of the opaque cell or material indices, for the current color mode
+  std::vector<uint8_t> visible_indices() const {
+    std::vector<uint8_t> visible(by_material() ? openmc::model::materials.size() : openmc::model::cells.size(), 0);
+    for (int index : plot_->opaque_ids()) {
+      if (index >= 0 && index < static_cast<int>(visible.size())) visible[index] = 1;
+    }
+    return visible;
+  }
+
+  // Cutaway planes and box limiting the part of the model that is drawn
+  ClipRegion& clip() {
+    return clip_;
+  }
+
+  const ClipRegion& clip() const {
+    return clip_;
+  }
+
+  // Enable culling of primary rays against the model's bounding box
+  bool& cull_rays() {
+    return cull_rays_;
+  }
+
+  // Enable the SIMD pre-pass against the root universe's surfaces, which
+  // culls and shortens primary rays further than the bounding box alone
+  bool& simd_prepass() {
+    return simd_prepass_;
+  }
+
+  // Evaluate the surfaces of the cells a ray is in with SIMD, see
+  // CellSurfaceSoA
+  bool& simd_cells() {
+    return simd_cells_;
+  }
+
+  // Render filled cells whose features are smaller than lod_threshold
+  // pixels with their homogenized color
+  bool& lod_enabled() {
+    return lod_enabled_;
+  }
+
+  float& lod_threshold() {
+    return lod_threshold_;
+  }
+
+  // Supersample pixels on G-buffer discontinuities
+  bool& antialias() {
+    return antialias_;
+  }
+
+  // Fraction of pixels of the last frame that were culled
+  double culled_fraction() const {
+    return culled_fraction_;
+  }
+
+  // Fraction of pixels of the last frame that were supersampled
+  double edge_fraction() const {
+    return edge_fraction_;
+  }
+
+private:
+  friend class OpenMCPlotter;
+
+  std::unique_ptr<openmc::PhongPlot> plot_;
+  ClipRegion clip_;
+  bool cull_rays_ {true};
+  bool simd_prepass_ {true};
+  bool simd_cells_ {true};
+  bool lod_enabled_ {false};
+  float lod_threshold_ {1.0f};
+  bool antialias_ {false};
+
+  // written by the plotter while rendering the scene
+  LodTable::View lod_;
+  double culled_fraction_ {0.0};
+  double edge_fraction_ {0.0};
+};
+
+#endif // include guard
@@ -0,0 +1,146 @@
+#ifndef OPENMC_RENDER_SIMD_H
+#define OPENMC_RENDER_SIMD_H
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Minimal double precision SIMD wrapper for the ray packet kernels. The
+// widest instruction set enabled at compile time is used (AVX-512, AVX2),
+// otherwise a portable scalar version with the same interface.
+namespace simd {
+
+#if defined(__AVX512F__)
+
+constexpr const char* isa = "AVX-512";
+constexpr int width = 8;
+
+struct Mask { __mmask8 m; };
+
+struct Lanes {
+  __m512d v;
+  Lanes() = default;
+  Lanes(__m512d x) : v(x) {}
+  Lanes(double x) : v(_mm512_set1_pd(x)) {}
+  static Lanes load(const double* p) { return _mm512_loadu_pd(p); }
+  void store(double* p) const { _mm512_storeu_pd(p, v); }
+};
+
+inline Lanes operator+(Lanes a, Lanes b) { return _mm512_add_pd(a.v, b.v); }
+inline Lanes operator-(Lanes a, Lanes b) { return _mm512_sub_pd(a.v, b.v); }
+inline Lanes operator*(Lanes a, Lanes b) { return _mm512_mul_pd(a.v, b.v); }
+inline Lanes operator/(Lanes a, Lanes b) { return _mm512_div_pd(a.v, b.v); }
+inline Lanes fma(Lanes a, Lanes b, Lanes c) { return _mm512_fmadd_pd(a.v, b.v, c.v); }
+inline Lanes sqrt(Lanes a) { return _mm512_sqrt_pd(a.v); }
+inline Lanes min(Lanes a, Lanes b) { return _mm512_min_pd(a.v, b.v); }
+inline Lanes max(Lanes a, Lanes b) { return _mm512_max_pd(a.v, b.v); }
+inline Lanes abs(Lanes a) { return _mm512_abs_pd(a.v); }
+
+inline Mask operator<(Lanes a, Lanes b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ)}; }
+inline Mask operator<=(Lanes a, Lanes b) { return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ)}; }
+inline Mask operator&(Mask a, Mask b) { return {static_cast<__mmask8>(a.m & b.m)}; }
+inline Mask operator|(Mask a, Mask b) { return {static_cast<__mmask8>(a.m | b.m)}; }
+inline Mask operator!(Mask a) { return {static_cast<__mmask8>(~a.m)}; }
+inline bool any(Mask a) { return a.m != 0; }
+inline int bits(Mask a) { return a.m; }
+// a where the mask is set, b elsewhere
+inline Lanes select(Mask m, Lanes a, Lanes b) { return _mm512_mask_blend_pd(m.m, b.v, a.v); }
+
+#elif defined(__AVX2__)
+
+constexpr const char* isa = "AVX2";
+constexpr int width = 4;
+
+struct Mask { __m256d m; };
+
+struct Lanes {
+  __m256d v;
+  Lanes() = default;
+  Lanes(__m256d x) : v(x) {}
+  Lanes(double x) : v(_mm256_set1_pd(x)) {}
+  static Lanes load(const double* p) { return _mm256_loadu_pd(p); }
+  void store(double* p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline Lanes operator+(Lanes a, Lanes b) { return _mm256_add_pd(a.v, b.v); }
+inline Lanes operator-(Lanes a, Lanes b) { return _mm256_sub_pd(a.v, b.v); }
+inline Lanes operator*(Lanes a, Lanes b) { return _mm256_mul_pd(a.v, b.v); }
+inline Lanes operator/(Lanes a, Lanes b) { return _mm256_div_pd(a.v, b.v); }
+#if defined(__FMA__)
+inline Lanes fma(Lanes a, Lanes b, Lanes c) { return _mm256_fmadd_pd(a.v, b.v, c.v); }
+#else
+inline Lanes fma(Lanes a, Lanes b, Lanes c) { return a * b + c; }
+#endif
+inline Lanes sqrt(Lanes a) { return _mm256_sqrt_pd(a.v); }
+inline Lanes min(Lanes a, Lanes b) { return _mm256_min_pd(a.v, b.v); }
+inline Lanes max(Lanes a, Lanes b) { return _mm256_max_pd(a.v, b.v); }
+inline Lanes abs(Lanes a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+
+inline Mask operator<(Lanes a, Lanes b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+inline Mask operator<=(Lanes a, Lanes b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+inline Mask operator&(Mask a, Mask b) { return {_mm256_and_pd(a.m, b.m)}; }
+inline Mask operator|(Mask a, Mask b) { return {_mm256_or_pd(a.m, b.m)}; }
+inline Mask operator!(Mask a) { return {_mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)))}; }
+inline bool any(Mask a) { return _mm256_movemask_pd(a.m) != 0; }
+inline int bits(Mask a) { return _mm256_movemask_pd(a.m); }
+inline Lanes select(Mask m, Lanes a, Lanes b) { return _mm256_blendv_pd(b.v, a.v, m.m); }
+
+#else
+
+constexpr const char* isa = "scalar";
+constexpr int width = 4;
+
+struct Mask { bool m[width]; };
+
+struct Lanes {
+  double v[width];
+  Lanes() = default;
+  Lanes(double x) { std::fill(v, v + width, x); }
+  static Lanes load(const double* p) { Lanes r; std::copy(p, p + width, r.v); return r; }
+  void store(double* p) const { std::copy(v, v + width, p); }
+};
+
+template<typename F>
+inline Lanes map(Lanes a, Lanes b, F f) {
+  Lanes r;
+  for (int i = 0; i < width; i++) r.v[i] = f(a.v[i], b.v[i]);
+  return r;
+}
+
+template<typename F>
+inline Mask compare(Lanes a, Lanes b, F f) {
+  Mask r;
+  for (int i = 0; i < width; i++) r.m[i] = f(a.v[i], b.v[i]);
+  return r;
+}
+
+inline Lanes operator+(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return x + y; }); }
+inline Lanes operator-(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return x - y; }); }
+inline Lanes operator*(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return x * y; }); }
+inline Lanes operator/(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return x / y; }); }
+inline Lanes fma(Lanes a, Lanes b, Lanes c) { return a * b + c; }
+inline Lanes sqrt(Lanes a) { return map(a, a, [](double x, double) { return std::sqrt(x); }); }
+inline Lanes min(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return std::min(x, y); }); }
+inline Lanes max(Lanes a, Lanes b) { return map(a, b, [](double x, double y) { return std::max(x, y); }); }
+inline Lanes abs(Lanes a) { return map(a, a, [](double x, double) { return std::abs(x); }); }
+
+inline Mask operator<(Lanes a, Lanes b) { return compare(a, b, [](double x, double y) { return x < y; }); }
+inline Mask operator<=(Lanes a, Lanes b) { return compare(a, b, [](double x, double y) { return x <= y; }); }
+inline Mask operator&(Mask a, Mask b) { for (int i = 0; i < width; i++) a.m[i] = a.m[i] && b.m[i]; return a; }
+inline Mask operator|(Mask a, Mask b) { for (int i = 0; i < width; i++) a.m[i] = a.m[i] || b.m[i]; return a; }
+inline Mask operator!(Mask a) { for (int i = 0; i < width; i++) a.m[i] = !a.m[i]; return a; }
+inline bool any(Mask a) { return std::any_of(a.m, a.m + width, [](bool x) { return x; }); }
+inline int bits(Mask a) { int b = 0; for (int i = 0; i < width; i++) b |= a.m[i] << i; return b; }
+inline Lanes select(Mask m, Lanes a, Lanes b) {
+  for (int i = 0; i < width; i++) a.v[i] = m.m[i] ? a.v[i] : b.v[i];
+  return a;
+}
+
+#endif
+
+} // namespace simd
+
+#endif // include guard
@@ -0,0 +1,275 @@
+#ifndef OPENMC_RENDER_SLICE_H
+#define OPENMC_RENDER_SLICE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/geometry.h"
+#include "openmc/material.h"
+#include "openmc/plot.h"
+
+#include "frame.h"
+#include "spans.h"
+#include "thread_pool.h"
+
+// Interactive 2D slice of the model through an axis-aligned or arbitrary
+// plane. The plane is divided into square tiles of pixels on a fixed grid
+// in plane coordinates, and the cell and material of each pixel are cached
+// per tile. Panning by whole pixels keeps the grid, so only the tiles that
+// become exposed are evaluated. Colors and visibility are applied when the
+// image is composed from the cache, so they never invalidate it; moving the
+// plane, rotating it or zooming does.
+class SliceView {
+public:
+  enum class Axis { XY, XZ, YZ, Custom };
+
+  static constexpr int tile_size = 64;
+
+  struct Plane {
+    Axis axis {Axis::XY};
+    float azimuth {0.0f};    // normal of a custom plane in degrees
+    float elevation {90.0f};
+    double offset {0.0};     // distance of the plane from the origin along its normal
+    double pixel_size {0.0}; // model length per pixel
+
+    bool operator==(const Plane& other) const {
+      return axis == other.axis && azimuth == other.azimuth && elevation == other.elevation &&
+             offset == other.offset && pixel_size == other.pixel_size;
+    }
+    bool operator!=(const Plane& other) const { return !(*this == other); }
+  };
+
+  Plane& plane() { return plane_; }
+  const Plane& plane() const { return plane_; }
+
+  // Point the plane passes through for a zero offset, usually the center of
+  // the model. Changing it invalidates the cache.
+  void set_origin(const openmc::Position& origin) {
+    origin_ = origin;
+    clear();
+  }
+
+  // Start over with the plane through the origin, fitting width model
+  // lengths into image_width pixels
+  void reset(double width, int image_width) {
+    plane_.offset = 0.0;
+    plane_.pixel_size = width / std::max(1, image_width);
+    center_x_ = 0.0;
+    center_y_ = 0.0;
+  }
+
+  // Move the view by a number of image pixels
+  void pan(double dx, double dy) {
+    center_x_ += dx;
+    center_y_ += dy;
+  }
+
+  // Scale the pixel size by factor, keeping the center of the view in place
+  void zoom(double factor) {
+    plane_.pixel_size *= factor;
+    center_x_ /= factor;
+    center_y_ /= factor;
+  }
+
+  void clear() {
+    tiles_.clear();
+  }
+
+  size_t cached_tiles() const { return tiles_.size(); }
+  size_t evaluated_tiles() const { return evaluated_tiles_; }
+
+  // In-plane axes u (image columns), v (image rows) and the normal
+  void basis(openmc::Direction& u, openmc::Direction& v, openmc::Direction& n) const {
+    switch (plane_.axis) {
+    case Axis::XY:
+      u = {1.0, 0.0, 0.0}; v = {0.0, 1.0, 0.0};
+      break;
+    case Axis::XZ:
+      u = {1.0, 0.0, 0.0}; v = {0.0, 0.0, 1.0};
+      break;
+    case Axis::YZ:
+      u = {0.0, 1.0, 0.0}; v = {0.0, 0.0, 1.0};
+      break;
+    case Axis::Custom: {
+      double az = plane_.azimuth * M_PI / 180.0;
+      double el = plane_.elevation * M_PI / 180.0;
+      n = {std::cos(el) * std::cos(az), std::cos(el) * std::sin(az), std::sin(el)};
+      // keep v as close to +z as possible, falling back to +y for planes
+      // normal to z
+      openmc::Direction up = std::abs(n[2]) > 0.999 ? openmc::Direction(0.0, 1.0, 0.0)
+                                                     : openmc::Direction(0.0, 0.0, 1.0);
+      u = up.cross(n);
+      u /= u.norm();
+      v = n.cross(u);
+      return;
+    }
+    }
+    n = u.cross(v);
+  }
+
+  // Model position at the center of image pixel (col, row) of a width x
+  // height image
+  openmc::Position point(double col, double row, int width, int height) const {
+    openmc::Direction u, v, n;
+    basis(u, v, n);
+    double gx = std::floor(center_x_) - width / 2 + col;
+    double gy = std::floor(center_y_) - height / 2 + row;
+    return plane_point(u, v, n, gx, gy);
+  }
+
+  // Compose a width x height image of the current view into frame, first
+  // evaluating the tiles that aren't cached. Pixels are colored by the cell
+  // or material index, the G-buffer gets the IDs (so outlines work) and a
+  // depth of zero.
+  void render(Frame& frame, int width, int height, ThreadPool& pool, bool by_material,
+              const std::vector<uint8_t>& visible, const std::vector<openmc::RGBColor>& colors,
+              openmc::RGBColor background) {
+    if (plane_ != cached_plane_) {
+      clear();
+      cached_plane_ = plane_;
+    }
+    if (frame.width != width || frame.height != height || frame.y0 != 0 || !frame.has_gbuffer()) {
+      frame.y0 = 0;
+      frame.resize(width, height);
+    }
+
+    // global pixel coordinates of the image's first pixel on the tile grid
+    const int64_t gx0 = static_cast<int64_t>(std::floor(center_x_)) - width / 2;
+    const int64_t gy0 = static_cast<int64_t>(std::floor(center_y_)) - height / 2;
+    const int64_t tx0 = floor_div(gx0, tile_size);
+    const int64_t ty0 = floor_div(gy0, tile_size);
+    const int64_t tx1 = floor_div(gx0 + width - 1, tile_size);
+    const int64_t ty1 = floor_div(gy0 + height - 1, tile_size);
+    const int64_t n_tx = tx1 - tx0 + 1;
+    const int64_t n_ty = ty1 - ty0 + 1;
+
+    // look up the tiles in view, the cache isn't touched by the workers
+    std::vector<const SliceTile*> view(n_tx * n_ty);
+    std::vector<std::pair<int64_t, SliceTile*>> missing;
+    for (int64_t ty = ty0; ty <= ty1; ty++) {
+      for (int64_t tx = tx0; tx <= tx1; tx++) {
+        auto& tile = tiles_[key(tx, ty)];
+        if (!tile) {
+          tile = std::make_unique<SliceTile>();
+          missing.emplace_back(key(tx, ty), tile.get());
+        }
+        view[(ty - ty0) * n_tx + (tx - tx0)] = tile.get();
+      }
+    }
+
+    evaluated_tiles_ = missing.size();
+    if (!missing.empty()) {
+      openmc::Direction u, v, n;
+      basis(u, v, n);
+      pool.parallel_for(missing.size(), [&](size_t i, int) {
+        spans::Scope span("slice tile", tile_size * tile_size);
+        int64_t tx, ty;
+        unkey(missing[i].first, tx, ty);
+        evaluate(*missing[i].second, u, v, n, tx * tile_size, ty * tile_size);
+      });
+    }
+
+    // rows are independent
+    pool.parallel_for(height, [&](size_t row, int) {
+      int64_t gy = gy0 + static_cast<int64_t>(row);
+      int64_t ty = floor_div(gy, tile_size);
+      int local_y = static_cast<int>(gy - ty * tile_size);
+      for (int col = 0; col < width; col++) {
+        int64_t gx = gx0 + col;
+        int64_t tx = floor_div(gx, tile_size);
+        const SliceTile& tile = *view[(ty - ty0) * n_tx + (tx - tx0)];
+        size_t local = static_cast<size_t>(local_y) * tile_size + static_cast<size_t>(gx - tx * tile_size);
+        size_t pixel = frame.index(col, static_cast<int>(row));
+
+        int32_t cell = tile.cell[local];
+        int32_t material = tile.material[local];
+        int32_t index = by_material ? material : cell;
+        if (cell < 0 || index < 0 || static_cast<size_t>(index) >= visible.size() || !visible[index]) {
+          frame.set_background(pixel, background);
+          continue;
+        }
+        frame.color[pixel] = colors[index];
+        frame.cell_id[pixel] = openmc::model::cells[cell]->id_;
+        frame.material_id[pixel] = material >= 0 ? openmc::model::materials[material]->id_ : -1;
+        frame.depth[pixel] = 0.0f;
+      }
+    });
+
+    evict(tx0, ty0, tx1, ty1);
+  }
+
+private:
+  struct SliceTile {
+    std::vector<int32_t> cell;      // lowest level cell index, -1 outside the model
+    std::vector<int32_t> material;  // material index, -1 for void or outside
+  };
+
+  static int64_t floor_div(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+  }
+
+  static int64_t key(int64_t tx, int64_t ty) {
+    return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(tx)) << 32) |
+                                static_cast<uint32_t>(ty));
+  }
+
+  static void unkey(int64_t k, int64_t& tx, int64_t& ty) {
+    tx = static_cast<int32_t>(static_cast<uint64_t>(k) >> 32);
+    ty = static_cast<int32_t>(static_cast<uint64_t>(k) & 0xffffffffu);
+  }
+
+  openmc::Position plane_point(const openmc::Direction& u, const openmc::Direction& v,
+                               const openmc::Direction& n, double gx, double gy) const {
+    return origin_ + n * plane_.offset + u * ((gx + 0.5) * plane_.pixel_size) +
+           v * ((gy + 0.5) * plane_.pixel_size);
+  }
+
+  void evaluate(SliceTile& tile, const openmc::Direction& u, const openmc::Direction& v,
+                const openmc::Direction& n, int64_t gx0, int64_t gy0) const {
+    tile.cell.assign(tile_size * tile_size, -1);
+    tile.material.assign(tile_size * tile_size, -1);
+    openmc::GeometryState g;
+    for (int j = 0; j < tile_size; j++) {
+      for (int i = 0; i < tile_size; i++) {
+        g.n_coord() = 1;
+        g.r() = plane_point(u, v, n, static_cast<double>(gx0 + i), static_cast<double>(gy0 + j));
+        g.u() = n;
+        if (!openmc::exhaustive_find_cell(g)) continue;
+        tile.cell[j * tile_size + i] = g.lowest_coord().cell;
+        tile.material[j * tile_size + i] = g.material();
+      }
+    }
+  }
+
+  // Drop tiles far from the view once the cache holds several views' worth
+  void evict(int64_t tx0, int64_t ty0, int64_t tx1, int64_t ty1) {
+    size_t in_view = static_cast<size_t>((tx1 - tx0 + 1) * (ty1 - ty0 + 1));
+    if (tiles_.size() <= 4 * in_view) return;
+    int64_t margin_x = tx1 - tx0 + 1;
+    int64_t margin_y = ty1 - ty0 + 1;
+    for (auto it = tiles_.begin(); it != tiles_.end();) {
+      int64_t tx, ty;
+      unkey(it->first, tx, ty);
+      if (tx < tx0 - margin_x || tx > tx1 + margin_x || ty < ty0 - margin_y || ty > ty1 + margin_y) {
+        it = tiles_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  Plane plane_;
+  Plane cached_plane_;
+  openmc::Position origin_;
+  double center_x_ {0.0};  // view center in pixels on the tile grid
+  double center_y_ {0.0};
+  std::unordered_map<int64_t, std::unique_ptr<SliceTile>> tiles_;
+  size_t evaluated_tiles_ {0};
+};
+
+#endif // include guard
@@ -0,0 +1,257 @@
+#ifndef OPENMC_RENDER_SPANS_H
+#define OPENMC_RENDER_SPANS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set to 0 (cmake -DOMC_RENDER_SPANS=OFF) to compile all spans out
+#ifndef OMC_RENDER_SPANS
+#define OMC_RENDER_SPANS 1
+#endif
+
+// Timeline instrumentation of frame stages and parallel work, exported in
+// the Chrome trace event format (chrome://tracing, Perfetto). Each thread
+// appends its spans to its own buffer without locking; the buffers are only
+// registered under a lock the first time a thread records.
+namespace spans {
+
+constexpr bool enabled = OMC_RENDER_SPANS;
+
+using Clock = std::chrono::steady_clock;
+
+struct Span {
+  const char* name;  // string literal
+  int64_t start;     // ns since the clock's epoch
+  int64_t end;
+  uint32_t pixels;   // pixels processed, 0 for stages without a pixel count
+};
+
+inline int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// Spans of one thread. Only the owning thread appends; readers see the
+// spans below size(), whose blocks are published before the count.
+class Buffer {
+public:
+  static constexpr size_t block_size = 4096;
+  static constexpr size_t max_blocks = 256;  // spans beyond ~1M are dropped
+
+  explicit Buffer(int id) : id_(id) {}
+
+  void push(const Span& span) {
+    size_t n = count_.load(std::memory_order_relaxed);
+    size_t block = n / block_size;
+    if (block >= max_blocks) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (!blocks_[block]) blocks_[block] = std::make_unique<Span[]>(block_size);
+    blocks_[block][n % block_size] = span;
+    count_.store(n + 1, std::memory_order_release);
+  }
+
+  size_t size() const { return count_.load(std::memory_order_acquire); }
+  const Span& operator[](size_t i) const { return blocks_[i / block_size][i % block_size]; }
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // Only while no span of this thread is being recorded
+  void clear() {
+    count_.store(0, std::memory_order_release);
+    dropped_.store(0, std::memory_order_relaxed);
+  }
+
+  int id() const { return id_; }
+  std::string name;  // shown as the thread's name, guarded by the recorder
+  std::string key;   // name the thread registered with, empty if unnamed
+  bool in_use {true};  // false once its thread exited, guarded by the recorder
+
+private:
+  int id_;
+  std::unique_ptr<Span[]> blocks_[max_blocks];
+  std::atomic<size_t> count_ {0};
+  std::atomic<size_t> dropped_ {0};
+};
+
+class Recorder {
+public:
+  bool recording() const { return recording_.load(std::memory_order_relaxed); }
+
+  // Drop the spans recorded so far and start recording. Must be called
+  // between frames, while no instrumented work is running.
+  void start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& buffer : buffers_) buffer->clear();
+    epoch_ = now();
+    recording_ = true;
+  }
+
+  void stop() { recording_ = false; }
+
+  // Buffer of the calling thread, registered on first use and handed back
+  // when the thread exits
+  Buffer& buffer() {
+    thread_local Owner owner;
+    if (!owner.buffer) {
+      owner.recorder = this;
+      owner.buffer = add_buffer(thread_name());
+    }
+    return *owner.buffer;
+  }
+
+  // Name shown for the calling thread in the trace
+  void name_thread(const std::string& name) {
+    thread_name() = name;
+    Buffer& own = buffer();
+    std::lock_guard<std::mutex> lock(mutex_);
+    own.name = name;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& buffer : buffers_) n += buffer->size();
+    return n;
+  }
+
+  size_t dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& buffer : buffers_) n += buffer->dropped();
+    return n;
+  }
+
+  // Write the spans recorded so far as Chrome trace JSON, with timestamps in
+  // microseconds since start()
+  bool write_chrome_trace(const std::string& path, std::string& error) const {
+    std::ofstream out(path);
+    if (!out) {
+      error = "Can't write " + path;
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+      if (!first) out << ",\n";
+      first = false;
+    };
+    for (const auto& buffer : buffers_) {
+      separator();
+      out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id()
+          << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+      size_t n = buffer->size();
+      for (size_t i = 0; i < n; i++) {
+        const Span& span = (*buffer)[i];
+        if (span.start < epoch_) continue;
+        separator();
+        out << "{\"name\":\"" << span.name << "\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id()
+            << ",\"ts\":" << (span.start - epoch_) * 1e-3 << ",\"dur\":" << (span.end - span.start) * 1e-3;
+        if (span.pixels > 0) out << ",\"args\":{\"pixels\":" << span.pixels << "}";
+        out << "}";
+      }
+    }
+    out << "\n]}\n";
+    if (!out) {
+      error = "Error writing " + path;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  struct Owner {
+    Recorder* recorder {nullptr};
+    Buffer* buffer {nullptr};
+    ~Owner() {
+      if (buffer) recorder->release_buffer(buffer);
+    }
+  };
+
+  static std::string& thread_name() {
+    thread_local std::string name;
+    return name;
+  }
+
+  // A thread takes over the buffer of an exited thread with the same name,
+  // so restarting the pool's workers continues their timelines instead of
+  // adding new ones
+  Buffer* add_buffer(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& buffer : buffers_) {
+      if (!buffer->in_use && buffer->key == name) {
+        buffer->in_use = true;
+        return buffer.get();
+      }
+    }
+    int id = static_cast<int>(buffers_.size());
+    buffers_.push_back(std::make_unique<Buffer>(id));
+    Buffer* buffer = buffers_.back().get();
+    buffer->key = name;
+    buffer->name = name.empty() ? "thread " + std::to_string(id) : name;
+    return buffer;
+  }
+
+  void release_buffer(Buffer* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer->in_use = false;
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::atomic<bool> recording_ {false};
+  int64_t epoch_ {0};
+};
+
+inline Recorder& recorder() {
+  static Recorder r;
+  return r;
+}
+
+#if OMC_RENDER_SPANS
+
+// Records the time between construction and destruction as a span of the
+// calling thread, if recording
+class Scope {
+public:
+  explicit Scope(const char* name, uint32_t pixels = 0) : name_(name), pixels_(pixels) {
+    if (recorder().recording()) start_ = now();
+  }
+  ~Scope() {
+    if (start_ >= 0) recorder().buffer().push(Span {name_, start_, now(), pixels_});
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  const char* name_;
+  uint32_t pixels_;
+  int64_t start_ {-1};
+};
+
+inline void name_thread(const std::string& name) {
+  recorder().name_thread(name);
+}
+
+#else
+
+class Scope {
+public:
+  explicit Scope(const char*, uint32_t = 0) {}
+};
+
+inline void name_thread(const std::string&) {}
+
+#endif
+
+} // namespace spans
+
+#endif // include guard
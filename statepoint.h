@@ -0,0 +1,437 @@
+#ifndef OPENMC_RENDER_STATEPOINT_H
+#define OPENMC_RENDER_STATEPOINT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "openmc/position.h"
+
+#include "hdf5_util.h"
+
+// Mesh tally results of an OpenMC statepoint file. Opening the file only
+// reads the tally, filter and mesh metadata. The results of one selection
+// (tally, nuclide, score and the bins of the tally's other filters) are read
+// on demand as a strided slice over the mesh bins: straight from a memory
+// mapping of the file when the results dataset is stored contiguously and
+// uncompressed, through an HDF5 hyperslab selection otherwise. Either way
+// only the requested values are touched, and recent slices are kept so
+// switching back and forth doesn't read them again.
+class StatepointFile {
+public:
+  // Structured mesh as bin boundaries along its three axes, which are
+  // (x, y, z), (r, phi, z) or (r, theta, phi) around origin
+  struct Mesh {
+    enum class Type { Regular, Rectilinear, Cylindrical, Spherical };
+    int32_t id;
+    Type type;
+    std::array<std::vector<double>, 3> grids;
+    openmc::Position origin {0.0, 0.0, 0.0};
+
+    int shape(int axis) const { return static_cast<int>(grids[axis].size()) - 1; }
+    size_t n_bins() const { return static_cast<size_t>(shape(0)) * shape(1) * shape(2); }
+
+    // Index of the bin containing p (first axis fastest, like OpenMC), -1
+    // outside of the mesh
+    int64_t bin(const openmc::Position& p) const {
+      double x[3];
+      openmc::Position d = p - origin;
+      switch (type) {
+      case Type::Regular:
+      case Type::Rectilinear:
+        x[0] = p[0]; x[1] = p[1]; x[2] = p[2];
+        break;
+      case Type::Cylindrical:
+        x[0] = std::sqrt(d[0] * d[0] + d[1] * d[1]);
+        x[1] = std::atan2(d[1], d[0]);
+        if (x[1] < 0.0) x[1] += 2.0 * M_PI;
+        x[2] = d[2];
+        break;
+      case Type::Spherical:
+        x[0] = d.norm();
+        x[1] = x[0] > 0.0 ? std::acos(std::max(-1.0, std::min(1.0, d[2] / x[0]))) : 0.0;
+        x[2] = std::atan2(d[1], d[0]);
+        if (x[2] < 0.0) x[2] += 2.0 * M_PI;
+        break;
+      }
+
+      int64_t index[3];
+      for (int axis = 0; axis < 3; axis++) {
+        const auto& grid = grids[axis];
+        if (!(x[axis] >= grid.front() && x[axis] <= grid.back())) return -1;
+        auto it = std::upper_bound(grid.begin(), grid.end(), x[axis]);
+        index[axis] = std::min<int64_t>(it - grid.begin() - 1, shape(axis) - 1);
+      }
+      return (index[2] * shape(1) + index[1]) * shape(0) + index[0];
+    }
+  };
+
+  struct Filter {
+    int32_t id;
+    std::string type;
+    int64_t n_bins {0};
+    int mesh {-1};  // index into meshes() for mesh filters
+  };
+
+  struct Tally {
+    int32_t id;
+    std::string name;
+    std::vector<int> filters;  // indices into filters()
+    std::vector<int64_t> strides;
+    std::vector<std::string> nuclides;
+    std::vector<std::string> scores;
+    int n_realizations {0};
+    int mesh_filter {-1};  // position of the (first) mesh filter in filters
+  };
+
+  // Which slice of a tally's results to read. bins holds the bin of each of
+  // the tally's filters, the mesh filter's entry is ignored.
+  struct Selection {
+    int tally {0};
+    int nuclide {0};
+    int score {0};
+    std::vector<int64_t> bins;
+
+    bool operator==(const Selection& other) const {
+      return tally == other.tally && nuclide == other.nuclide && score == other.score && bins == other.bins;
+    }
+  };
+
+  // Mean and relative error per mesh bin
+  struct Slice {
+    std::vector<double> mean;
+    std::vector<double> rel_error;
+    double min {0.0};
+    double max {0.0};
+    double min_positive {0.0};  // smallest positive mean, for log scales
+  };
+
+  explicit StatepointFile(const std::string& path) : path_(path) {
+    std::lock_guard<std::mutex> lock(h5::mutex());
+    try {
+      open();
+    } catch (...) {
+      file_ = h5::Handle();  // closed while holding the lock
+      throw;
+    }
+  }
+
+  ~StatepointFile() {
+    std::lock_guard<std::mutex> lock(h5::mutex());
+    file_ = h5::Handle();
+    if (map_) munmap(map_, map_size_);
+  }
+
+  StatepointFile(const StatepointFile&) = delete;
+  StatepointFile& operator=(const StatepointFile&) = delete;
+
+  const std::string& path() const { return path_; }
+  const std::vector<Mesh>& meshes() const { return meshes_; }
+  const std::vector<Filter>& filters() const { return filters_; }
+
+  // Tallies with a structured mesh filter and results
+  const std::vector<Tally>& tallies() const { return tallies_; }
+
+  const Mesh& mesh(const Tally& tally) const {
+    return meshes_[filters_[tally.filters[tally.mesh_filter]].mesh];
+  }
+
+  // Whether the last slice was read through the memory mapping
+  bool mapped() const { return mapped_; }
+
+  std::shared_ptr<const Slice> slice(const Selection& selection) {
+    std::lock_guard<std::mutex> lock(h5::mutex());
+    for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+      if (it->first == selection) {
+        cache_.splice(cache_.begin(), cache_, it);
+        return cache_.front().second;
+      }
+    }
+
+    auto slice = read_slice(selection);
+    cache_.emplace_front(selection, slice);
+    if (cache_.size() > max_cached_slices) cache_.pop_back();
+    return slice;
+  }
+
+private:
+  static constexpr size_t max_cached_slices = 8;
+
+  // Metadata
+
+  void open() {
+    if (H5Fis_hdf5(path_.c_str()) <= 0) {
+      throw std::runtime_error(path_ + " is not an HDF5 file");
+    }
+    file_ = h5::Handle(H5Fopen(path_.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+    if (!file_.valid()) {
+      throw std::runtime_error("Failed to open " + path_);
+    }
+    if (h5::read_string_attribute(file_, "filetype") != "statepoint") {
+      throw std::runtime_error(path_ + " is not an OpenMC statepoint file");
+    }
+    if (!H5Lexists(file_, "tallies", H5P_DEFAULT)) {
+      throw std::runtime_error(path_ + " has no tallies");
+    }
+    read_meshes();
+    read_filters();
+    read_tallies();
+  }
+
+  void read_meshes() {
+    if (H5Lexists(file_, "tallies/meshes", H5P_DEFAULT) <= 0) return;
+    h5::Handle group(H5Gopen2(file_, "tallies/meshes", H5P_DEFAULT), H5Gclose);
+    for (int32_t id : h5::read_attribute<int32_t>(group, "ids", H5T_NATIVE_INT32)) {
+      std::string name = "mesh " + std::to_string(id);
+      if (H5Lexists(group, name.c_str(), H5P_DEFAULT) <= 0) continue;
+      h5::Handle mesh_group(H5Gopen2(group, name.c_str(), H5P_DEFAULT), H5Gclose);
+      if (!mesh_group.valid()) continue;
+
+      Mesh mesh;
+      mesh.id = id;
+      std::string type = h5::read_string_dataset(mesh_group, "type");
+      if (type == "regular") {
+        mesh.type = Mesh::Type::Regular;
+        auto dimension = h5::read_dataset<int64_t>(mesh_group, "dimension", H5T_NATIVE_INT64);
+        auto lower = h5::read_dataset<double>(mesh_group, "lower_left", H5T_NATIVE_DOUBLE);
+        auto upper = h5::read_dataset<double>(mesh_group, "upper_right", H5T_NATIVE_DOUBLE);
+        size_t n_axes = dimension.size();
+        if (n_axes < 1 || n_axes > 3 || lower.size() < n_axes || upper.size() < n_axes) continue;
+        for (size_t axis = 0; axis < 3; axis++) {
+          if (axis >= n_axes) {
+            // 1D and 2D regular meshes are a single bin along the missing axes
+            mesh.grids[axis] = {-infinity, infinity};
+            continue;
+          }
+          if (dimension[axis] < 1) break;
+          for (int64_t i = 0; i <= dimension[axis]; i++) {
+            double f = static_cast<double>(i) / dimension[axis];
+            mesh.grids[axis].push_back(i == dimension[axis] ? upper[axis] : lower[axis] + f * (upper[axis] - lower[axis]));
+          }
+        }
+      } else if (type == "rectilinear") {
+        mesh.type = Mesh::Type::Rectilinear;
+        mesh.grids = {h5::read_dataset<double>(mesh_group, "x_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "y_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "z_grid", H5T_NATIVE_DOUBLE)};
+      } else if (type == "cylindrical") {
+        mesh.type = Mesh::Type::Cylindrical;
+        mesh.grids = {h5::read_dataset<double>(mesh_group, "r_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "phi_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "z_grid", H5T_NATIVE_DOUBLE)};
+        read_origin(mesh_group, mesh);
+      } else if (type == "spherical") {
+        mesh.type = Mesh::Type::Spherical;
+        mesh.grids = {h5::read_dataset<double>(mesh_group, "r_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "theta_grid", H5T_NATIVE_DOUBLE),
+                      h5::read_dataset<double>(mesh_group, "phi_grid", H5T_NATIVE_DOUBLE)};
+        read_origin(mesh_group, mesh);
+      } else {
+        // unstructured meshes aren't supported
+        continue;
+      }
+      if (std::any_of(mesh.grids.begin(), mesh.grids.end(), [](const std::vector<double>& g) { return g.size() < 2; })) {
+        continue;
+      }
+      meshes_.push_back(std::move(mesh));
+    }
+  }
+
+  void read_origin(hid_t group, Mesh& mesh) {
+    if (!H5Lexists(group, "origin", H5P_DEFAULT)) return;
+    auto origin = h5::read_dataset<double>(group, "origin", H5T_NATIVE_DOUBLE);
+    if (origin.size() == 3) mesh.origin = {origin[0], origin[1], origin[2]};
+  }
+
+  void read_filters() {
+    if (H5Lexists(file_, "tallies/filters", H5P_DEFAULT) <= 0) return;
+    h5::Handle group(H5Gopen2(file_, "tallies/filters", H5P_DEFAULT), H5Gclose);
+    for (int32_t id : h5::read_attribute<int32_t>(group, "ids", H5T_NATIVE_INT32)) {
+      std::string name = "filter " + std::to_string(id);
+      if (H5Lexists(group, name.c_str(), H5P_DEFAULT) <= 0) continue;
+      h5::Handle filter_group(H5Gopen2(group, name.c_str(), H5P_DEFAULT), H5Gclose);
+      if (!filter_group.valid()) continue;
+
+      Filter filter;
+      filter.id = id;
+      filter.type = h5::read_string_dataset(filter_group, "type");
+      filter.n_bins = h5::read_dataset<int64_t>(filter_group, "n_bins", H5T_NATIVE_INT64).at(0);
+      if (filter.type == "mesh") {
+        int32_t mesh_id = h5::read_dataset<int32_t>(filter_group, "bins", H5T_NATIVE_INT32).at(0);
+        for (size_t i = 0; i < meshes_.size(); i++) {
+          if (meshes_[i].id == mesh_id) filter.mesh = static_cast<int>(i);
+        }
+      }
+      filters_.push_back(std::move(filter));
+    }
+  }
+
+  void read_tallies() {
+    h5::Handle group(H5Gopen2(file_, "tallies", H5P_DEFAULT), H5Gclose);
+    for (int32_t id : h5::read_attribute<int32_t>(group, "ids", H5T_NATIVE_INT32)) {
+      std::string name = "tally " + std::to_string(id);
+      if (H5Lexists(group, name.c_str(), H5P_DEFAULT) <= 0) continue;
+      h5::Handle tally_group(H5Gopen2(group, name.c_str(), H5P_DEFAULT), H5Gclose);
+      if (!tally_group.valid() || !H5Lexists(tally_group, "results", H5P_DEFAULT)) continue;
+
+      Tally tally;
+      tally.id = id;
+      if (H5Lexists(tally_group, "name", H5P_DEFAULT)) {
+        tally.name = h5::read_string_dataset(tally_group, "name");
+      }
+      tally.n_realizations = h5::read_dataset<int32_t>(tally_group, "n_realizations", H5T_NATIVE_INT32).at(0);
+      if (h5::read_dataset<int32_t>(tally_group, "n_filters", H5T_NATIVE_INT32).at(0) > 0) {
+        for (int32_t filter_id : h5::read_dataset<int32_t>(tally_group, "filters", H5T_NATIVE_INT32)) {
+          auto it = std::find_if(filters_.begin(), filters_.end(), [&](const Filter& f) { return f.id == filter_id; });
+          if (it == filters_.end()) break;
+          tally.filters.push_back(static_cast<int>(it - filters_.begin()));
+        }
+      }
+      tally.nuclides = h5::read_string_array(tally_group, "nuclides");
+      tally.scores = h5::read_string_array(tally_group, "score_bins");
+
+      // the last filter's bins are contiguous
+      tally.strides.assign(tally.filters.size(), 1);
+      int64_t stride = 1;
+      for (int i = static_cast<int>(tally.filters.size()) - 1; i >= 0; i--) {
+        const Filter& filter = filters_[tally.filters[i]];
+        tally.strides[i] = stride;
+        stride *= filter.n_bins;
+        if (tally.mesh_filter < 0 && filter.mesh >= 0 &&
+            static_cast<size_t>(filter.n_bins) == meshes_[filter.mesh].n_bins()) {
+          tally.mesh_filter = i;
+        }
+      }
+      if (tally.mesh_filter < 0 || tally.scores.empty() || tally.n_realizations <= 0) continue;
+      if (tally.nuclides.empty()) tally.nuclides.push_back("total");
+      tallies_.push_back(std::move(tally));
+    }
+  }
+
+  // Results
+
+  std::shared_ptr<const Slice> read_slice(const Selection& selection) {
+    const Tally& tally = tallies_.at(selection.tally);
+    const size_t n_bins = mesh(tally).n_bins();
+
+    // row of the first mesh bin and the distance between mesh bins
+    int64_t first_row = 0;
+    for (size_t i = 0; i < tally.filters.size(); i++) {
+      if (static_cast<int>(i) == tally.mesh_filter) continue;
+      int64_t bin = i < selection.bins.size() ? selection.bins[i] : 0;
+      first_row += std::max<int64_t>(0, std::min(bin, filters_[tally.filters[i]].n_bins - 1)) * tally.strides[i];
+    }
+    const int64_t row_stride = tally.strides[tally.mesh_filter];
+    const int64_t column = static_cast<int64_t>(selection.nuclide) * tally.scores.size() + selection.score;
+
+    std::string name = "tallies/tally " + std::to_string(tally.id) + "/results";
+    h5::Handle dataset(H5Dopen2(file_, name.c_str(), H5P_DEFAULT), H5Dclose);
+    h5::Handle space(H5Dget_space(dataset), H5Sclose);
+    hsize_t dims[3] = {0, 0, 0};
+    if (H5Sget_simple_extent_ndims(space) != 3) {
+      throw std::runtime_error("Unexpected shape of " + name);
+    }
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    if (column >= static_cast<int64_t>(dims[1]) || dims[2] < 2 ||
+        first_row + (static_cast<int64_t>(n_bins) - 1) * row_stride >= static_cast<int64_t>(dims[0])) {
+      throw std::runtime_error("Selection outside of " + name);
+    }
+
+    // (sum, sum of squares) per mesh bin
+    std::vector<double> sums(2 * n_bins);
+    const double* mapped = map_results(dataset);
+    mapped_ = mapped != nullptr;
+    if (mapped) {
+      for (size_t m = 0; m < n_bins; m++) {
+        const double* value = mapped + ((first_row + m * row_stride) * dims[1] + column) * dims[2];
+        sums[2 * m] = value[0];
+        sums[2 * m + 1] = value[1];
+      }
+    } else {
+      hsize_t start[3] = {static_cast<hsize_t>(first_row), static_cast<hsize_t>(column), 0};
+      hsize_t stride[3] = {static_cast<hsize_t>(row_stride), 1, 1};
+      hsize_t count[3] = {n_bins, 1, 2};
+      H5Sselect_hyperslab(space, H5S_SELECT_SET, start, stride, count, nullptr);
+      hsize_t n_values = 2 * n_bins;
+      h5::Handle memory(H5Screate_simple(1, &n_values, nullptr), H5Sclose);
+      if (H5Dread(dataset, H5T_NATIVE_DOUBLE, memory, space, H5P_DEFAULT, sums.data()) < 0) {
+        throw std::runtime_error("Failed to read " + name);
+      }
+    }
+
+    auto slice = std::make_shared<Slice>();
+    slice->mean.resize(n_bins);
+    slice->rel_error.resize(n_bins);
+    const double n = tally.n_realizations;
+    slice->min = infinity;
+    slice->max = -infinity;
+    slice->min_positive = infinity;
+    for (size_t m = 0; m < n_bins; m++) {
+      double mean = sums[2 * m] / n;
+      double variance = n > 1 ? std::max(0.0, (sums[2 * m + 1] / n - mean * mean) / (n - 1)) : 0.0;
+      slice->mean[m] = mean;
+      slice->rel_error[m] = mean != 0.0 ? std::sqrt(variance) / std::abs(mean) : 0.0;
+      slice->min = std::min(slice->min, mean);
+      slice->max = std::max(slice->max, mean);
+      if (mean > 0.0) slice->min_positive = std::min(slice->min_positive, mean);
+    }
+    if (!std::isfinite(slice->min_positive)) slice->min_positive = 0.0;
+    return slice;
+  }
+
+  // Pointer to the raw values of a contiguous, uncompressed little-endian
+  // double dataset in the memory mapped file, nullptr if it can't be used
+  const double* map_results(hid_t dataset) {
+    h5::Handle plist(H5Dget_create_plist(dataset), H5Pclose);
+    if (H5Pget_layout(plist) != H5D_CONTIGUOUS || H5Pget_nfilters(plist) > 0) return nullptr;
+    h5::Handle type(H5Dget_type(dataset), H5Tclose);
+    if (H5Tequal(type, H5T_IEEE_F64LE) <= 0 || H5Tequal(H5T_NATIVE_DOUBLE, H5T_IEEE_F64LE) <= 0) return nullptr;
+    haddr_t offset = H5Dget_offset(dataset);
+    if (offset == HADDR_UNDEF || offset % alignof(double) != 0) return nullptr;
+
+    if (!map_) {
+      int fd = ::open(path_.c_str(), O_RDONLY);
+      if (fd < 0) return nullptr;
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+          map_ = map;
+          map_size_ = st.st_size;
+        }
+      }
+      ::close(fd);
+      if (!map_) return nullptr;
+    }
+    if (offset + H5Dget_storage_size(dataset) > map_size_) return nullptr;
+    return reinterpret_cast<const double*>(static_cast<const char*>(map_) + offset);
+  }
+
+  static constexpr double infinity = std::numeric_limits<double>::infinity();
+
+  std::string path_;
+  h5::Handle file_;
+  void* map_ {nullptr};
+  size_t map_size_ {0};
+  bool mapped_ {false};
+  std::vector<Mesh> meshes_;
+  std::vector<Filter> filters_;
+  std::vector<Tally> tallies_;
+  std::list<std::pair<Selection, std::shared_ptr<const Slice>>> cache_;
+};
+
+#endif // include guard
@@ -0,0 +1,172 @@
+#ifndef OPENMC_RENDER_SURFACE_MESH_H
+#define OPENMC_RENDER_SURFACE_MESH_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "preview_cache.h"
+#include "voxel_grid.h"
+
+namespace fs = std::filesystem;
+
+// Boundary surfaces of the voxel grid, one mesh per cell or material index.
+// Every voxel face between two different indices (or the outside) becomes a
+// quad of the index on its inner side. Meshes are kept separate so toggling
+// visibility or changing colors only changes which draw calls are issued.
+struct SurfaceMesh {
+  bool by_material {true};
+  // interleaved normal and position of each vertex (GL_N3F_V3F), four
+  // vertices per quad
+  std::vector<float> vertices;
+  // range of vertices [first, first + count) belonging to each index
+  std::vector<uint64_t> first;
+  std::vector<uint64_t> count;
+
+  static constexpr int floats_per_vertex = 6;
+
+  size_t n_indices() const { return first.size(); }
+  size_t n_vertices() const { return vertices.size() / floats_per_vertex; }
+  size_t n_quads() const { return n_vertices() / 4; }
+
+  // Extract the meshes from a grid using n_threads threads, each working on
+  // its own z-slices and vertex lists which are concatenated at the end
+  static SurfaceMesh extract(const VoxelGrid& grid, bool by_material, size_t n_indices, int n_threads) {
+    const std::vector<int32_t>& ids = grid.indices(by_material);
+    const int n[3] = {grid.nx(), grid.ny(), grid.nz()};
+    const double h = grid.voxel_size();
+    const openmc::Position lower = grid.lower();
+
+    n_threads = std::max(1, n_threads);
+    std::vector<std::vector<std::vector<float>>> local(n_threads, std::vector<std::vector<float>>(n_indices));
+
+    // index of the neighbor in direction (axis, side), -1 outside the grid
+    auto neighbor = [&](int i, int j, int k, int axis, int side) -> int32_t {
+      int c[3] = {i, j, k};
+      c[axis] += side;
+      if (c[axis] < 0 || c[axis] >= n[axis]) return -1;
+      return ids[grid.index(c[0], c[1], c[2])];
+    };
+
+    auto worker = [&](int thread) {
+      for (int k = thread; k < n[2]; k += n_threads) {
+        for (int j = 0; j < n[1]; j++) {
+          for (int i = 0; i < n[0]; i++) {
+            int32_t id = ids[grid.index(i, j, k)];
+            if (id < 0 || static_cast<size_t>(id) >= n_indices) continue;
+
+            for (int axis = 0; axis < 3; axis++) {
+              for (int side = -1; side <= 1; side += 2) {
+                if (neighbor(i, j, k, axis, side) == id) continue;
+                add_face(local[thread][id], lower, h, i, j, k, axis, side);
+              }
+            }
+          }
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < n_threads; t++) {
+      threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : threads) thread.join();
+
+    SurfaceMesh mesh;
+    mesh.by_material = by_material;
+    mesh.first.resize(n_indices);
+    mesh.count.resize(n_indices);
+    for (size_t id = 0; id < n_indices; id++) {
+      mesh.first[id] = mesh.n_vertices();
+      for (auto& thread_vertices : local) {
+        auto& v = thread_vertices[id];
+        mesh.vertices.insert(mesh.vertices.end(), v.begin(), v.end());
+        std::vector<float>().swap(v);
+      }
+      mesh.count[id] = mesh.n_vertices() - mesh.first[id];
+    }
+    return mesh;
+  }
+
+  bool save(const fs::path& path) const {
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    return PreviewCache::write_file(path, [this](std::ofstream& out) {
+      uint64_t header[3] = {by_material ? 1u : 0u, first.size(), vertices.size()};
+      out.write(MESH_MAGIC, sizeof(MESH_MAGIC));
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(first.data()), first.size() * sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(count.data()), count.size() * sizeof(uint64_t));
+      out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(float));
+    });
+  }
+
+  // Load a mesh written by save, returns false for missing or corrupt files.
+  // The counts in the header are checked against the file size before
+  // anything is allocated, so a damaged cache entry can't exhaust memory.
+  bool load(const fs::path& path) {
+    std::error_code ec;
+    uint64_t file_size = fs::file_size(path, ec);
+    if (ec) return false;
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(MESH_MAGIC)];
+    uint64_t header[3];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MESH_MAGIC, sizeof(magic)) != 0) return false;
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+
+    uint64_t data_size = file_size - sizeof(magic) - sizeof(header);
+    if (header[0] > 1 || header[1] > data_size / (2 * sizeof(uint64_t)) || header[2] > data_size / sizeof(float) ||
+        header[1] * 2 * sizeof(uint64_t) + header[2] * sizeof(float) != data_size ||
+        header[2] % (4 * floats_per_vertex) != 0) {
+      return false;
+    }
+
+    by_material = header[0] == 1;
+    first.resize(header[1]);
+    count.resize(header[1]);
+    vertices.resize(header[2]);
+    if (!in.read(reinterpret_cast<char*>(first.data()), first.size() * sizeof(uint64_t)) ||
+        !in.read(reinterpret_cast<char*>(count.data()), count.size() * sizeof(uint64_t)) ||
+        !in.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(float))) {
+      return false;
+    }
+
+    for (size_t id = 0; id < first.size(); id++) {
+      if (first[id] > n_vertices() || count[id] > n_vertices() - first[id]) return false;
+    }
+    return true;
+  }
+
+  static constexpr char MESH_MAGIC[8] = {'O', 'M', 'C', 'M', 'S', 'H', '1', '\0'};
+
+private:
+  // Append the quad on the side of voxel (i, j, k) facing direction
+  // (axis, side), wound counter-clockwise when seen from outside
+  static void add_face(std::vector<float>& v, const openmc::Position& lower, double h,
+                       int i, int j, int k, int axis, int side) {
+    int a1 = (axis + 1) % 3;
+    int a2 = (axis + 2) % 3;
+    double base[3] = {lower[0] + i * h, lower[1] + j * h, lower[2] + k * h};
+    base[axis] += side > 0 ? h : 0.0;
+
+    float normal[3] = {0.0f, 0.0f, 0.0f};
+    normal[axis] = static_cast<float>(side);
+
+    // corners in (a1, a2) order, reversed on the negative side
+    const int corners[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    for (int c = 0; c < 4; c++) {
+      const int* corner = corners[side > 0 ? c : 3 - c];
+      double p[3] = {base[0], base[1], base[2]};
+      p[a1] += corner[0] * h;
+      p[a2] += corner[1] * h;
+      v.insert(v.end(), {normal[0], normal[1], normal[2],
+                         static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2])});
+    }
+  }
+};
+
+#endif // include guard
@@ -0,0 +1,368 @@
+#ifndef OPENMC_RENDER_SURFACE_SOA_H
+#define OPENMC_RENDER_SURFACE_SOA_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/constants.h"
+#include "openmc/surface.h"
+#include "openmc/universe.h"
+
+#include "simd.h"
+
+// A quadric surface about a center point c, with p = r - c:
+//
+//   A px^2 + B py^2 + C pz^2 + D px py + E py pz + F px pz + G px + H py + J pz + K = 0
+//
+// Spheres, cylinders and cones are stored about their own center, so points
+// close to them are evaluated without the cancellation of the expanded form.
+struct Quadric {
+  openmc::Position center;
+  double A {0.0}, B {0.0}, C {0.0}, D {0.0}, E {0.0}, F {0.0}, G {0.0}, H {0.0}, J {0.0}, K {0.0};
+};
+
+// The quadric of a CSG surface, false for other surfaces (tori, DAGMC)
+inline bool to_quadric(const openmc::Surface& surface, Quadric& q) {
+  using namespace openmc;
+  q = Quadric();
+  if (auto s = dynamic_cast<const SurfaceXPlane*>(&surface)) {
+    q.G = 1.0;
+    q.K = -s->x0_;
+  } else if (auto s = dynamic_cast<const SurfaceYPlane*>(&surface)) {
+    q.H = 1.0;
+    q.K = -s->y0_;
+  } else if (auto s = dynamic_cast<const SurfaceZPlane*>(&surface)) {
+    q.J = 1.0;
+    q.K = -s->z0_;
+  } else if (auto s = dynamic_cast<const SurfacePlane*>(&surface)) {
+    q.G = s->A_;
+    q.H = s->B_;
+    q.J = s->C_;
+    q.K = -s->D_;
+  } else if (auto s = dynamic_cast<const SurfaceXCylinder*>(&surface)) {
+    q.center = {0.0, s->y0_, s->z0_};
+    q.B = q.C = 1.0;
+    q.K = -s->radius_ * s->radius_;
+  } else if (auto s = dynamic_cast<const SurfaceYCylinder*>(&surface)) {
+    q.center = {s->x0_, 0.0, s->z0_};
+    q.A = q.C = 1.0;
+    q.K = -s->radius_ * s->radius_;
+  } else if (auto s = dynamic_cast<const SurfaceZCylinder*>(&surface)) {
+    q.center = {s->x0_, s->y0_, 0.0};
+    q.A = q.B = 1.0;
+    q.K = -s->radius_ * s->radius_;
+  } else if (auto s = dynamic_cast<const SurfaceSphere*>(&surface)) {
+    q.center = {s->x0_, s->y0_, s->z0_};
+    q.A = q.B = q.C = 1.0;
+    q.K = -s->radius_ * s->radius_;
+  } else if (auto s = dynamic_cast<const SurfaceXCone*>(&surface)) {
+    // both nappes, as in OpenMC
+    q.center = {s->x0_, s->y0_, s->z0_};
+    q.A = -s->radius_sq_;
+    q.B = q.C = 1.0;
+  } else if (auto s = dynamic_cast<const SurfaceYCone*>(&surface)) {
+    q.center = {s->x0_, s->y0_, s->z0_};
+    q.B = -s->radius_sq_;
+    q.A = q.C = 1.0;
+  } else if (auto s = dynamic_cast<const SurfaceZCone*>(&surface)) {
+    q.center = {s->x0_, s->y0_, s->z0_};
+    q.C = -s->radius_sq_;
+    q.A = q.B = 1.0;
+  } else if (auto s = dynamic_cast<const SurfaceQuadric*>(&surface)) {
+    q.A = s->A_; q.B = s->B_; q.C = s->C_;
+    q.D = s->D_; q.E = s->E_; q.F = s->F_;
+    q.G = s->G_; q.H = s->H_; q.J = s->J_;
+    q.K = s->K_;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Flattened copy of the surfaces bounding the root universe's cells, each
+// stored as the general quadric
+//
+//   A x^2 + B y^2 + C z^2 + D xy + E yz + F xz + G x + H y + J z + K = 0
+//
+// in structure-of-arrays form. A primary ray from a camera outside of the
+// model can only enter a root cell by crossing one of these surfaces, so the
+// first crossing bounds the void part of the ray and rays without any
+// crossing are background. Packets of rays sharing an origin are evaluated
+// against all surfaces with SIMD instead of one virtual call per surface.
+class SurfaceSoA {
+public:
+  // Collect the root universe's surfaces. Returns false (and stays empty) if
+  // any of them isn't a quadric (a torus, say), in which case it can't be
+  // used.
+  bool build() {
+    clear();
+    const auto& root = openmc::model::universes[openmc::model::root_universe];
+
+    std::set<int32_t> indices;
+    for (int32_t i_cell : root->cells_) {
+      for (int32_t token : openmc::model::cells[i_cell]->surfaces()) {
+        int32_t index = std::abs(token) - 1;
+        if (index >= 0 && index < static_cast<int32_t>(openmc::model::surfaces.size())) {
+          indices.insert(index);
+        }
+      }
+    }
+    if (indices.empty()) return false;
+
+    for (int32_t index : indices) {
+      if (!add(*openmc::model::surfaces[index])) {
+        clear();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void clear() {
+    for (auto* c : coefficients()) c->clear();
+  }
+
+  size_t size() const { return A_.size(); }
+  bool empty() const { return A_.empty(); }
+
+  // For a packet of simd::width rays from a common origin r with directions
+  // (ux, uy, uz), find the first surface crossing within [t_min, t_max] of
+  // each ray. Lanes without a crossing are set to infinity.
+  void first_crossing(const openmc::Position& r, const double* ux, const double* uy, const double* uz,
+                      const double* t_min, const double* t_max, double* t_hit) const {
+    using simd::Lanes;
+    const Lanes inf(std::numeric_limits<double>::infinity());
+    const Lanes zero(0.0);
+
+    Lanes u = Lanes::load(ux), v = Lanes::load(uy), w = Lanes::load(uz);
+    Lanes lo = Lanes::load(t_min), hi = Lanes::load(t_max);
+    Lanes hit = inf;
+
+    // products of the direction components are shared by all surfaces
+    Lanes uu = u * u, vv = v * v, ww = w * w;
+    Lanes uv = u * v, vw = v * w, uw = u * w;
+
+    const double rx = r[0], ry = r[1], rz = r[2];
+    for (size_t s = 0; s < size(); s++) {
+      // with a shared origin the constant term and the origin parts of the
+      // linear term are scalars
+      double c = ((A_[s] * rx + D_[s] * ry + F_[s] * rz + G_[s]) * rx +
+                  (B_[s] * ry + E_[s] * rz + H_[s]) * ry +
+                  (C_[s] * rz + J_[s]) * rz + K_[s]);
+      double bx = 2.0 * A_[s] * rx + D_[s] * ry + F_[s] * rz + G_[s];
+      double by = 2.0 * B_[s] * ry + D_[s] * rx + E_[s] * rz + H_[s];
+      double bz = 2.0 * C_[s] * rz + E_[s] * ry + F_[s] * rx + J_[s];
+
+      Lanes a = Lanes(A_[s]) * uu + Lanes(B_[s]) * vv + Lanes(C_[s]) * ww +
+                Lanes(D_[s]) * uv + Lanes(E_[s]) * vw + Lanes(F_[s]) * uw;
+      Lanes b = simd::fma(Lanes(bx), u, simd::fma(Lanes(by), v, Lanes(bz) * w));
+      Lanes cc(c);
+
+      // roots of a t^2 + b t + c, planes (a = 0) have the single root -c/b
+      Lanes disc = b * b - Lanes(4.0) * a * cc;
+      simd::Mask linear = simd::abs(a) <= Lanes(1e-14) * simd::abs(b);
+      Lanes sq = simd::sqrt(simd::max(disc, zero));
+      Lanes two_a = Lanes(2.0) * a;
+      Lanes t1 = simd::select(linear, zero - cc / b, (zero - b - sq) / two_a);
+      Lanes t2 = simd::select(linear, inf, (zero - b + sq) / two_a);
+      Lanes t_lo = simd::min(t1, t2);
+      Lanes t_hi = simd::max(t1, t2);
+
+      simd::Mask real = linear | (zero <= disc);
+      simd::Mask lo_in = real & (lo <= t_lo) & (t_lo <= hi);
+      simd::Mask hi_in = real & (lo <= t_hi) & (t_hi <= hi);
+      Lanes t = simd::select(lo_in, t_lo, simd::select(hi_in, t_hi, inf));
+      hit = simd::min(hit, t);
+    }
+    hit.store(t_hit);
+  }
+
+private:
+  std::vector<std::vector<double>*> coefficients() {
+    return {&A_, &B_, &C_, &D_, &E_, &F_, &G_, &H_, &J_, &K_};
+  }
+
+  void push(double A, double B, double C, double D, double E, double F,
+            double G, double H, double J, double K) {
+    A_.push_back(A); B_.push_back(B); C_.push_back(C);
+    D_.push_back(D); E_.push_back(E); F_.push_back(F);
+    G_.push_back(G); H_.push_back(H); J_.push_back(J);
+    K_.push_back(K);
+  }
+
+  // Expanded about the origin, as the rays of a packet share theirs
+  bool add(const openmc::Surface& surface) {
+    Quadric q;
+    if (!to_quadric(surface, q)) return false;
+    double cx = q.center[0], cy = q.center[1], cz = q.center[2];
+    push(q.A, q.B, q.C, q.D, q.E, q.F,
+         q.G - 2 * q.A * cx - q.D * cy - q.F * cz,
+         q.H - 2 * q.B * cy - q.D * cx - q.E * cz,
+         q.J - 2 * q.C * cz - q.E * cy - q.F * cx,
+         q.K + (q.A * cx + q.D * cy + q.F * cz - q.G) * cx + (q.B * cy + q.E * cz - q.H) * cy +
+           (q.C * cz - q.J) * cz);
+    return true;
+  }
+
+  std::vector<double> A_, B_, C_, D_, E_, F_, G_, H_, J_, K_;
+};
+
+// The surfaces of each CSG cell, stored about their centers as in Quadric
+// with one run of simd::width aligned entries per cell. Inside the model a
+// ray's next boundary is the nearest crossing of the surfaces of its current
+// cells, which CellSurfaceSoA::distance evaluates a vector of surfaces at a
+// time instead of one virtual Surface::distance call per surface.
+class CellSurfaceSoA {
+public:
+  // Collect the surfaces of every CSG cell bounded by quadrics only. Cells
+  // with other surfaces (or DAGMC cells) aren't covered and keep using
+  // Cell::distance. Returns false if no cell is covered.
+  bool build() {
+    clear();
+    const auto& cells = openmc::model::cells;
+    const auto& surfaces = openmc::model::surfaces;
+    begin_.assign(cells.size(), -1);
+    end_.assign(cells.size(), -1);
+
+    size_t covered = 0;
+    std::vector<Quadric> quadrics;
+    for (size_t i = 0; i < cells.size(); i++) {
+      if (!dynamic_cast<const openmc::CSGCell*>(cells[i].get())) continue;
+
+      // in the order of the region, which breaks ties between surfaces
+      std::vector<int32_t> tokens = cells[i]->surfaces();
+      quadrics.resize(tokens.size());
+      bool quadric = true;
+      for (size_t j = 0; j < tokens.size() && quadric; j++) {
+        int32_t index = std::abs(tokens[j]) - 1;
+        quadric = index >= 0 && index < static_cast<int32_t>(surfaces.size()) &&
+                  to_quadric(*surfaces[index], quadrics[j]);
+      }
+      if (!quadric) continue;
+
+      begin_[i] = token_.size();
+      for (size_t j = 0; j < tokens.size(); j++) push(quadrics[j], tokens[j]);
+      // padding, which never has a crossing
+      while (token_.size() % simd::width != 0) push(Quadric(), 0);
+      end_[i] = token_.size();
+      covered++;
+    }
+    if (covered == 0) clear();
+    return covered > 0;
+  }
+
+  void clear() {
+    for (auto* c : coefficients()) c->clear();
+    token_.clear();
+    begin_.clear();
+    end_.clear();
+  }
+
+  bool empty() const { return begin_.empty(); }
+
+  bool covers(int32_t cell) const {
+    return cell >= 0 && static_cast<size_t>(cell) < begin_.size() && begin_[cell] >= 0;
+  }
+
+  // Cell::distance of a covered cell: the distance from r along u to the
+  // nearest surface of the cell and the negated token of that surface, or
+  // INFTY if there is none. on_surface is the surface the ray is on.
+  // Distances to each surface follow OpenMC's Surface::distance, and ties
+  // are broken as in Region::distance.
+  std::pair<double, int32_t> distance(int32_t cell, const openmc::Position& r, const openmc::Direction& u,
+                                      int32_t on_surface) const {
+    using simd::Lanes;
+    using simd::Mask;
+    const Lanes inf(openmc::INFTY);
+    const Lanes zero(0.0);
+    const Lanes touching_c(openmc::FP_COINCIDENT);
+    const Lanes on(std::abs(on_surface));
+
+    // products of the direction components are shared by all surfaces
+    const Lanes ux(u[0]), uy(u[1]), uz(u[2]);
+    const Lanes uu(u[0] * u[0]), vv(u[1] * u[1]), ww(u[2] * u[2]);
+    const Lanes uv(u[0] * u[1]), vw(u[1] * u[2]), uw(u[0] * u[2]);
+
+    double min_dist = openmc::INFTY;
+    int32_t i_surf = std::numeric_limits<int32_t>::max();
+    double t[simd::width];
+    for (int64_t s = begin_[cell]; s < end_[cell]; s += simd::width) {
+      Lanes A = Lanes::load(&A_[s]), B = Lanes::load(&B_[s]), C = Lanes::load(&C_[s]);
+      Lanes D = Lanes::load(&D_[s]), E = Lanes::load(&E_[s]), F = Lanes::load(&F_[s]);
+      Lanes G = Lanes::load(&G_[s]), H = Lanes::load(&H_[s]), J = Lanes::load(&J_[s]);
+      Lanes K = Lanes::load(&K_[s]);
+      Lanes x = Lanes(r[0]) - Lanes::load(&cx_[s]);
+      Lanes y = Lanes(r[1]) - Lanes::load(&cy_[s]);
+      Lanes z = Lanes(r[2]) - Lanes::load(&cz_[s]);
+
+      // a t^2 + 2 k t + c = 0 along the ray
+      Lanes a = A * uu + B * vv + C * ww + D * uv + E * vw + F * uw;
+      Lanes k = A * ux * x + B * uy * y + C * uz * z +
+                Lanes(0.5) * (D * (ux * y + uy * x) + E * (uy * z + uz * y) + F * (ux * z + uz * x) +
+                              G * ux + H * uy + J * uz);
+      Lanes c = (A * x + D * y + F * z + G) * x + (B * y + E * z + H) * y + (C * z + J) * z + K;
+
+      // the ray starts on the surface
+      Lanes surface = Lanes::load(&surface_[s]);
+      Mask touching = ((surface <= on) & (on <= surface)) | (simd::abs(c) < touching_c);
+
+      // planes have the single root -c / 2k
+      Mask linear = simd::abs(a) <= zero;
+      Lanes t_linear = (zero - c) / (Lanes(2.0) * k);
+      t_linear = simd::select(!touching & (zero < simd::abs(k)) & (zero <= t_linear), t_linear, inf);
+
+      // otherwise the nearest root in front of the ray
+      Lanes quad = k * k - a * c;
+      Lanes sq = simd::sqrt(simd::max(quad, zero));
+      Lanes t1 = (zero - k - sq) / a;
+      Lanes t2 = (zero - k + sq) / a;
+      Lanes t_lo = simd::min(t1, t2), t_hi = simd::max(t1, t2);
+      Lanes t_quadric = simd::select(zero < t_lo, t_lo, simd::select(zero < t_hi, t_hi, inf));
+      // on the surface one root is (about) zero, and k tells which is the other
+      Lanes t_away = simd::select(zero <= k, t1, t2);
+      t_quadric = simd::select(touching, simd::select(zero < t_away, t_away, inf), t_quadric);
+      t_quadric = simd::select(quad < zero, inf, t_quadric);
+
+      simd::select(linear, t_linear, t_quadric).store(t);
+      for (int lane = 0; lane < simd::width; lane++) {
+        double d = t[lane];
+        if (d < min_dist && min_dist - d >= openmc::FP_PRECISION * min_dist) {
+          min_dist = d;
+          i_surf = -token_[s + lane];
+        }
+      }
+    }
+    return {min_dist, i_surf};
+  }
+
+private:
+  std::vector<std::vector<double>*> coefficients() {
+    return {&cx_, &cy_, &cz_, &A_, &B_, &C_, &D_, &E_, &F_, &G_, &H_, &J_, &K_, &surface_};
+  }
+
+  void push(const Quadric& q, int32_t token) {
+    cx_.push_back(q.center[0]); cy_.push_back(q.center[1]); cz_.push_back(q.center[2]);
+    A_.push_back(q.A); B_.push_back(q.B); C_.push_back(q.C);
+    D_.push_back(q.D); E_.push_back(q.E); F_.push_back(q.F);
+    G_.push_back(q.G); H_.push_back(q.H); J_.push_back(q.J);
+    K_.push_back(q.K);
+    surface_.push_back(std::abs(token));
+    token_.push_back(token);
+  }
+
+  std::vector<double> cx_, cy_, cz_;
+  std::vector<double> A_, B_, C_, D_, E_, F_, G_, H_, J_, K_;
+  std::vector<double> surface_;  // index + 1, compared with on_surface
+  std::vector<int32_t> token_;
+  std::vector<int64_t> begin_;   // of each cell's run, -1 if not covered
+  std::vector<int64_t> end_;
+};
+
+#endif // include guard
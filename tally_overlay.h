@@ -0,0 +1,79 @@
+#ifndef OPENMC_RENDER_TALLY_OVERLAY_H
+#define OPENMC_RENDER_TALLY_OVERLAY_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "openmc/plot.h"
+
+#include "frame.h"
+#include "statepoint.h"
+#include "thread_pool.h"
+
+struct TallyOverlaySettings {
+  bool enabled {false};
+  bool log_scale {true};
+  bool show_error {false};  // relative error instead of the mean
+  float opacity {0.7f};
+  StatepointFile::Selection selection;
+};
+
+// Viridis-like colormap for t in [0, 1]
+inline openmc::RGBColor tally_colormap(double t) {
+  static const double stops[][3] = {
+    {68, 1, 84}, {59, 82, 139}, {33, 145, 140}, {94, 201, 98}, {253, 231, 37}};
+  const int n = sizeof(stops) / sizeof(stops[0]);
+  t = std::max(0.0, std::min(1.0, t)) * (n - 1);
+  int i = std::min(n - 2, static_cast<int>(t));
+  double f = t - i;
+  return openmc::RGBColor(static_cast<int>(stops[i][0] + f * (stops[i + 1][0] - stops[i][0]) + 0.5),
+                          static_cast<int>(stops[i][1] + f * (stops[i + 1][1] - stops[i][1]) + 0.5),
+                          static_cast<int>(stops[i][2] + f * (stops[i + 1][2] - stops[i][2]) + 0.5));
+}
+
+// Blend mesh tally values into the colors of the frame's visible pixels.
+// position(col, row, depth) gives the model position of an image pixel from
+// its G-buffer depth, so the same pass serves 3D views and slices.
+template<typename PositionFn>
+void draw_tally_overlay(Frame& frame, const StatepointFile::Mesh& mesh, const StatepointFile::Slice& slice,
+                        const TallyOverlaySettings& settings, ThreadPool& pool, PositionFn position) {
+  if (!frame.has_gbuffer()) return;
+
+  double lower, upper;
+  if (settings.show_error) {
+    lower = 0.0;
+    upper = 1.0;
+  } else if (settings.log_scale && slice.min_positive > 0.0) {
+    lower = std::log10(slice.min_positive);
+    upper = std::log10(std::max(slice.max, slice.min_positive));
+  } else {
+    lower = slice.min;
+    upper = slice.max;
+  }
+  const double range = upper > lower ? upper - lower : 1.0;
+  const double alpha = settings.opacity;
+  const int width = frame.width;
+
+  pool.parallel_for(frame.height, [&](size_t r, int) {
+    int row = frame.y0 + static_cast<int>(r);
+    for (int col = 0; col < width; col++) {
+      size_t pixel = frame.index(col, row);
+      if (frame.cell_id[pixel] < 0) continue;
+      int64_t bin = mesh.bin(position(col, row, frame.depth[pixel]));
+      if (bin < 0) continue;
+
+      double value = settings.show_error ? slice.rel_error[bin] : slice.mean[bin];
+      if (!settings.show_error && settings.log_scale) {
+        if (value <= 0.0) continue;
+        value = std::log10(value);
+      }
+      openmc::RGBColor c = tally_colormap((value - lower) / range);
+      openmc::RGBColor& out = frame.color[pixel];
+      out = openmc::RGBColor(static_cast<int>(alpha * c.red + (1.0 - alpha) * out.red + 0.5),
+                             static_cast<int>(alpha * c.green + (1.0 - alpha) * out.green + 0.5),
+                             static_cast<int>(alpha * c.blue + (1.0 - alpha) * out.blue + 0.5));
+    }
+  });
+}
+
+#endif // include guard
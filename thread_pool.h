@@ -0,0 +1,144 @@
+#ifndef OPENMC_RENDER_THREAD_POOL_H
+#define OPENMC_RENDER_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "spans.h"
+
+// Fixed set of worker threads used for all parallel tracing. Work is handed
+// out one index at a time from a shared counter, so tiles of very different
+// cost balance across the workers. The calling thread participates as well.
+class ThreadPool {
+public:
+  using Task = std::function<void(size_t index, int thread)>;
+
+  explicit ThreadPool(int n_threads = 0) {
+    resize(n_threads);
+  }
+
+  ~ThreadPool() {
+    stop_workers();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Total number of threads working on a parallel_for, including the caller
+  int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Change the number of threads, 0 selects all CPUs of the placement policy
+  void resize(int n_threads) {
+    ThreadSettings settings = settings_;
+    settings.threads = n_threads;
+    configure(settings);
+  }
+
+  // Restart the workers with a new thread count, placement and priority.
+  // Must not be called during a parallel_for.
+  void configure(const ThreadSettings& settings) {
+    settings_ = settings;
+    caller_placement_ = CallerPlacement(settings);
+    int n_threads = settings.threads;
+    if (n_threads <= 0) {
+      n_threads = CpuTopology::get().default_threads(settings.affinity, settings.numa_node);
+    }
+    stop_workers();
+
+    stopping_ = false;
+    for (int i = 1; i < n_threads; i++) {
+      workers_.emplace_back([this, i]() { worker_loop(i); });
+    }
+  }
+
+  const ThreadSettings& settings() const { return settings_; }
+
+  // Run task(index, thread) for every index in [0, n) and wait for all of
+  // them to finish. Calls from several threads take turns; a task must not
+  // call parallel_for on the same pool.
+  void parallel_for(size_t n, const Task& task) {
+    if (n == 0) return;
+
+    std::lock_guard<std::mutex> submit(submit_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      n_tasks_ = n;
+      next_ = 0;
+      active_ = static_cast<int>(workers_.size());
+      generation_++;
+    }
+    wake_.notify_all();
+
+    CallerPlacement::Scope placed(caller_placement_);
+    run_tasks(0);
+
+    // the caller's idle tail while the workers finish their last tasks
+    spans::Scope span("wait for workers");
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return active_ == 0; });
+    task_ = nullptr;
+  }
+
+private:
+  void worker_loop(int thread) {
+    place_worker_thread(settings_, thread);
+    spans::name_thread("worker " + std::to_string(thread));
+    size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this, seen]() { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+      }
+
+      run_tasks(thread);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) done_.notify_one();
+    }
+  }
+
+  void run_tasks(int thread) {
+    while (true) {
+      size_t index = next_++;
+      if (index >= n_tasks_) break;
+      (*task_)(index, thread);
+    }
+  }
+
+  void stop_workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker.join();
+    workers_.clear();
+  }
+
+  std::vector<std::thread> workers_;
+  ThreadSettings settings_;
+  CallerPlacement caller_placement_;
+  std::mutex submit_mutex_;  // held by the caller of the running parallel_for
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const Task* task_ {nullptr};
+  size_t n_tasks_ {0};
+  std::atomic<size_t> next_ {0};
+  size_t generation_ {0};
+  int active_ {0};
+  bool stopping_ {false};
+};
+
+#endif // include guard
@@ -0,0 +1,58 @@
+#ifndef OPENMC_RENDER_TIMING_H
+#define OPENMC_RENDER_TIMING_H
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Records the wall-clock duration of a sequence of named phases, e.g. the
+// steps between process start and the first frame on screen
+class PhaseTimer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void start(const std::string& phase) {
+    if (running_) stop();
+    current_ = phase;
+    phase_start_ = Clock::now();
+    running_ = true;
+  }
+
+  void stop() {
+    if (!running_) return;
+    std::chrono::duration<double> elapsed = Clock::now() - phase_start_;
+    phases_.emplace_back(current_, elapsed.count());
+    running_ = false;
+  }
+
+  double total() const {
+    double sum = 0.0;
+    for (const auto& phase : phases_) sum += phase.second;
+    return sum;
+  }
+
+  const std::vector<std::pair<std::string, double>>& phases() const {
+    return phases_;
+  }
+
+  void report(std::ostream& os, const std::string& title) const {
+    os << title << ":" << std::endl;
+    for (const auto& [name, seconds] : phases_) {
+      os << "  " << std::left << std::setw(32) << name
+         << std::right << std::fixed << std::setprecision(3) << seconds << " s" << std::endl;
+    }
+    os << "  " << std::left << std::setw(32) << "total"
+       << std::right << std::fixed << std::setprecision(3) << total() << " s" << std::endl;
+  }
+
+private:
+  std::vector<std::pair<std::string, double>> phases_;
+  std::string current_;
+  Clock::time_point phase_start_;
+  bool running_ {false};
+};
+
+#endif // include guard
@@ -0,0 +1,622 @@
+#ifndef OPENMC_RENDER_TRACER_H
+#define OPENMC_RENDER_TRACER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "openmc/bounding_box.h"
+#include "openmc/cell.h"
+#include "openmc/constants.h"
+#include "openmc/geometry.h"
+#include "openmc/lattice.h"
+#include "openmc/material.h"
+#include "openmc/plot.h"
+#include "openmc/surface.h"
+#include "openmc/universe.h"
+
+#include "clip.h"
+#include "frame.h"
+#include "cost.h"
+#include "lod.h"
+#include "surface_soa.h"
+
+// Primary ray generation for a width x height image of a PhongPlot's view.
+// This follows openmc::RayTracePlot::get_pixel_ray so that images traced
+// here line up with PhongPlot::create_image, but works for any image size
+// and sub-pixel positions.
+class CameraRays {
+public:
+  CameraRays(openmc::PhongPlot& plot, int width, int height)
+    : CameraRays(plot.camera_position(), plot.look_at(), plot.up(), plot.horizontal_field_of_view(),
+                 width, height) {}
+
+  // Camera other than the plot's, e.g. of a secondary viewport
+  CameraRays(const openmc::Position& origin, const openmc::Position& look_at, const openmc::Direction& up,
+             double fov, int width, int height)
+    : width_(width), height_(height) {
+    origin_ = origin;
+
+    forward_ = look_at - origin_;
+    forward_ /= forward_.norm();
+
+    right_ = forward_.cross(up);
+    right_ /= right_.norm();
+
+    up_ = right_.cross(forward_);
+    up_ /= up_.norm();
+
+    tan_half_fov_ = std::tan(0.5 * fov * M_PI / 180.0);
+  }
+
+  const openmc::Position& origin() const { return origin_; }
+  const openmc::Direction& forward() const { return forward_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Width of a pixel per unit distance from the camera
+  double pixel_angle() const { return 2.0 * tan_half_fov_ / width_; }
+
+  openmc::Direction direction(double horiz, double vert) const {
+    double x = tan_half_fov_ * (2.0 * horiz / width_ - 1.0);
+    double y = tan_half_fov_ * (height_ - 2.0 * vert) / width_;
+    openmc::Direction u = forward_ + right_ * x + up_ * y;
+    return u / u.norm();
+  }
+
+private:
+  int width_;
+  int height_;
+  double tan_half_fov_;
+  openmc::Position origin_;
+  openmc::Direction forward_;
+  openmc::Direction right_;
+  openmc::Direction up_;
+};
+
+// Axis-aligned bounds of the model, used to skip or shorten primary rays
+// before they reach OpenMC's geometry routines
+struct ModelBounds {
+  openmc::Position lower;
+  openmc::Position upper;
+  bool finite {false};
+
+  // Bounds of the root universe. The box is padded slightly so rays clipped
+  // to it start in the void outside of the model.
+  static ModelBounds root_universe() {
+    ModelBounds bounds;
+    openmc::BoundingBox bb = openmc::model::universes[openmc::model::root_universe]->bounding_box();
+    bounds.lower = {bb.xmin, bb.ymin, bb.zmin};
+    bounds.upper = {bb.xmax, bb.ymax, bb.zmax};
+    bounds.finite = true;
+    for (int i = 0; i < 3; i++) {
+      if (!std::isfinite(bounds.lower[i]) || !std::isfinite(bounds.upper[i])) bounds.finite = false;
+    }
+    if (bounds.finite) {
+      double pad = 1e-4 * (bounds.upper - bounds.lower).norm() + 1e-6;
+      bounds.lower -= openmc::Position(pad, pad, pad);
+      bounds.upper += openmc::Position(pad, pad, pad);
+    }
+    return bounds;
+  }
+
+  // Slab test. On a hit, [t_enter, t_exit] is the part of the ray inside the
+  // box; t_enter is negative when the origin is inside.
+  bool intersect(const openmc::Position& r, const openmc::Direction& u, double& t_enter, double& t_exit) const {
+    t_enter = -std::numeric_limits<double>::infinity();
+    t_exit = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 3; i++) {
+      if (u[i] == 0.0) {
+        if (r[i] < lower[i] || r[i] > upper[i]) return false;
+        continue;
+      }
+      double inv = 1.0 / u[i];
+      double t0 = (lower[i] - r[i]) * inv;
+      double t1 = (upper[i] - r[i]) * inv;
+      if (t0 > t1) std::swap(t0, t1);
+      t_enter = std::max(t_enter, t0);
+      t_exit = std::min(t_exit, t1);
+    }
+    return t_enter <= t_exit && t_exit > 0.0;
+  }
+};
+
+// Per-frame switches of the tile kernel. StaticKernel fixes them at compile
+// time so the per-pixel loops don't branch on them; DynamicKernel reads them
+// at run time and is kept for comparison in the benchmark.
+template<bool ByMaterial, bool Cull, bool Prepass, bool GBuffer, bool Lod, bool Clip, bool Cost>
+struct StaticKernel {
+  static constexpr bool by_material = ByMaterial;  // color by material or cell
+  static constexpr bool cull = Cull;               // bounding box culling
+  static constexpr bool prepass = Prepass;         // SIMD root surface pre-pass
+  static constexpr bool gbuffer = GBuffer;         // write the G-buffer
+  static constexpr bool lod = Lod;                 // homogenize small fills
+  static constexpr bool clip = Clip;               // limit rays to the clip region
+  static constexpr bool cost = Cost;               // count traversal work per pixel
+};
+
+struct DynamicKernel {
+  bool by_material;
+  bool cull;
+  bool prepass;
+  bool gbuffer;
+  bool lod;
+  bool clip;
+  bool cost;
+};
+
+// Call f with the StaticKernel matching the switches of k
+template<typename F>
+void dispatch_kernel(const DynamicKernel& k, F&& f) {
+  auto with = [](bool value, auto&& g) {
+    if (value) g(std::true_type {}); else g(std::false_type {});
+  };
+  with(k.by_material, [&](auto by_material) {
+    with(k.cull, [&](auto cull) {
+      with(k.prepass, [&](auto prepass) {
+        with(k.gbuffer, [&](auto gbuffer) {
+          with(k.lod, [&](auto lod) {
+            with(k.clip, [&](auto clip) {
+              with(k.cost, [&](auto cost) {
+                f(StaticKernel<decltype(by_material)::value, decltype(cull)::value,
+                               decltype(prepass)::value, decltype(gbuffer)::value,
+                               decltype(lod)::value, decltype(clip)::value,
+                               decltype(cost)::value> {});
+              });
+            });
+          });
+        });
+      });
+    });
+  });
+}
+
+// Data shared by all rays of a frame
+struct FrameContext {
+  openmc::PhongPlot* plot {nullptr};    // of the scene being traced
+  const ClipRegion* clip {nullptr};     // of the scene, for kernels with clip
+  std::vector<uint8_t> visible;         // flags of the opaque cell or material indices
+  const LodTable::View* lod {nullptr};  // fills to homogenize, for kernels with lod
+  double lod_threshold {1.0};           // feature size in pixels below which fills are homogenized
+  double pixel_angle {0.0};             // see CameraRays::pixel_angle
+  openmc::Position light;
+  double diffuse_fraction {0.1};
+  const std::vector<openmc::RGBColor>* colors {nullptr};
+  openmc::RGBColor background;
+  const CostMap* cost {nullptr};        // region sizes, for kernels with cost
+  const CellSurfaceSoA* cells {nullptr};  // if set, rays are traced with it
+};
+
+// A PhongRay that also records the first visible surface it hits, which
+// provides the G-buffer (cell, material, depth) in the same trace as the color
+template<typename Kernel>
+class GBufferRay : public openmc::PhongRay {
+public:
+  // camera is the point depth is measured from, r may lie further along the
+  // ray if it was clipped
+  GBufferRay(openmc::Position r, openmc::Direction u, openmc::PhongPlot& plot, openmc::Position camera,
+             const Kernel& kernel, const FrameContext& context)
+    : openmc::PhongRay(r, u, plot), origin_(camera), kernel_(kernel), context_(context) {}
+
+  // Limit the ray to the clip region: it ends exit_distance from the camera,
+  // and if it starts on a clip face (cap) with this normal, a visible cell
+  // at the start is drawn as a cut surface
+  void set_clip(double exit_distance, bool cap, const openmc::Direction& cap_normal) {
+    clip_exit_ = exit_distance;
+    cap_ = cap;
+    cap_normal_ = cap_normal;
+  }
+
+  // Count this ray's work, and per cell into cells (for kernels with cost).
+  // The ray is assumed to start outside of the model, where the search for
+  // its first boundary tests the surfaces of all root universe cells.
+  void set_cost(CellCost* cells) {
+    cell_cost_ = cells;
+    cost_.surfaces = context_.cost->root_surfaces();
+    cost_.lookups = 1;
+  }
+
+  RayCost& cost() { return cost_; }
+
+  // trace() for primary rays, including cut surfaces for clipped kernels
+  void trace_view() {
+    if (kernel_.clip && cap_ && cap_hit()) {
+      return;
+    }
+    if (context_.cells) {
+      trace_cells();
+      return;
+    }
+    trace();
+  }
+
+  // Ray::trace, but with the distance to the next boundary from
+  // cell_distance_to_boundary. Ray::trace can't be given another distance
+  // function and PhongRay's state is private, so the shading of
+  // PhongRay::on_intersection is done by shade_intersection instead.
+  void trace_cells() {
+    own_trace_ = true;
+    traced_color_ = context_.background;
+
+    bool inside = openmc::exhaustive_find_cell(*this);
+    int events = 0;
+    while (!inside) {
+      advance_to_boundary_from_void();
+      inside = openmc::exhaustive_find_cell(*this);
+      if (surface() == std::numeric_limits<int>::max()) return;  // lost
+      if (inside) break;
+      if (boundary().surface_index == openmc::SURFACE_NONE) return;
+      if (++events > max_events) return;
+    }
+
+    if (boundary().surface_index != openmc::SURFACE_NONE) {
+      surface() = boundary().surface_index;
+      on_intersection();
+      if (stopped_) return;
+    }
+    surface() = 0;
+
+    while (true) {
+      boundary() = cell_distance_to_boundary();
+      const openmc::BoundaryInfo& next = boundary();
+      if (next.distance >= openmc::INFTY) return;
+
+      for (int level = 0; level < n_coord(); level++) {
+        coord(level).r += next.distance * coord(level).u;
+      }
+      surface() = next.surface_index;
+      n_coord_last() = n_coord();
+      n_coord() = next.coord_level;
+      const auto& t = next.lattice_translation;
+      if (t[0] != 0 || t[1] != 0 || t[2] != 0) {
+        openmc::cross_lattice(*this, next);
+      }
+      inside = openmc::neighbor_list_find_cell(*this);
+
+      // as Ray::trace, skip crossings of (nearly) coincident surfaces
+      if (next.distance > 10 * openmc::TINY_BIT) {
+        on_intersection();
+      }
+      if (stopped_ || !inside) return;
+      if (++events > max_events) return;
+    }
+  }
+
+  // openmc::distance_to_boundary with the surfaces of cells covered by the
+  // cell SoA evaluated by CellSurfaceSoA::distance. Hexagonal lattices need
+  // the position in the lattice's own frame and are left to OpenMC.
+  openmc::BoundaryInfo cell_distance_to_boundary() {
+    using namespace openmc;
+    const CellSurfaceSoA& soa = *context_.cells;
+    for (int i = 0; i < n_coord(); i++) {
+      int32_t lattice = coord(i).lattice;
+      if (lattice != C_NONE && model::lattices[lattice]->type_ == LatticeType::hex) {
+        return distance_to_boundary(*this);
+      }
+    }
+
+    BoundaryInfo info;
+    info.distance = INFINITY;
+    info.surface_index = SURFACE_NONE;
+    info.coord_level = 0;
+    info.lattice_translation = {0, 0, 0};
+
+    // as in OpenMC, a lattice distance carries over to the levels below
+    double d_lat = INFINITY;
+    std::array<int, 3> level_lat_trans {0, 0, 0};
+    for (int i = 0; i < n_coord(); i++) {
+      const LocalCoord& c = coord(i);
+      const Cell& cell = *model::cells[c.cell];
+
+      if (c.lattice != C_NONE) {
+        auto lattice_distance = model::lattices[c.lattice]->distance(c.r, c.u, c.lattice_i);
+        d_lat = lattice_distance.first;
+        level_lat_trans = lattice_distance.second;
+      }
+
+      auto surface_distance = soa.covers(c.cell) ? soa.distance(c.cell, c.r, c.u, surface())
+                                                 : cell.distance(c.r, c.u, surface(), this);
+      double d_surf = surface_distance.first;
+      int32_t level_surf_cross = surface_distance.second;
+
+      if (d_surf < d_lat - FP_COINCIDENT) {
+        if (info.distance == INFINITY || (info.distance - d_surf) / info.distance >= FP_REL_PRECISION) {
+          info.distance = d_surf;
+          if (cell.is_simple() || d_surf == INFTY) {
+            info.surface_index = level_surf_cross;
+          } else {
+            // both half-spaces may appear in the region, so the side the ray
+            // crosses into follows from the normal
+            const Surface& surf = *model::surfaces[std::abs(level_surf_cross) - 1];
+            Direction normal = surf.normal(c.r + d_surf * c.u);
+            info.surface_index = c.u.dot(normal) > 0.0 ? std::abs(level_surf_cross)
+                                                       : -std::abs(level_surf_cross);
+          }
+          info.lattice_translation = {0, 0, 0};
+          info.coord_level = i + 1;
+        }
+      } else {
+        if (info.distance == INFINITY || (info.distance - d_lat) / info.distance >= FP_REL_PRECISION) {
+          info.distance = d_lat;
+          info.surface_index = SURFACE_NONE;
+          info.lattice_translation = level_lat_trans;
+          info.coord_level = i + 1;
+        }
+      }
+    }
+    return info;
+  }
+
+  bool cap_hit() {
+    if (!openmc::exhaustive_find_cell(*this)) {
+      n_coord() = 1;
+      return false;
+    }
+    int32_t index = kernel_.by_material ? material() : lowest_coord().cell;
+    const auto& visible = context_.visible;
+    if (index < 0 || static_cast<size_t>(index) >= visible.size() || !visible[index]) {
+      // trace() searches for the cell again from the root universe
+      n_coord() = 1;
+      return false;
+    }
+
+    hit_ = true;
+    cell_index_ = lowest_coord().cell;
+    material_index_ = material();
+    depth_ = (r() - origin_).norm();
+    own_color_ = true;
+    shaded_color_ = shade((*context_.colors)[index], cap_normal_);
+    return true;
+  }
+
+  void on_intersection() override {
+    if (kernel_.cost) {
+      count_crossing();
+    }
+    if (kernel_.clip && !shadow_ && (r() - origin_).norm() > clip_exit_) {
+      // left the clip region without hitting anything
+      clip_miss_ = true;
+      stop();
+      return;
+    }
+    if (kernel_.clip && shadow_ && (r() - shadow_origin_).norm() > shadow_exit_) {
+      // the rest of the way to the light is cut away and casts no shadow
+      stop();
+      return;
+    }
+    if (kernel_.lod && !hit_ && homogenized_hit()) {
+      return;
+    }
+    if (!kernel_.gbuffer) {
+      phong_intersection();
+      return;
+    }
+    if (!hit_) {
+      int32_t index = kernel_.by_material ? material() : lowest_coord().cell;
+      const auto& visible = context_.visible;
+      if (index >= 0 && static_cast<size_t>(index) < visible.size() && visible[index]) {
+        hit_ = true;
+        cell_index_ = lowest_coord().cell;
+        material_index_ = material();
+        depth_ = (r() - origin_).norm();
+      }
+    }
+    phong_intersection();
+  }
+
+  // PhongRay turns the ray toward the light at the first opaque cell. For
+  // clipped kernels the shadow leg is limited to the clip region as well.
+  void phong_intersection() {
+    if (own_trace_) {
+      shade_intersection();
+      return;
+    }
+    if (!kernel_.clip || shadow_) {
+      openmc::PhongRay::on_intersection();
+      return;
+    }
+    openmc::Direction incoming = u();
+    openmc::PhongRay::on_intersection();
+    if (u() != incoming) start_shadow();
+  }
+
+  // PhongRay::on_intersection for trace_cells, with shadow_ for PhongRay's
+  // reflected state
+  void shade_intersection() {
+    int32_t index = kernel_.by_material ? material() : lowest_coord().cell;
+
+    // the shadow leg ends past the camera, opaque or not
+    if (shadow_ && (r() - context_.plot->camera_position()).dot(u()) >= 0.0) {
+      stop();
+      return;
+    }
+
+    const auto& visible = context_.visible;
+    if (index < 0 || static_cast<size_t>(index) >= visible.size() || !visible[index]) return;
+
+    if (shadow_) {
+      // the light is blocked
+      traced_color_ = (*context_.colors)[shadow_index_];
+      traced_color_ *= context_.diffuse_fraction;
+      stop();
+      return;
+    }
+
+    // PhongRay gives up on the rare hits without a crossed surface
+    if (surface() == 0) {
+      traced_color_ = context_.plot->overlap_color_;
+      stop();
+      return;
+    }
+
+    // normal in the root universe's frame, against the ray
+    openmc::Direction normal = openmc::model::surfaces[std::abs(surface()) - 1]->normal(r_local());
+    normal /= normal.norm();
+    for (int level = n_coord() - 2; level >= 0; level--) {
+      if (coord(level + 1).rotated) {
+        normal = normal.inverse_rotate(openmc::model::cells[coord(level).cell]->rotation_);
+      }
+    }
+    if (normal.dot(u()) > 0.0) normal *= -1.0;
+    traced_color_ = shade((*context_.colors)[index], normal);
+    shadow_index_ = index;
+
+    // restart toward the light
+    openmc::Direction to_light = context_.light - r();
+    to_light /= to_light.norm();
+    clear();
+    u() = to_light;
+    if (!openmc::exhaustive_find_cell(*this)) {
+      stop();
+      return;
+    }
+    start_shadow();
+  }
+
+  // The ray has been turned toward the light at r()
+  void start_shadow() {
+    shadow_ = true;
+    shadow_origin_ = r();
+    if (!kernel_.clip) return;
+    double t_enter = 0.0;
+    double t_exit = std::numeric_limits<double>::infinity();
+    openmc::Direction normal;
+    shadow_exit_ = context_.clip->clip(shadow_origin_, u(), t_enter, t_exit, normal) ? t_exit : 0.0;
+  }
+
+  // Also seen by trace_cells, which can't read Ray's own flag
+  void stop() {
+    stopped_ = true;
+    openmc::PhongRay::stop();
+  }
+
+  // Stop at the outermost filled cell around the current position whose
+  // features are below the threshold at this distance, with its homogenized
+  // color shaded by the boundary just crossed
+  bool homogenized_hit() {
+    double depth = (r() - origin_).norm();
+    double size_per_pixel = depth * context_.pixel_angle;
+    for (int level = 0; level < n_coord() - 1; level++) {
+      int32_t cell = coord(level).cell;
+      if (!context_.lod->homogenize(cell, size_per_pixel, context_.lod_threshold)) continue;
+
+      // the surface normal is only known if the ray entered through one of
+      // this cell's own surfaces, otherwise light it head on
+      openmc::Direction normal = u() * -1.0;
+      int32_t surface = std::abs(this->surface()) - 1;
+      if (surface >= 0 && !coord(level).rotated) {
+        for (int32_t token : openmc::model::cells[cell]->surfaces()) {
+          if (std::abs(token) - 1 != surface) continue;
+          normal = openmc::model::surfaces[surface]->normal(coord(level).r);
+          normal /= normal.norm();
+          if (normal.dot(u()) > 0.0) normal *= -1.0;
+          break;
+        }
+      }
+      shaded_color_ = shade(context_.lod->color(cell), normal);
+      own_color_ = true;
+      hit_ = true;
+      cell_index_ = cell;
+      material_index_ = -1;  // a mix of materials
+      depth_ = depth;
+      stop();
+      return true;
+    }
+    return false;
+  }
+
+  // Tally the boundary just crossed. The cell search after a crossing starts
+  // at the coordinate level of the crossed surface, and the next distance to
+  // boundary tests the surfaces of the cells at every level.
+  void count_crossing() {
+    const openmc::BoundaryInfo& crossed = boundary();
+    int32_t entered = lowest_coord().cell;
+    uint32_t lookups = std::max(1, n_coord() - crossed.coord_level + 1);
+    cost_.crossings++;
+    cost_.lookups += lookups;
+    cell_cost_[entered].crossings++;
+    cell_cost_[entered].lookups += lookups;
+
+    const auto& t = crossed.lattice_translation;
+    if (t[0] != 0 || t[1] != 0 || t[2] != 0) {
+      int level = crossed.coord_level - 2;  // the cell filled with the lattice
+      cost_.lattice++;
+      cell_cost_[level >= 0 ? coord(level).cell : entered].lattice++;
+    }
+
+    for (int level = 0; level < n_coord(); level++) {
+      int32_t cell = coord(level).cell;
+      uint32_t n = context_.cost->cell_surfaces(cell);
+      cost_.surfaces += n;
+      cell_cost_[cell].surfaces += n;
+    }
+  }
+
+  bool hit() const { return hit_; }
+
+  // Diffuse shading of colors computed here rather than by PhongRay
+  openmc::RGBColor shade(openmc::RGBColor color, const openmc::Direction& normal) {
+    openmc::Direction to_light = context_.light - r();
+    to_light /= to_light.norm();
+    color *= context_.diffuse_fraction +
+      (1.0 - context_.diffuse_fraction) * std::max(0.0, normal.dot(to_light));
+    return color;
+  }
+
+  // Color of the pixel, the background color for misses
+  openmc::RGBColor color() {
+    if (own_color_) return shaded_color_;
+    if (clip_miss_ && !hit_) return context_.background;
+    return phong_color();
+  }
+
+  // PhongRay's color, or the same computed by trace_cells
+  openmc::RGBColor phong_color() {
+    return own_trace_ ? traced_color_ : result_color();
+  }
+
+  // Write this ray's results to a pixel of the frame
+  void store(Frame& frame, size_t pixel) {
+    if (!hit_) {
+      frame.set_background(pixel, phong_color());
+      return;
+    }
+    frame.color[pixel] = color();
+    if (!kernel_.gbuffer) return;
+    frame.cell_id[pixel] = openmc::model::cells[cell_index_]->id_;
+    frame.material_id[pixel] = material_index_ >= 0 ? openmc::model::materials[material_index_]->id_ : -1;
+    frame.depth[pixel] = depth_;
+  }
+
+private:
+  static constexpr int max_events = 1000000;  // as Ray::MAX_INTERSECTIONS
+
+  openmc::Position origin_;
+  const Kernel& kernel_;
+  const FrameContext& context_;
+  bool hit_ {false};
+  bool own_color_ {false};  // shaded_color_ is used instead of PhongRay's
+  openmc::RGBColor shaded_color_;
+  double clip_exit_ {std::numeric_limits<double>::infinity()};
+  bool cap_ {false};
+  openmc::Direction cap_normal_;
+  bool clip_miss_ {false};
+  bool shadow_ {false};  // on the way to the light, for kernels with clip
+  openmc::Position shadow_origin_;
+  double shadow_exit_ {std::numeric_limits<double>::infinity()};
+  bool own_trace_ {false};  // traced by trace_cells
+  bool stopped_ {false};
+  openmc::RGBColor traced_color_;
+  int32_t shadow_index_ {-1};  // color index of the shaded hit
+  int32_t cell_index_ {-1};
+  int32_t material_index_ {-1};
+  double depth_ {0.0};
+  RayCost cost_;
+  CellCost* cell_cost_ {nullptr};
+};
+
+#endif // include guard
@@ -0,0 +1,281 @@
+#ifndef OPENMC_RENDER_TRACKS_H
+#define OPENMC_RENDER_TRACKS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "openmc/position.h"
+
+#include "hdf5_util.h"
+
+constexpr int track_levels = 4;
+constexpr int particle_types = 4;  // neutron, photon, electron, positron
+
+// Particle tracks from an OpenMC track file, streamed on a background thread
+// into chunks of vertex data that are uploaded as one vertex buffer each.
+// Every track is stored at several levels of detail, from the exact polyline
+// down to coarser ones that drop vertices closer than a tolerance to the last
+// kept one, so each frame can draw a track at the coarsest level whose error
+// is below a pixel, or skip it altogether when it's too small to see.
+struct Track {
+  float center[3];  // bounding sphere
+  float radius;
+  float tolerance[track_levels];  // max deviation of each level from the polyline
+  uint32_t first[track_levels];   // vertex ranges of the levels in the chunk
+  uint32_t count[track_levels];
+  uint8_t type;
+};
+
+struct TrackChunk {
+  std::vector<float> vertices;  // xyz
+  std::vector<Track> tracks;
+  size_t segments {0};          // at full detail
+};
+
+// Camera and screen-space limits for one frame
+struct TrackView {
+  openmc::Position camera;
+  openmc::Direction forward;
+  double tan_half_fov_x;
+  double tan_half_fov_y;
+  double pixel_angle;       // pixel width per unit distance
+  float max_error {1.0f};   // allowed deviation in pixels
+  float min_size {0.5f};    // tracks with a smaller diameter in pixels are skipped
+};
+
+// First vertex and vertex count of every line strip to draw, per particle type
+struct TrackDrawList {
+  std::vector<int32_t> first[particle_types];
+  std::vector<int32_t> count[particle_types];
+  size_t tracks {0};
+  size_t segments {0};
+
+  void clear() {
+    for (int t = 0; t < particle_types; t++) {
+      first[t].clear();
+      count[t].clear();
+    }
+    tracks = 0;
+    segments = 0;
+  }
+};
+
+// Append the visible tracks of a chunk to list at their level of detail
+inline void cull_tracks(const std::vector<Track>& tracks, const TrackView& view, TrackDrawList& list) {
+  // the cone around the view direction through the corners of the frustum
+  const double tan_half_angle = std::sqrt(view.tan_half_fov_x * view.tan_half_fov_x +
+                                          view.tan_half_fov_y * view.tan_half_fov_y);
+  const double cos_half_angle = 1.0 / std::sqrt(1.0 + tan_half_angle * tan_half_angle);
+  for (const Track& track : tracks) {
+    openmc::Position d = openmc::Position(track.center[0], track.center[1], track.center[2]) - view.camera;
+    double depth = d.dot(view.forward);
+    double distance = d.norm();
+
+    // outside of the view frustum, checked against its bounding cone
+    if (depth < -track.radius) continue;
+    double lateral = std::sqrt(std::max(0.0, distance * distance - depth * depth));
+    if (lateral - tan_half_angle * depth > track.radius / cos_half_angle) continue;
+
+    // length of a pixel at the track's nearest point
+    double pixel = std::max(distance - track.radius, 1e-6) * view.pixel_angle;
+    if (2.0 * track.radius < view.min_size * pixel) continue;
+
+    int level = 0;
+    while (level + 1 < track_levels && track.tolerance[level + 1] <= view.max_error * pixel) {
+      level++;
+    }
+    list.first[track.type].push_back(static_cast<int32_t>(track.first[level]));
+    list.count[track.type].push_back(static_cast<int32_t>(track.count[level]));
+    list.tracks++;
+    list.segments += track.count[level] - 1;
+  }
+}
+
+// Add a track's levels of detail to a chunk
+inline void add_track(const std::vector<openmc::Position>& points, uint8_t type, TrackChunk& chunk) {
+  if (points.size() < 2) return;
+
+  Track track;
+  track.type = type < particle_types ? type : 0;
+  openmc::Position lower = points[0], upper = points[0];
+  for (const auto& p : points) {
+    for (int i = 0; i < 3; i++) {
+      lower[i] = std::min(lower[i], p[i]);
+      upper[i] = std::max(upper[i], p[i]);
+    }
+  }
+  openmc::Position center = 0.5 * (lower + upper);
+  for (int i = 0; i < 3; i++) track.center[i] = static_cast<float>(center[i]);
+  track.radius = static_cast<float>(0.5 * (upper - lower).norm());
+
+  auto push = [&](const openmc::Position& p) {
+    chunk.vertices.push_back(static_cast<float>(p[0]));
+    chunk.vertices.push_back(static_cast<float>(p[1]));
+    chunk.vertices.push_back(static_cast<float>(p[2]));
+  };
+
+  // level 0 is exact, each further level quadruples the tolerance starting
+  // at 1% of the track's size
+  for (int level = 0; level < track_levels; level++) {
+    double tolerance = level == 0 ? 0.0 : 0.01 * track.radius * std::pow(4.0, level - 1);
+    track.tolerance[level] = static_cast<float>(tolerance);
+    track.first[level] = static_cast<uint32_t>(chunk.vertices.size() / 3);
+    push(points.front());
+    const openmc::Position* last = &points.front();
+    for (size_t i = 1; i + 1 < points.size(); i++) {
+      if ((points[i] - *last).norm() >= tolerance) {
+        push(points[i]);
+        last = &points[i];
+      }
+    }
+    push(points.back());
+    track.count[level] = static_cast<uint32_t>(chunk.vertices.size() / 3) - track.first[level];
+  }
+  chunk.segments += points.size() - 1;
+  chunk.tracks.push_back(track);
+}
+
+// Reads a track file on a background thread. Each dataset of the file holds
+// the tracks of one source particle and its secondaries; they are read one
+// at a time and published in chunks of roughly chunk_vertices vertices.
+class TrackStream {
+public:
+  static constexpr size_t chunk_vertices = 1 << 20;
+
+  ~TrackStream() { stop(); }
+
+  void start(const std::string& path, std::function<void(TrackChunk&&)> publish) {
+    stop();
+    cancel_ = false;
+    done_ = false;
+    read_ = 0;
+    total_ = 0;
+    error_.clear();
+    thread_ = std::thread([this, path, publish] {
+      try {
+        read(path, publish);
+      } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        error_ = e.what();
+      }
+      done_ = true;
+    });
+  }
+
+  void stop() {
+    if (thread_.joinable()) {
+      cancel_ = true;
+      thread_.join();
+    }
+  }
+
+  bool done() const { return done_; }
+  double progress() const { return total_ > 0 ? static_cast<double>(read_) / total_ : 0.0; }
+
+  std::string error() {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return error_;
+  }
+
+private:
+  void read(const std::string& path, const std::function<void(TrackChunk&&)>& publish) {
+    struct Position { double x, y, z; };
+    h5::Handle file, position_type, state_type;
+    hsize_t n_datasets = 0;
+    {
+      std::lock_guard<std::mutex> lock(h5::mutex());
+      if (H5Fis_hdf5(path.c_str()) <= 0) {
+        throw std::runtime_error(path + " is not an HDF5 file");
+      }
+      file = h5::Handle(H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+      if (!file.valid()) {
+        throw std::runtime_error("Failed to open " + path);
+      }
+      if (h5::read_string_attribute(file, "filetype") != "track") {
+        file = h5::Handle();
+        throw std::runtime_error(path + " is not an OpenMC track file");
+      }
+      H5G_info_t info;
+      H5Gget_info(file, &info);
+      n_datasets = info.nlinks;
+
+      // only the positions are read, as a nested compound like the file's
+      position_type = h5::Handle(H5Tcreate(H5T_COMPOUND, sizeof(Position)), H5Tclose);
+      H5Tinsert(position_type, "x", HOFFSET(Position, x), H5T_NATIVE_DOUBLE);
+      H5Tinsert(position_type, "y", HOFFSET(Position, y), H5T_NATIVE_DOUBLE);
+      H5Tinsert(position_type, "z", HOFFSET(Position, z), H5T_NATIVE_DOUBLE);
+      state_type = h5::Handle(H5Tcreate(H5T_COMPOUND, sizeof(Position)), H5Tclose);
+      H5Tinsert(state_type, "r", 0, position_type);
+    }
+    total_ = n_datasets;
+
+    TrackChunk chunk;
+    std::vector<Position> states;
+    std::vector<openmc::Position> points;
+    for (hsize_t i = 0; i < n_datasets && !cancel_; i++) {
+      std::vector<int64_t> offsets;
+      std::vector<int32_t> types;
+      {
+        std::lock_guard<std::mutex> lock(h5::mutex());
+        char name[256];
+        if (H5Lget_name_by_idx(file, ".", H5_INDEX_NAME, H5_ITER_INC, i, name, sizeof(name), H5P_DEFAULT) < 0 ||
+            std::string(name).compare(0, 6, "track_") != 0) {
+          read_++;
+          continue;
+        }
+        h5::Handle dataset(H5Dopen2(file, name, H5P_DEFAULT), H5Dclose);
+        h5::Handle space(H5Dget_space(dataset), H5Sclose);
+        states.resize(H5Sget_simple_extent_npoints(space));
+        if (!states.empty() && H5Dread(dataset, state_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, states.data()) < 0) {
+          states.clear();
+        }
+        offsets = h5::read_attribute<int64_t>(dataset, "offsets", H5T_NATIVE_INT64);
+        types = h5::read_attribute<int32_t>(dataset, "particles", H5T_NATIVE_INT32);
+      }
+      if (cancel_) break;
+
+      // offsets start each particle's track, with or without a final entry
+      if (offsets.empty()) offsets.push_back(0);
+      if (offsets.back() != static_cast<int64_t>(states.size())) offsets.push_back(states.size());
+      for (size_t t = 0; t + 1 < offsets.size(); t++) {
+        int64_t begin = std::max<int64_t>(0, offsets[t]);
+        int64_t end = std::min<int64_t>(states.size(), offsets[t + 1]);
+        points.clear();
+        for (int64_t s = begin; s < end; s++) {
+          points.emplace_back(states[s].x, states[s].y, states[s].z);
+        }
+        uint8_t type = t < types.size() ? static_cast<uint8_t>(types[t]) : 0;
+        add_track(points, type, chunk);
+      }
+      read_++;
+
+      if (chunk.vertices.size() / 3 >= chunk_vertices) {
+        publish(std::move(chunk));
+        chunk = TrackChunk();
+      }
+    }
+    if (!chunk.tracks.empty()) publish(std::move(chunk));
+
+    std::lock_guard<std::mutex> lock(h5::mutex());
+    position_type = h5::Handle();
+    state_type = h5::Handle();
+    file = h5::Handle();
+  }
+
+  std::thread thread_;
+  std::atomic<bool> cancel_ {false};
+  std::atomic<bool> done_ {false};
+  std::atomic<size_t> read_ {0};
+  std::atomic<size_t> total_ {0};
+  std::mutex error_mutex_;
+  std::string error_;
+};
+
+#endif // include guard
@@ -0,0 +1,142 @@
+#ifndef OPENMC_RENDER_VIEWPORTS_H
+#define OPENMC_RENDER_VIEWPORTS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "openmc/position.h"
+
+#include "frame.h"
+
+// Everything a traced view depends on. The scene version stands for the
+// colors, visibility, kernel settings and the model, which are shared by
+// all views and bumped by the renderer whenever one of them may change.
+struct ViewSignature {
+  openmc::Position position;
+  openmc::Position look_at;
+  openmc::Direction up;
+  openmc::Position light;
+  double fov {0.0};
+  int width {0};
+  int height {0};
+  uint64_t scene {0};
+
+  bool operator==(const ViewSignature& other) const {
+    return position == other.position && look_at == other.look_at && up == other.up &&
+           light == other.light && fov == other.fov && width == other.width &&
+           height == other.height && scene == other.scene;
+  }
+  bool operator!=(const ViewSignature& other) const { return !(*this == other); }
+};
+
+// A view traced through the TileScheduler. The frame is only traced again
+// when the wanted signature differs from the one it was (or is being)
+// traced with, so views that don't change cost nothing.
+struct ScheduledView {
+  ViewSignature wanted;       // set by the owner before every schedule
+  ViewSignature traced;       // of the tiles traced into the frame
+  bool interactive {false};   // traced whole in every frame it changes
+  Frame frame;
+  std::vector<Tile> pending;  // tiles of the frame still to trace, last first
+  bool completed {false};     // the last pending tile went out in the last batch
+  size_t batch_pixels {0};    // pixels handed out in the last batch
+
+  bool idle() const { return pending.empty(); }
+};
+
+// Shares the render thread pool between several views. Interactive views
+// (the one being manipulated) are traced whole in the frame they change, so
+// they stay as responsive as a single view. The tiles of the others are
+// handed out round robin, one tile per view in turn, until the estimated
+// time of the batch (interactive views included) reaches the frame budget.
+// Every waiting view gets at least one tile per frame, so all of them
+// finish eventually. A view is only shown once all of its tiles are traced.
+class TileScheduler {
+public:
+  struct Job {
+    size_t view;
+    Tile tile;
+  };
+
+  // Restart the views whose signature changed since their last trace
+  void update(const std::vector<ScheduledView*>& views, int tile_size) {
+    for (ScheduledView* view : views) {
+      if (view->wanted == view->traced && view->frame.width == view->wanted.width &&
+          view->frame.height == view->wanted.height) {
+        continue;
+      }
+      view->traced = view->wanted;
+      if (view->frame.width != view->traced.width || view->frame.height != view->traced.height) {
+        view->frame.y0 = 0;
+        view->frame.resize(view->traced.width, view->traced.height);
+      }
+      view->pending = make_tiles(view->traced.width, 0, view->traced.height, tile_size);
+      std::reverse(view->pending.begin(), view->pending.end());
+    }
+  }
+
+  // Tiles to trace in this frame
+  std::vector<Job> schedule(const std::vector<ScheduledView*>& views) {
+    std::vector<Job> jobs;
+    double pixels = 0.0;
+    for (ScheduledView* view : views) {
+      view->completed = false;
+      view->batch_pixels = 0;
+    }
+
+    auto take = [&](size_t i) {
+      ScheduledView& view = *views[i];
+      Tile tile = view.pending.back();
+      view.pending.pop_back();
+      jobs.push_back({i, tile});
+      size_t n = static_cast<size_t>(tile.width) * tile.height;
+      view.batch_pixels += n;
+      pixels += n;
+      if (view.pending.empty()) view.completed = true;
+    };
+
+    for (size_t i = 0; i < views.size(); i++) {
+      if (!views[i]->interactive) continue;
+      while (!views[i]->pending.empty()) take(i);
+    }
+
+    // budget in pixels from the measured cost of earlier batches, with no
+    // measurement yet one tile per view
+    double budget = seconds_per_pixel_ > 0.0 ? 1e-3 * budget_ms / seconds_per_pixel_ : 0.0;
+    size_t n = views.size();
+    bool first = true;
+    while (n > 0) {
+      bool took = false;
+      size_t start = next_;
+      for (size_t k = 0; k < n; k++) {
+        size_t i = (start + k) % n;
+        if (views[i]->interactive || views[i]->pending.empty()) continue;
+        if (!first && pixels >= budget) break;
+        take(i);
+        took = true;
+        next_ = (i + 1) % n;
+      }
+      first = false;
+      if (!took || pixels >= budget) break;
+    }
+    return jobs;
+  }
+
+  // Trace time of the last scheduled batch, for the next budget
+  void finished(size_t pixels, double seconds) {
+    if (pixels == 0) return;
+    double per_pixel = seconds / pixels;
+    seconds_per_pixel_ = seconds_per_pixel_ > 0.0 ? 0.8 * seconds_per_pixel_ + 0.2 * per_pixel : per_pixel;
+  }
+
+  double seconds_per_pixel() const { return seconds_per_pixel_; }
+
+  float budget_ms {25.0f};  // trace time per frame
+
+private:
+  size_t next_ {0};  // view to start the next round robin at
+  double seconds_per_pixel_ {0.0};
+};
+
+#endif // include guard
@@ -0,0 +1,229 @@
+#ifndef OPENMC_RENDER_VOXEL_GRID_H
+#define OPENMC_RENDER_VOXEL_GRID_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "openmc/cell.h"
+#include "openmc/geometry.h"
+#include "openmc/material.h"
+#include "openmc/plot.h"
+
+#include "frame.h"
+#include "tracer.h"
+
+// Cell and material indices sampled at voxel centers over the model's
+// bounding box. Ray marching this grid costs the same regardless of the CSG
+// complexity of the model, which makes it suitable as a preview while the
+// camera is moving.
+class VoxelGrid {
+public:
+  struct Settings {
+    int resolution {128};     // voxels along the longest axis
+    int memory_cap_mb {256};  // the resolution is reduced to stay below this
+  };
+
+  // Lookup tables for a frame: which indices are visible and their colors
+  struct Shading {
+    bool by_material;
+    std::vector<uint8_t> visible;
+    const std::vector<openmc::RGBColor>* colors;
+    openmc::Position light;
+    double diffuse_fraction;
+    openmc::RGBColor background;
+  };
+
+  bool ready() const { return ready_; }
+  float progress() const { return progress_; }
+  int nx() const { return n_[0]; }
+  int ny() const { return n_[1]; }
+  int nz() const { return n_[2]; }
+  size_t memory_bytes() const { return (cell_.size() + material_.size()) * sizeof(int32_t); }
+  const openmc::Position& lower() const { return lower_; }
+  double voxel_size() const { return voxel_size_; }
+
+  // Cell or material index of every voxel, -1 outside of the geometry
+  const std::vector<int32_t>& indices(bool by_material) const {
+    return by_material ? material_ : cell_;
+  }
+
+  size_t index(int i, int j, int k) const {
+    return (static_cast<size_t>(k) * n_[1] + j) * n_[0] + i;
+  }
+
+  // Grid dimensions for the given bounds and settings. The voxel size follows
+  // from the requested resolution and is grown until the grid fits the cap.
+  static double dimensions(const ModelBounds& bounds, const Settings& settings, int n[3]) {
+    openmc::Position extent = bounds.upper - bounds.lower;
+    double longest = std::max({extent[0], extent[1], extent[2]});
+    size_t cap = static_cast<size_t>(settings.memory_cap_mb) * 1024 * 1024 / (2 * sizeof(int32_t));
+    double voxel_size = longest / std::max(1, settings.resolution);
+    while (true) {
+      for (int i = 0; i < 3; i++) {
+        n[i] = std::max(1, static_cast<int>(std::ceil(extent[i] / voxel_size)));
+      }
+      if (static_cast<size_t>(n[0]) * n[1] * n[2] <= cap) return voxel_size;
+      voxel_size *= 1.1;
+    }
+  }
+
+  void clear() {
+    ready_ = false;
+    progress_ = 0.0f;
+    cell_.clear();
+    cell_.shrink_to_fit();
+    material_.clear();
+    material_.shrink_to_fit();
+  }
+
+  // Sample the geometry using n_threads threads. Returns false if the bounds
+  // are infinite or the build was cancelled.
+  bool build(const ModelBounds& bounds, const Settings& settings, int n_threads, const std::atomic<bool>& cancel) {
+    clear();
+    if (!bounds.finite) return false;
+
+    lower_ = bounds.lower;
+    voxel_size_ = dimensions(bounds, settings, n_);
+
+    size_t n_voxels = static_cast<size_t>(n_[0]) * n_[1] * n_[2];
+    cell_.assign(n_voxels, -1);
+    material_.assign(n_voxels, -1);
+
+    // z-slices are handed out dynamically to the build threads
+    std::atomic<int> next_slice {0};
+    std::atomic<int> slices_done {0};
+    auto worker = [&]() {
+      openmc::GeometryState g;
+      while (!cancel) {
+        int k = next_slice++;
+        if (k >= n_[2]) break;
+        for (int j = 0; j < n_[1]; j++) {
+          for (int i = 0; i < n_[0]; i++) {
+            g.n_coord() = 1;
+            g.coord(0).universe = openmc::model::root_universe;
+            g.r() = voxel_center(i, j, k);
+            g.u() = {0.0, 0.0, 1.0};
+            if (openmc::exhaustive_find_cell(g)) {
+              size_t v = index(i, j, k);
+              cell_[v] = g.lowest_coord().cell;
+              material_[v] = g.material();
+            }
+          }
+        }
+        progress_ = static_cast<float>(++slices_done) / n_[2];
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::max(1, n_threads); t++) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) thread.join();
+
+    if (cancel) {
+      clear();
+      return false;
+    }
+    ready_ = true;
+    return true;
+  }
+
+  // Ray march the grid with a 3D DDA and shade the first visible voxel
+  void trace(const openmc::Position& r, const openmc::Direction& u, const Shading& shading,
+             Frame& frame, size_t pixel) const {
+    double t_enter, t_exit;
+    openmc::Position upper = lower_ + openmc::Position(n_[0], n_[1], n_[2]) * voxel_size_;
+    ModelBounds box {lower_, upper, true};
+    if (!box.intersect(r, u, t_enter, t_exit)) {
+      frame.set_background(pixel, shading.background);
+      return;
+    }
+
+    double t = std::max(t_enter, 0.0);
+    openmc::Position p = r + u * (t + 1e-9 * voxel_size_);
+
+    int cell[3], step[3];
+    double t_max[3], t_delta[3];
+    int axis = 0;  // axis of the last voxel face crossed
+    for (int a = 0; a < 3; a++) {
+      cell[a] = std::min(n_[a] - 1, std::max(0, static_cast<int>((p[a] - lower_[a]) / voxel_size_)));
+      if (u[a] > 0.0) {
+        step[a] = 1;
+        t_delta[a] = voxel_size_ / u[a];
+        t_max[a] = t + (lower_[a] + (cell[a] + 1) * voxel_size_ - p[a]) / u[a];
+      } else if (u[a] < 0.0) {
+        step[a] = -1;
+        t_delta[a] = -voxel_size_ / u[a];
+        t_max[a] = t + (lower_[a] + cell[a] * voxel_size_ - p[a]) / u[a];
+      } else {
+        step[a] = 0;
+        t_delta[a] = t_max[a] = std::numeric_limits<double>::infinity();
+      }
+    }
+    // the face through which the ray entered the grid
+    if (t_enter > 0.0) {
+      for (int a = 0; a < 3; a++) {
+        if (u[a] != 0.0 && std::abs(t_max[a] - t_delta[a] - t_enter) < 1e-9 * voxel_size_ / std::abs(u[a]) + 1e-12) {
+          axis = a;
+        }
+      }
+    }
+
+    while (true) {
+      size_t v = index(cell[0], cell[1], cell[2]);
+      int32_t id = shading.by_material ? material_[v] : cell_[v];
+      if (id >= 0 && id < static_cast<int32_t>(shading.visible.size()) && shading.visible[id]) {
+        openmc::Direction normal {0.0, 0.0, 0.0};
+        normal[axis] = -step[axis];
+        openmc::Position hit = r + u * t;
+        openmc::Direction to_light = shading.light - hit;
+        to_light /= to_light.norm();
+
+        double modulation = shading.diffuse_fraction +
+          (1.0 - shading.diffuse_fraction) * std::max(0.0, normal.dot(to_light));
+        openmc::RGBColor color = (*shading.colors)[id];
+        color *= modulation;
+        frame.color[pixel] = color;
+
+        if (frame.has_gbuffer()) {
+          frame.cell_id[pixel] = cell_[v] >= 0 ? openmc::model::cells[cell_[v]]->id_ : -1;
+          frame.material_id[pixel] = material_[v] >= 0 ? openmc::model::materials[material_[v]]->id_ : -1;
+          frame.depth[pixel] = t;
+        }
+        return;
+      }
+
+      // advance to the next voxel
+      axis = 0;
+      if (t_max[1] < t_max[axis]) axis = 1;
+      if (t_max[2] < t_max[axis]) axis = 2;
+      t = t_max[axis];
+      cell[axis] += step[axis];
+      if (cell[axis] < 0 || cell[axis] >= n_[axis]) break;
+      t_max[axis] += t_delta[axis];
+    }
+
+    frame.set_background(pixel, shading.background);
+  }
+
+private:
+  openmc::Position voxel_center(int i, int j, int k) const {
+    return lower_ + openmc::Position(i + 0.5, j + 0.5, k + 0.5) * voxel_size_;
+  }
+
+  openmc::Position lower_;
+  double voxel_size_ {1.0};
+  int n_[3] {0, 0, 0};
+  std::vector<int32_t> cell_;
+  std::vector<int32_t> material_;
+  std::atomic<bool> ready_ {false};
+  std::atomic<float> progress_ {0.0f};
+};
+
+#endif // include guard